@@ -0,0 +1,37 @@
+/*
+baseline.c
+Reset to a baseline snapshot by rewriting only the dirty pages.
+*/
+
+#include <string.h>
+#include "baseline.h"
+
+// c6502_baseline_capture() Copy memory and registers, start tracking writes.
+void c6502_baseline_capture(c6502_baseline *baseline)
+{
+    memcpy(baseline->memory, ADDRESS, sizeof(ADDRESS));
+    baseline->cpu = c6502;
+    baseline->databus = DATABUS;
+    baseline->epoch = bus_new_epoch();
+}
+
+// c6502_baseline_reset() Copy back pages written since the last capture or reset.
+int c6502_baseline_reset(c6502_baseline *baseline)
+{
+    int restored = 0;
+
+    for (int page = 0; page < 256; page++)
+    {
+        if (bus_page_dirty(page, baseline->epoch))
+        {
+            memcpy(&ADDRESS[page << 8], &baseline->memory[page << 8], 256);
+            // Other epoch users see the restore as a write.
+            bus_touch_page(page);
+            restored++;
+        }
+    }
+    c6502 = baseline->cpu;
+    DATABUS = baseline->databus;
+    baseline->epoch = bus_new_epoch();
+    return restored;
+}
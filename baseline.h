@@ -0,0 +1,36 @@
+// baseline.h
+
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Baseline snapshots for fast reset.
+
+c6502_baseline_capture() copies the whole machine once, for example after c6502_init() and
+loading the ROM. c6502_baseline_reset() then puts the machine back into that state by copying
+only the pages written since the capture or the previous reset (bus dirty page tracking), plus
+the cpu registers. A run that touched a handful of pages costs a handful of 256 byte copies to
+undo, instead of clearing 64KB and reloading the ROM.
+
+Code that changes ADDRESS without cpu_write() must call bus_touch_page() for the pages it changes.
+*/
+
+typedef struct
+{
+    c6502_cpu cpu;
+    uint8_t databus;
+    uint32_t epoch;
+    uint8_t memory[65536];
+} c6502_baseline;
+
+// Copy the current machine into baseline.
+void c6502_baseline_capture(c6502_baseline *baseline);
+
+// Restore the machine to baseline. Return the number of pages copied.
+int c6502_baseline_reset(c6502_baseline *baseline);
+
+#endif
@@ -0,0 +1,515 @@
+/*
+batch.c
+c6502-batch runs a manifest of rom test jobs on a work-stealing thread pool.
+
+Manifest, one job per line, # starts a comment:
+
+    rom start_pc cycles [address=value ...]
+
+    nestest.nes C000 26560 0002=00 0003=00
+
+start_pc is the hex automation entry passed to c6502_init(). The job runs until c6502.cycles
+reaches cycles, the cpu jams, or an instruction jumps to itself (trap). Then every hex
+address=value check is compared with memory. A job passes if all checks match.
+
+Each result is printed as one JSON object per line in manifest order, followed by a summary
+object. The exit code is 0 if every job passed.
+
+c6502-batch-untimed is the same runner built with C6502_UNTIMED: no cycle bookkeeping, so the
+cycles budget and the reported cycles count instructions. Use it for jobs that only check memory.
+The summary object names the engine in "timing".
+
+With -t name every worker publishes its running totals to the shared memory region name about
+every 65536 instructions and after each job; watch them with c6502-top name.
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "c6502.h"
+#include "loader.h"
+#include "baseline.h"
+#include "telemetry.h"
+
+// Maximum memory checks per job.
+#define BATCH_MAX_CHECKS 16
+// Instructions between telemetry updates, a power of two.
+#define BATCH_TELEMETRY_PERIOD 65536
+
+typedef enum
+{
+    BATCH_ERROR, // rom could not be loaded
+    BATCH_PASS,
+    BATCH_FAIL,
+} batch_status;
+
+typedef struct
+{
+    char *rom;
+    int line;
+    uint16_t start;
+    uint64_t cycles;
+    int check_count;
+    uint16_t check_address[BATCH_MAX_CHECKS];
+    uint8_t check_value[BATCH_MAX_CHECKS];
+
+    // Result
+    batch_status status;
+    const char *stop; // "budget", "trap" or "jam"
+    uint64_t end_cycles;
+    uint64_t instructions;
+    uint16_t end_pc;
+    uint8_t actual[BATCH_MAX_CHECKS];
+} batch_job;
+
+/*
+Per worker deque holding a range of job indices. The owner takes jobs from the head, a thief
+takes the upper half of the remaining range.
+*/
+typedef struct
+{
+    pthread_mutex_t lock;
+    int head;
+    int tail;
+} batch_deque;
+
+typedef struct
+{
+    pthread_t thread;
+    int id;
+    int slot; // Telemetry slot, -1 for none
+    uint64_t instructions;
+    uint64_t cycles;
+} batch_worker;
+
+static batch_job *jobs = NULL;
+static int job_count = 0;
+static batch_deque *deques = NULL;
+static int worker_count = 0;
+
+// Publish the totals of worker plus the job in progress.
+static void batch_publish(const batch_worker *worker, uint64_t job_instructions, uint64_t job_cycles)
+{
+    c6502_telemetry_update(worker->slot, worker->instructions + job_instructions, worker->cycles + job_cycles, 0,
+                           sizeof(c6502_baseline));
+}
+
+// Take the next job of worker id. Return -1 if its deque is empty.
+static int batch_pop(int id)
+{
+    batch_deque *deque = &deques[id];
+    int job = -1;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail)
+    {
+        job = deque->head++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+// Steal half of another worker's remaining jobs into deque id. Return false if all are empty.
+static bool batch_steal(int id)
+{
+    for (int i = 1; i < worker_count; i++)
+    {
+        batch_deque *victim = &deques[(id + i) % worker_count];
+        int head = 0;
+        int tail = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail)
+        {
+            int mid = victim->head + (victim->tail - victim->head) / 2;
+            head = mid;
+            tail = victim->tail;
+            victim->tail = mid;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (head < tail)
+        {
+            pthread_mutex_lock(&deques[id].lock);
+            deques[id].head = head;
+            deques[id].tail = tail;
+            pthread_mutex_unlock(&deques[id].lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+Run one job on this thread's machine.
+A job with the same rom and start as the previous one on this worker starts from the worker's
+baseline with a dirty page reset instead of reloading the rom.
+*/
+static void batch_run(batch_worker *worker, batch_job *job, c6502_baseline *baseline, const batch_job **previous)
+{
+    if (*previous && strcmp((*previous)->rom, job->rom) == 0 && (*previous)->start == job->start)
+    {
+        c6502_baseline_reset(baseline);
+    }
+    else
+    {
+        size_t size = 0;
+        uint8_t *image = c6502_read_file(job->rom, &size);
+
+        *previous = NULL;
+        memset(ADDRESS, 0, sizeof(ADDRESS));
+        memset(&c6502, 0, sizeof(c6502));
+        DATABUS = 0;
+        c6502_init(job->start >> 8, job->start & 0xFF);
+        if (!image || !c6502_load_ines_image(image, size))
+        {
+            free(image);
+            job->status = BATCH_ERROR;
+            return;
+        }
+        free(image);
+        c6502_baseline_capture(baseline);
+    }
+    *previous = job;
+
+    uint64_t start_cycles = c6502.cycles;
+
+    job->stop = "budget";
+    while (c6502.cycles < job->cycles)
+    {
+        uint16_t pc = c6502.PC;
+
+        c6502_step();
+        job->instructions++;
+        if (worker->slot >= 0 && (job->instructions & (BATCH_TELEMETRY_PERIOD - 1)) == 0)
+        {
+            batch_publish(worker, job->instructions, c6502.cycles - start_cycles);
+        }
+        if (c6502.JAM)
+        {
+            job->stop = "jam";
+            break;
+        }
+        if (c6502.PC == pc)
+        {
+            job->stop = "trap";
+            break;
+        }
+    }
+
+    job->status = BATCH_PASS;
+    for (int i = 0; i < job->check_count; i++)
+    {
+        job->actual[i] = ADDRESS[job->check_address[i]];
+        if (job->actual[i] != job->check_value[i])
+        {
+            job->status = BATCH_FAIL;
+        }
+    }
+    job->end_cycles = c6502.cycles;
+    job->end_pc = c6502.PC;
+
+    worker->instructions += job->instructions;
+    worker->cycles += c6502.cycles - start_cycles;
+    if (worker->slot >= 0)
+    {
+        batch_publish(worker, 0, 0);
+    }
+}
+
+static void *batch_worker_main(void *arg)
+{
+    batch_worker *worker = arg;
+    const batch_job *previous = NULL;
+    c6502_baseline *baseline = malloc(sizeof(c6502_baseline));
+
+    if (!baseline)
+    {
+        return NULL;
+    }
+    for (;;)
+    {
+        int job = batch_pop(worker->id);
+        if (job < 0)
+        {
+            if (!batch_steal(worker->id))
+            {
+                break;
+            }
+            continue;
+        }
+        batch_run(worker, &jobs[job], baseline, &previous);
+    }
+    free(baseline);
+    return NULL;
+}
+
+// Parse one manifest line into job. Return false on a syntax error.
+static bool batch_parse(char *text, batch_job *job)
+{
+    char *rom = strtok(text, " \t\r\n");
+    char *start = strtok(NULL, " \t\r\n");
+    char *cycles = strtok(NULL, " \t\r\n");
+    char *check = NULL;
+    char *end = NULL;
+
+    if (!rom || !start || !cycles)
+    {
+        return false;
+    }
+    job->start = (uint16_t)strtoul(start, &end, 16);
+    if (*end != '\0')
+    {
+        return false;
+    }
+    job->cycles = strtoull(cycles, &end, 10);
+    if (*end != '\0')
+    {
+        return false;
+    }
+    while ((check = strtok(NULL, " \t\r\n")) != NULL)
+    {
+        if (job->check_count == BATCH_MAX_CHECKS)
+        {
+            return false;
+        }
+        job->check_address[job->check_count] = (uint16_t)strtoul(check, &end, 16);
+        if (*end != '=')
+        {
+            return false;
+        }
+        job->check_value[job->check_count] = (uint8_t)strtoul(end + 1, &end, 16);
+        if (*end != '\0')
+        {
+            return false;
+        }
+        job->check_count++;
+    }
+    job->rom = strdup(rom);
+    return job->rom != NULL;
+}
+
+// Read all jobs of the manifest. Return false on a read or syntax error.
+static bool batch_read_manifest(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char text[1024];
+    int capacity = 0;
+    int line = 0;
+
+    if (!fp)
+    {
+        fprintf(stderr, "Manifest %s does not exist\n", path);
+        return false;
+    }
+    while (fgets(text, sizeof(text), fp))
+    {
+        char *comment = strchr(text, '#');
+        line++;
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        if (strspn(text, " \t\r\n") == strlen(text))
+        {
+            continue;
+        }
+        if (job_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            batch_job *grown = realloc(jobs, capacity * sizeof(batch_job));
+            if (!grown)
+            {
+                fclose(fp);
+                return false;
+            }
+            jobs = grown;
+        }
+        memset(&jobs[job_count], 0, sizeof(batch_job));
+        jobs[job_count].line = line;
+        if (!batch_parse(text, &jobs[job_count]))
+        {
+            fprintf(stderr, "%s:%d: expected rom start_pc cycles [address=value ...]\n", path, line);
+            fclose(fp);
+            return false;
+        }
+        job_count++;
+    }
+    fclose(fp);
+    return true;
+}
+
+// Print s as a JSON string.
+static void batch_print_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            putchar('\\');
+        }
+        if ((unsigned char)*s < 0x20)
+        {
+            printf("\\u%04x", *s);
+            continue;
+        }
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void batch_print_job(const batch_job *job)
+{
+    static const char *status[] = {"error", "pass", "fail"};
+
+    printf("{\"line\":%d,\"rom\":", job->line);
+    batch_print_string(job->rom);
+    printf(",\"status\":\"%s\"", status[job->status]);
+    if (job->status != BATCH_ERROR)
+    {
+        printf(",\"stop\":\"%s\",\"cycles\":%llu,\"instructions\":%llu,\"pc\":\"%04X\",\"failed\":[",
+               job->stop, (unsigned long long)job->end_cycles, (unsigned long long)job->instructions, job->end_pc);
+        const char *separator = "";
+        for (int i = 0; i < job->check_count; i++)
+        {
+            if (job->actual[i] != job->check_value[i])
+            {
+                printf("%s{\"address\":\"%04X\",\"expected\":\"%02X\",\"actual\":\"%02X\"}",
+                       separator, job->check_address[i], job->check_value[i], job->actual[i]);
+                separator = ",";
+            }
+        }
+        printf("]");
+    }
+    printf("}\n");
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-batch [-j threads] [-t name] manifest\n");
+    printf("  -j threads  worker threads, default one per online cpu\n");
+    printf("  -t name     publish live counters to shared memory region name, see c6502-top\n");
+    printf("Manifest lines: rom start_pc cycles [address=value ...]\n");
+    if (!C6502_TIMED)
+    {
+        printf("Untimed engine: cycles are counted as instructions.\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *manifest = NULL;
+    const char *telemetry = NULL;
+    struct timespec begin, end;
+    int counts[3] = {0};
+
+    worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-j") == 0)
+        {
+            worker_count = atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-t") == 0)
+        {
+            telemetry = argv[++i];
+        }
+        else if (!manifest && argv[i][0] != '-')
+        {
+            manifest = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (!manifest || worker_count < 1)
+    {
+        usage();
+        return 1;
+    }
+    if (!batch_read_manifest(manifest))
+    {
+        return 1;
+    }
+    if (worker_count > job_count)
+    {
+        worker_count = job_count ? job_count : 1;
+    }
+
+    if (telemetry && !c6502_telemetry_open(telemetry))
+    {
+        fprintf(stderr, "Unable to open telemetry region %s\n", telemetry);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    // Give every worker an equal contiguous share. Jobs with the same rom stay together.
+    batch_worker *workers = malloc(worker_count * sizeof(batch_worker));
+    deques = malloc(worker_count * sizeof(batch_deque));
+    if (!workers || !deques)
+    {
+        return 1;
+    }
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].head = (int)((long long)job_count * i / worker_count);
+        deques[i].tail = (int)((long long)job_count * (i + 1) / worker_count);
+        workers[i].id = i;
+        workers[i].slot = -1;
+        workers[i].instructions = 0;
+        workers[i].cycles = 0;
+        if (telemetry)
+        {
+            char label[C6502_TELEMETRY_LABEL];
+
+            snprintf(label, sizeof(label), "batch %d worker %d", (int)getpid(), i);
+            workers[i].slot = c6502_telemetry_claim(label);
+        }
+    }
+    for (int i = 0; i < worker_count; i++)
+    {
+        if (pthread_create(&workers[i].thread, NULL, batch_worker_main, &workers[i]) != 0)
+        {
+            fprintf(stderr, "Unable to start worker thread\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        c6502_telemetry_release(workers[i].slot);
+    }
+    c6502_telemetry_close();
+
+    for (int i = 0; i < job_count; i++)
+    {
+        batch_print_job(&jobs[i]);
+        counts[jobs[i].status]++;
+    }
+    printf("{\"jobs\":%d,\"passed\":%d,\"failed\":%d,\"errors\":%d,\"threads\":%d,\"timing\":\"%s\","
+           "\"seconds\":%.3f}\n",
+           job_count, counts[BATCH_PASS], counts[BATCH_FAIL], counts[BATCH_ERROR], worker_count, C6502_TIMING,
+           (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9);
+
+    for (int i = 0; i < job_count; i++)
+    {
+        free(jobs[i].rom);
+    }
+    free(jobs);
+    free(deques);
+    free(workers);
+    return counts[BATCH_PASS] == job_count ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+/*
+bench.c
+c6502-bench measures the speed of the emulator itself on a fixed set of workloads.
+
+Every workload runs the same number of instructions, once to warm up and then repeats times.
+Reported per workload: the median host ns per emulated instruction, the fastest run, emulated
+MHz at the median, and the run to run spread as the relative standard deviation. With -b the
+medians are compared against a baseline file written earlier with -s, so a change can be
+measured as "before -b, after -b".
+
+Workloads:
+    nestest     nestest.nes without tracing, reset to a baseline every 8991 instructions
+    alu         loads, adds, logic and shifts on registers
+    branch      counting loop with taken and not taken branches
+    memory      absolute indexed and indirect indexed loads and stores, read modify write
+    stack       nested JSR/RTS with PHA/PLA and PHP/PLP
+    interrupt   a short loop with an IRQ every 8 and an NMI every 64 instructions
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "c6502.h"
+#include "loader.h"
+#include "baseline.h"
+
+#define BENCH_INSTRUCTIONS 2000000
+#define BENCH_REPEATS 5
+#define BENCH_MAX_REPEATS 100
+// Instructions per nestest run, as in main.c.
+#define BENCH_NESTEST_STEPS 8991
+
+typedef struct
+{
+    const char *name;
+    const uint8_t *program; // Loaded at $0200, NULL for nestest
+    size_t size;
+    int irq_every; // Raise IRQ every n instructions, 0 for never
+    int nmi_every; // Raise NMI every n instructions, 0 for never
+} bench_workload;
+
+typedef struct
+{
+    double median;
+    double fastest;
+    double mhz;
+    double spread;
+} bench_result;
+
+// LDA #0; LDX #0; loop: CLC; ADC #$37; AND #$F7; EOR #$5A; ASL A; ORA #1; LSR A; CMP #$80;
+// SBC #3; ROL A; ROR A; INX; JMP loop
+static const uint8_t bench_alu[] = {0xA9, 0x00, 0xA2, 0x00, 0x18, 0x69, 0x37, 0x29, 0xF7, 0x49, 0x5A,
+                                    0x0A, 0x09, 0x01, 0x4A, 0xC9, 0x80, 0xE9, 0x03, 0x2A, 0x6A, 0xE8,
+                                    0x4C, 0x04, 0x02};
+
+// LDX #0; loop: INX; TXA; AND #1; BEQ +2; LDY #1; TXA; AND #2; BNE +1; NOP; CPX #$80; BCC loop;
+// LDX #0; JMP loop
+static const uint8_t bench_branch[] = {0xA2, 0x00, 0xE8, 0x8A, 0x29, 0x01, 0xF0, 0x02, 0xA0, 0x01, 0x8A,
+                                       0x29, 0x02, 0xD0, 0x01, 0xEA, 0xE0, 0x80, 0x90, 0xEE, 0xA2, 0x00,
+                                       0x4C, 0x02, 0x02};
+
+// LDY #0; outer: LDX #0; inner: LDA $0300,X; STA $0400,X; LDA ($10),Y; STA ($12),Y;
+// INC $0500,X; INX; BNE inner; INY; JMP outer
+static const uint8_t bench_memory[] = {0xA0, 0x00, 0xA2, 0x00, 0xBD, 0x00, 0x03, 0x9D, 0x00, 0x04, 0xB1,
+                                       0x10, 0x91, 0x12, 0xFE, 0x00, 0x05, 0xE8, 0xD0, 0xF0, 0xC8, 0x4C,
+                                       0x02, 0x02};
+
+// $0200: LDX #$FF; TXS; loop: JSR $0210; PHP; PLP; JMP loop
+// $0210: PHA; TXA; PHA; JSR $0220; PLA; PLA; RTS
+// $0220: PHA; PLA; RTS
+static const uint8_t bench_stack[] = {0xA2, 0xFF, 0x9A, 0x20, 0x10, 0x02, 0x08, 0x28, 0x4C, 0x03, 0x02,
+                                      0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x8A, 0x48, 0x20, 0x20, 0x02,
+                                      0x68, 0x68, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48,
+                                      0x68, 0x60};
+
+// $0200: CLI; loop: INX; JMP loop. $0210 IRQ handler: INC $20; RTI. $0214 NMI handler: RTI
+static const uint8_t bench_interrupt[] = {0x58, 0xE8, 0x4C, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                          0x00, 0x00, 0x00, 0x00, 0x00, 0xE6, 0x20, 0x40, 0x00, 0x40};
+
+static const bench_workload workloads[] = {
+    {"nestest", NULL, 0, 0, 0},
+    {"alu", bench_alu, sizeof(bench_alu), 0, 0},
+    {"branch", bench_branch, sizeof(bench_branch), 0, 0},
+    {"memory", bench_memory, sizeof(bench_memory), 0, 0},
+    {"stack", bench_stack, sizeof(bench_stack), 0, 0},
+    {"interrupt", bench_interrupt, sizeof(bench_interrupt), 8, 64},
+};
+
+#define BENCH_WORKLOADS (int)(sizeof(workloads) / sizeof(workloads[0]))
+
+static uint8_t *rom = NULL;
+static size_t rom_size = 0;
+static c6502_baseline *nestest_baseline = NULL;
+
+static double bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Load workload into a cleared machine.
+static void bench_setup(const bench_workload *w)
+{
+    memset(ADDRESS, 0, sizeof(ADDRESS));
+    if (!w->program)
+    {
+        c6502_init(0xC0, 0x00);
+        c6502_load_ines_image(rom, rom_size);
+        c6502_baseline_capture(nestest_baseline);
+        return;
+    }
+    c6502_init(0x02, 0x00);
+    memcpy(&ADDRESS[0x0200], w->program, w->size);
+    // Pointers for the memory workload, vectors for the interrupt workload.
+    ADDRESS[0x11] = 0x06;
+    ADDRESS[0x13] = 0x07;
+    ADDRESS[0xFFFE] = 0x10;
+    ADDRESS[0xFFFF] = 0x02;
+    ADDRESS[0xFFFA] = 0x14;
+    ADDRESS[0xFFFB] = 0x02;
+}
+
+// Run instructions of workload. Return the elapsed host seconds, add emulated cycles to cycles.
+static double bench_run(const bench_workload *w, long instructions, uint64_t *cycles)
+{
+    bench_setup(w);
+    uint64_t start = c6502.cycles;
+    double begin = bench_now();
+
+    if (!w->program)
+    {
+        // Cycles are summed per run, the reset sets the counter back.
+        for (long done = 0; done < instructions; done += BENCH_NESTEST_STEPS)
+        {
+            long steps = (instructions - done < BENCH_NESTEST_STEPS) ? instructions - done : BENCH_NESTEST_STEPS;
+            *cycles += c6502.cycles - start;
+            c6502_baseline_reset(nestest_baseline);
+            start = c6502.cycles;
+            for (long i = 0; i < steps; i++)
+            {
+                c6502_step();
+            }
+        }
+    }
+    else if (w->irq_every || w->nmi_every)
+    {
+        for (long i = 1; i <= instructions; i++)
+        {
+            c6502_step();
+            if (w->nmi_every && i % w->nmi_every == 0)
+            {
+                c6502_nmi();
+            }
+            else if (w->irq_every && i % w->irq_every == 0)
+            {
+                c6502_irq();
+            }
+        }
+    }
+    else
+    {
+        for (long i = 0; i < instructions; i++)
+        {
+            c6502_step();
+        }
+    }
+
+    double elapsed = bench_now() - begin;
+    *cycles += c6502.cycles - start;
+    return elapsed;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Warm up, then time repeats runs of workload.
+static bench_result bench_measure(const bench_workload *w, long instructions, int repeats)
+{
+    double ns[BENCH_MAX_REPEATS];
+    double mhz[BENCH_MAX_REPEATS];
+    double mean = 0, variance = 0;
+    bench_result result;
+    uint64_t cycles = 0;
+
+    bench_run(w, instructions, &cycles);
+    for (int i = 0; i < repeats; i++)
+    {
+        cycles = 0;
+        double elapsed = bench_run(w, instructions, &cycles);
+        ns[i] = elapsed * 1e9 / instructions;
+        mhz[i] = cycles / elapsed / 1e6;
+        mean += ns[i] / repeats;
+    }
+    for (int i = 0; i < repeats; i++)
+    {
+        variance += (ns[i] - mean) * (ns[i] - mean) / repeats;
+    }
+    qsort(ns, repeats, sizeof(double), bench_compare);
+    qsort(mhz, repeats, sizeof(double), bench_compare);
+
+    result.median = ns[repeats / 2];
+    result.fastest = ns[0];
+    result.mhz = mhz[repeats / 2];
+    result.spread = mean > 0 ? 100.0 * sqrt(variance) / mean : 0;
+    return result;
+}
+
+// Return the median of workload name in baseline file fp, or 0 if not listed.
+static double bench_baseline_lookup(FILE *fp, const char *name)
+{
+    char line[256];
+    char listed[64];
+    double ns;
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] != '#' && sscanf(line, "%63s %lf", listed, &ns) == 2 && strcmp(listed, name) == 0)
+        {
+            return ns;
+        }
+    }
+    return 0;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-bench [-n instructions] [-r repeats] [-k workload] [-b baseline] [-s baseline]\n");
+    printf("  -n instructions  instructions per run, default %d\n", BENCH_INSTRUCTIONS);
+    printf("  -r repeats       timed runs per workload, default %d\n", BENCH_REPEATS);
+    printf("  -k workload      only run nestest, alu, branch, memory, stack or interrupt\n");
+    printf("  -b baseline      compare medians against a baseline file\n");
+    printf("  -s baseline      save medians as a baseline file\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long instructions = BENCH_INSTRUCTIONS;
+    int repeats = BENCH_REPEATS;
+    const char *only = NULL;
+    const char *compare_path = NULL;
+    const char *save_path = NULL;
+    FILE *compare = NULL;
+    FILE *save = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-n") == 0)
+        {
+            instructions = atol(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-r") == 0)
+        {
+            repeats = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-k") == 0)
+        {
+            only = argv[++i];
+        }
+        else if (has_value && strcmp(argv[i], "-b") == 0)
+        {
+            compare_path = argv[++i];
+        }
+        else if (has_value && strcmp(argv[i], "-s") == 0)
+        {
+            save_path = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (instructions < 1 || repeats < 1 || repeats > BENCH_MAX_REPEATS)
+    {
+        usage();
+        return 1;
+    }
+
+    rom = c6502_read_file("nestest.nes", &rom_size);
+    nestest_baseline = malloc(sizeof(c6502_baseline));
+    if (!rom || !nestest_baseline)
+    {
+        printf("Rom file nestest.nes does not exist\n");
+        return 1;
+    }
+    if (compare_path && !(compare = fopen(compare_path, "r")))
+    {
+        printf("Baseline file %s does not exist\n", compare_path);
+        return 1;
+    }
+    if (save_path && !(save = fopen(save_path, "w")))
+    {
+        printf("Unable to write %s\n", save_path);
+        return 1;
+    }
+    if (save)
+    {
+        fprintf(save, "# c6502-bench median ns per instruction, %ld instructions x %d runs\n", instructions, repeats);
+    }
+
+    printf("%ld instructions x %d runs per workload\n", instructions, repeats);
+    printf("workload    ns/instr   fastest        MHz   spread%s\n", compare ? "   baseline   change" : "");
+    for (int i = 0; i < BENCH_WORKLOADS; i++)
+    {
+        const bench_workload *w = &workloads[i];
+
+        if (only && strcmp(only, w->name) != 0)
+        {
+            continue;
+        }
+        bench_result r = bench_measure(w, instructions, repeats);
+        printf("%-10s %9.2f %9.2f %10.2f %7.1f%%", w->name, r.median, r.fastest, r.mhz, r.spread);
+        if (compare)
+        {
+            double before = bench_baseline_lookup(compare, w->name);
+            if (before > 0)
+            {
+                printf(" %10.2f %+7.1f%%", before, 100.0 * (r.median - before) / before);
+            }
+            else
+            {
+                printf("          -        -");
+            }
+        }
+        printf("\n");
+        if (save)
+        {
+            fprintf(save, "%s %.3f\n", w->name, r.median);
+        }
+    }
+
+    if (compare)
+    {
+        fclose(compare);
+    }
+    if (save)
+    {
+        fclose(save);
+    }
+    free(nestest_baseline);
+    free(rom);
+    return 0;
+}
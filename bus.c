@@ -4,18 +4,152 @@
 #include <stdio.h>
 
 // Global variable definitions
-uint8_t ADDRESS[65536];
-uint8_t DATABUS;
+C6502_THREAD_LOCAL uint8_t ADDRESS[65536];
+C6502_THREAD_LOCAL uint8_t DATABUS;
+C6502_THREAD_LOCAL uint8_t *bus_memory = NULL;
+C6502_THREAD_LOCAL uint32_t bus_page_epoch[256];
+C6502_THREAD_LOCAL bus_heatmap *bus_heat = NULL;
 
-uint8_t cpu_read(uint16_t abs_address)
+// Epoch stamped on written pages. Starts at 1 so that 0 means never written.
+static C6502_THREAD_LOCAL uint32_t bus_epoch = 1;
+
+// Installed write hooks. Only the first write_hook_count entries are used.
+static C6502_THREAD_LOCAL bus_write_hook write_hooks[BUS_MAX_WRITE_HOOKS];
+static C6502_THREAD_LOCAL void *write_hook_ctx[BUS_MAX_WRITE_HOOKS];
+static C6502_THREAD_LOCAL int write_hook_count = 0;
+
+// Device handlers per page. io_mapped is checked first to keep plain memory access cheap.
+static C6502_THREAD_LOCAL bus_io io_pages[256];
+static C6502_THREAD_LOCAL bool io_mapped[256];
+
+// Count an access in the heatmap, if one is collecting.
+static inline void bus_count(bus_access kind, uint16_t abs_address)
+{
+    if (bus_heat)
+    {
+        bus_heat->pages[kind][abs_address >> 8]++;
+        if (bus_heat->addresses)
+        {
+            bus_heat->addresses[kind][abs_address]++;
+        }
+    }
+}
+
+static inline uint8_t bus_read(uint16_t abs_address)
 {
-    DATABUS = ADDRESS[abs_address];
+    uint8_t page = abs_address >> 8;
+
+    if (io_mapped[page] && io_pages[page].read)
+    {
+        DATABUS = io_pages[page].read(io_pages[page].ctx, abs_address);
+    }
+    else
+    {
+        DATABUS = bus_memory ? bus_memory[abs_address] : ADDRESS[abs_address];
+    }
     return DATABUS;
 }
 
+uint8_t cpu_read(uint16_t abs_address)
+{
+    bus_count(BUS_READ, abs_address);
+    return bus_read(abs_address);
+}
+
+uint8_t cpu_fetch(uint16_t abs_address)
+{
+    bus_count(BUS_FETCH, abs_address);
+    return bus_read(abs_address);
+}
+
+uint8_t bus_peek(uint16_t abs_address)
+{
+    return bus_memory ? bus_memory[abs_address] : ADDRESS[abs_address];
+}
+
 void cpu_write(uint16_t abs_address, uint8_t data)
 {
+    uint8_t page = abs_address >> 8;
+
+    bus_count(BUS_WRITE, abs_address);
     DATABUS = data;
-    ADDRESS[abs_address] = data;
+    if (io_mapped[page] && io_pages[page].write)
+    {
+        io_pages[page].write(io_pages[page].ctx, abs_address, data);
+    }
+    else
+    {
+        if (bus_memory)
+        {
+            bus_memory[abs_address] = data;
+        }
+        else
+        {
+            ADDRESS[abs_address] = data;
+        }
+        bus_page_epoch[page] = bus_epoch;
+    }
+
+    for (int i = 0; i < write_hook_count; i++)
+    {
+        write_hooks[i](write_hook_ctx[i], abs_address, data);
+    }
 }
 
+bool bus_add_write_hook(bus_write_hook hook, void *ctx)
+{
+    if (write_hook_count == BUS_MAX_WRITE_HOOKS)
+    {
+        return false;
+    }
+    write_hooks[write_hook_count] = hook;
+    write_hook_ctx[write_hook_count] = ctx;
+    write_hook_count++;
+    return true;
+}
+
+void bus_remove_write_hook(bus_write_hook hook, void *ctx)
+{
+    for (int i = 0; i < write_hook_count; i++)
+    {
+        if (write_hooks[i] == hook && write_hook_ctx[i] == ctx)
+        {
+            // Keep remaining hooks in install order.
+            for (int j = i + 1; j < write_hook_count; j++)
+            {
+                write_hooks[j - 1] = write_hooks[j];
+                write_hook_ctx[j - 1] = write_hook_ctx[j];
+            }
+            write_hook_count--;
+            return;
+        }
+    }
+}
+
+void bus_map_io(uint8_t page, bus_io_read read, bus_io_write write, void *ctx)
+{
+    io_pages[page].read = read;
+    io_pages[page].write = write;
+    io_pages[page].ctx = ctx;
+    io_mapped[page] = (read != NULL || write != NULL);
+}
+
+bus_io bus_get_io(uint8_t page)
+{
+    return io_pages[page];
+}
+
+uint32_t bus_new_epoch(void)
+{
+    return ++bus_epoch;
+}
+
+bool bus_page_dirty(uint8_t page, uint32_t epoch)
+{
+    return bus_page_epoch[page] >= epoch;
+}
+
+void bus_touch_page(uint8_t page)
+{
+    bus_page_epoch[page] = bus_epoch;
+}
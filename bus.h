@@ -1,17 +1,117 @@
 //bus.h
 
+#ifndef BUS_H
+#define BUS_H
+
 #include <stdint.h>
 #include <stdbool.h>
 
 // Change cpu_read and cpu_write to access hardware your trying to emulate.
 
+/*
+Machine state (cpu registers, memory, hooks and io handlers) is thread local, so every thread
+runs its own independent machine. The instruction lookup table is shared and read only.
+*/
+#define C6502_THREAD_LOCAL _Thread_local
+
 // The 6502 has a 16 bit address space alowing it directly access 2^16 = 64KB of memory.
 
-extern uint8_t ADDRESS[65536];
+extern C6502_THREAD_LOCAL uint8_t ADDRESS[65536];
+
+extern C6502_THREAD_LOCAL uint8_t DATABUS; // Data from busline.
+
+/*
+Memory used by cpu_read() and cpu_write() instead of ADDRESS when not NULL.
+Lets an engine run the interpreter on memory of its own, like the lanes of the lockstep engine.
+*/
+extern C6502_THREAD_LOCAL uint8_t *bus_memory;
+
+// Maximum number of write hooks that can be installed at once.
+#define BUS_MAX_WRITE_HOOKS 8
+
+/*
+Write hook called by cpu_write() after memory has been updated.
+ctx is the pointer given to bus_add_write_hook().
+*/
+typedef void (*bus_write_hook)(void *ctx, uint16_t abs_address, uint8_t data);
+
+/*
+Dirty page tracking.
+cpu_write() stamps the 256 byte page it writes with the current epoch. bus_new_epoch() starts a
+new epoch and returns it. A page was written after that call if bus_page_epoch[page] >= epoch.
+Each user keeps its own epoch, so any number of users can track dirty pages independently.
+*/
+extern C6502_THREAD_LOCAL uint32_t bus_page_epoch[256];
+
+/*
+Memory mapped io.
+A page mapped with bus_map_io() sends reads and writes to a device instead of ADDRESS.
+Either handler may be NULL, in which case that direction still goes to ADDRESS.
+*/
+typedef uint8_t (*bus_io_read)(void *ctx, uint16_t abs_address);
+typedef void (*bus_io_write)(void *ctx, uint16_t abs_address, uint8_t data);
+
+typedef struct
+{
+    bus_io_read read;
+    bus_io_write write;
+    void *ctx;
+} bus_io;
+
+/*
+Access heatmap.
+While bus_heat is not NULL every cpu_read(), cpu_write() and cpu_fetch() adds one to the counter
+of its 256 byte page, and to the counter of its address when addresses is not NULL. Accesses to
+io pages are counted too. heatmap.h allocates, exports and summarizes heatmaps.
+*/
+typedef enum
+{
+    BUS_READ,
+    BUS_WRITE,
+    BUS_FETCH,
+    BUS_ACCESS_KINDS,
+} bus_access;
 
-extern uint8_t DATABUS; // Data from busline.
+typedef struct
+{
+    uint64_t pages[BUS_ACCESS_KINDS][256];
+    uint64_t (*addresses)[65536]; // [BUS_ACCESS_KINDS][65536], or NULL for pages only
+} bus_heatmap;
+
+extern C6502_THREAD_LOCAL bus_heatmap *bus_heat;
 
 uint8_t cpu_read(uint16_t abs_address);
 
+// Read an instruction byte: the opcode or an operand. Same as cpu_read() but counted as a fetch.
+uint8_t cpu_fetch(uint16_t abs_address);
+
 void cpu_write(uint16_t abs_address, uint8_t data);
 
+/*
+Read memory for a debugger or tracer. Bypasses io handlers, the heatmap and DATABUS, so looking at
+memory does not change what the emulated machine sees or what the heatmap counts.
+*/
+uint8_t bus_peek(uint16_t abs_address);
+
+// Install write hook. Return false if all hook slots are in use.
+bool bus_add_write_hook(bus_write_hook hook, void *ctx);
+
+// Remove a write hook installed with the same hook and ctx.
+void bus_remove_write_hook(bus_write_hook hook, void *ctx);
+
+// Map page to device handlers. Pass NULL handlers to unmap the page.
+void bus_map_io(uint8_t page, bus_io_read read, bus_io_write write, void *ctx);
+
+// Return the handlers mapped to page. Both handlers are NULL if the page is plain memory.
+bus_io bus_get_io(uint8_t page);
+
+// Start a new epoch. Return its number.
+uint32_t bus_new_epoch(void);
+
+// Return true if page was written since epoch.
+bool bus_page_dirty(uint8_t page, uint32_t epoch);
+
+// Mark page as written. Use after changing ADDRESS directly, for example when restoring state.
+void bus_touch_page(uint8_t page);
+
+#endif
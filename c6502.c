@@ -10,9 +10,537 @@ M7  memory bit 7
 */
 
 #include "c6502.h"
+#include "profile.h"
 
 // Global variable definition
-c6502_cpu c6502;
+C6502_THREAD_LOCAL c6502_cpu c6502;
+C6502_THREAD_LOCAL c6502_interrupt_hook c6502_on_interrupt = NULL;
+C6502_THREAD_LOCAL c6502_event_counts c6502_events;
+
+/*------------------------------------------------------------------------------------
+6502 instruction lookup table using opcode as the key:
+Instuction name, Function Pointer, Address Mode, and Number of Cycles:
+
+Note: Opcode names listed below with an * in front of them are illegal opcodes implemented.
+      Opcode UNK is a placeholder for illegal opcodes yet to be implemented.
+      The 65C02 has a table of its own in c65c02.c.
+----------------------------------------------------------------------------------------*/
+#if !C6502_CMOS
+c6502_instruction lookup_table[256] = {
+    // 0x00
+    {"BRK", &BRK, &IMPL, 7},
+    // 0x01
+    {"ORA", &ORA, &IND_X, 6},
+    // 0x02
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x03
+    {"*SLO", &SLO, &IND_X, 8},
+    // 0x04
+    {"*NOP", &NOP, &ZPG, 3},
+    // 0x05
+    {"ORA", &ORA, &ZPG, 3},
+    // 0x06
+    {"ASL", &ASL, &ZPG, 5},
+    // 0x07
+    {"*SLO", &SLO, &ZPG, 5},
+    // 0x08
+    {"PHP", &PHP, &IMPL, 3},
+    // 0x09
+    {"ORA", &ORA, &IMMED, 2},
+    // 0x0A
+    {"ASL", &ASL, &A, 2},
+    // 0x0B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x0C
+    {"*NOP", &NOP, &ABS, 4},
+    // 0x0D
+    {"ORA", &ORA, &ABS, 4},
+    // 0x0E
+    {"ASL", &ASL, &ABS, 6},
+    // 0x0F
+    {"*SLO", &SLO, &ABS, 6},
+    // 0x10
+    {"BPL", &BPL, &REL, 2},
+    // 0x11
+    {"ORA", &ORA, &IND_Y, 5},
+    // 0x12
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x13
+    {"*SLO", &SLO, &IND_Y, 8},
+    // 0x14
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0x15
+    {"ORA", &ORA, &ZPG_X, 4},
+    // 0x16
+    {"ASL", &ASL, &ZPG_X, 6},
+    // 0x17
+    {"*SLO", &SLO, &ZPG_X, 6},
+    // 0x18
+    {"CLC", &CLC, &IMPL, 2},
+    // 0x19
+    {"ORA", &ORA, &ABS_Y, 4},
+    // 0x1A
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0x1B
+    {"*SLO", &SLO, &ABS_Y, 7},
+    // 0x1C
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0x1D
+    {"ORA", &ORA, &ABS_X, 4},
+    // 0x1E
+    {"ASL", &ASL, &ABS_X, 7},
+    // 0x1F
+    {"*SLO", &SLO, &ABS_X, 7},
+    // 0x20
+    {"JSR", &JSR, &ABS, 6},
+    // 0x21
+    {"AND", &AND, &IND_X, 6},
+    // 0x22
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x23
+    {"*RLA", &RLA, &IND_X, 8},
+    // 0x24
+    {"BIT", &BIT, &ZPG, 3},
+    // 0x25
+    {"AND", &AND, &ZPG, 3},
+    // 0x26
+    {"ROL", &ROL, &ZPG, 5},
+    // 0x27
+    {"*RLA", &RLA, &ZPG, 5},
+    // 0x28
+    {"PLP", &PLP, &IMPL, 4},
+    // 0x29
+    {"AND", &AND, &IMMED, 2},
+    // 0x2A
+    {"ROL", &ROL, &A, 2},
+    // 0x2B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x2C
+    {"BIT", &BIT, &ABS, 4},
+    // 0x2D
+    {"AND", &AND, &ABS, 4},
+    // 0x2E
+    {"ROL", &ROL, &ABS, 6},
+    // 0x2F
+    {"*RLA", &RLA, &ABS, 6},
+    // 0x30
+    {"BMI", &BMI, &REL, 2},
+    // 0x31
+    {"AND", &AND, &IND_Y, 5},
+    // 0x32
+    {"*JAM", &JAM, &NONE, -1},
+    // 0X33
+    {"*RLA", &RLA, &IND_Y, 8},
+    // 0x34
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0x35
+    {"AND", &AND, &ZPG_X, 4},
+    // 0x36
+    {"ROL", &ROL, &ZPG_X, 6},
+    // 0x37
+    {"*RLA", &RLA, &ZPG_X, 6},
+    // 0x38
+    {"SEC", &SEC, &IMPL, 2},
+    // 0x39
+    {"AND", &AND, &ABS_Y, 4},
+    // 0x3A
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0x3B
+    {"*RLA", &RLA, &ABS_Y, 7},
+    // 0x3C
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0x3D
+    {"AND", &AND, &ABS_X, 4},
+    // 0x3E
+    {"ROL", &ROL, &ABS_X, 7},
+    // 0x3F
+    {"*RLA", &RLA, &ABS_X, 7},
+    // 0x40
+    {"RTI", &RTI, &IMPL, 6},
+    // 0x41
+    {"EOR", &EOR, &IND_X, 6},
+    // 0x42
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x43
+    {"*SRE", &SRE, &IND_X, 8},
+    // 0x44
+    {"*NOP", &NOP, &ZPG, 3},
+    // 0x45
+    {"EOR", &EOR, &ZPG, 3},
+    // 0x46
+    {"LSR", &LSR, &ZPG, 5},
+    // 0x47
+    {"*SRE", &SRE, &ZPG, 5},
+    // 0x48
+    {"PHA", &PHA, &IMPL, 3},
+    // 0x49
+    {"EOR", &EOR, &IMMED, 2},
+    // 0x4A
+    {"LSR", &LSR, &A, 2},
+    // 0x4B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x4C
+    {"JMP", &JMP, &ABS, 3},
+    // 0x4D
+    {"EOR", &EOR, &ABS, 4},
+    // 0x4E
+    {"LSR", &LSR, &ABS, 6},
+    // 0x4F
+    {"*SRE", &SRE, &ABS, 6},
+    // 0x50
+    {"BVC", &BVC, &REL, 2},
+    // 0x51
+    {"EOR", &EOR, &IND_Y, 5},
+    // 0x52
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x53
+    {"*SRE", &SRE, &IND_Y, 8},
+    // 0x54
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0x55
+    {"EOR", &EOR, &ZPG_X, 4},
+    // 0x56
+    {"LSR", &LSR, &ZPG_X, 6},
+    // 0x57
+    {"*SRE", &SRE, &ZPG_X, 6},
+    // 0x58
+    {"CLI", &CLI, &IMPL, 2},
+    // 0x59
+    {"EOR", &EOR, &ABS_Y, 4},
+    // 0x5A
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0x5B
+    {"*SRE", &SRE, &ABS_Y, 7},
+    // 0x5C
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0x5D
+    {"EOR", &EOR, &ABS_X, 4},
+    // 0x5E
+    {"LSR", &LSR, &ABS_X, 7},
+    // 0x5F
+    {"*SRE", &SRE, &ABS_X, 7},
+    // 0x60
+    {"RTS", &RTS, &IMPL, 6},
+    // 0x61
+    {"ADC", &ADC, &IND_X, 6},
+    // 0x62
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x63
+    {"*RRA", &RRA, &IND_X, 8},
+    // 0x64
+    {"*NOP", &NOP, &ZPG, 3},
+    // 0x65
+    {"ADC", &ADC, &ZPG, 3},
+    // 0x66
+    {"ROR", &ROR, &ZPG, 5},
+    // 0x67
+    {"*RRA", &RRA, &ZPG, 5},
+    // 0x68
+    {"PLA", &PLA, &IMPL, 4},
+    // 0x69
+    {"ADC", &ADC, &IMMED, 2},
+    // 0x6A
+    {"ROR", &ROR, &A, 2},
+    // 0x6B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x6C
+    {"JMP", &JMP, &IND, 5},
+    // 0x6D
+    {"ADC", &ADC, &ABS, 4},
+    // 0x6E
+    {"ROR", &ROR, &ABS, 6},
+    // 0x6F
+    {"*RRA", &RRA, &ABS, 6},
+    // 0x70
+    {"BVS", &BVS, &REL, 2},
+    // 0x71
+    {"ADC", &ADC, &IND_Y, 5},
+    // 0x72
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x73
+    {"*RRA", &RRA, &IND_Y, 8},
+    // 0x74
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0x75
+    {"ADC", &ADC, &ZPG_X, 4},
+    // 0x76
+    {"ROR", &ROR, &ZPG_X, 6},
+    // 0x77
+    {"*RRA", &RRA, &ZPG_X, 6},
+    // 0x78
+    {"SEI", &SEI, &IMPL, 2},
+    // 0x79
+    {"ADC", &ADC, &ABS_Y, 4},
+    // 0x7A
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0x7B
+    {"*RRA", &RRA, &ABS_Y, 7},
+    // 0x7C
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0x7D
+    {"ADC", &ADC, &ABS_X, 4},
+    // 0x7E
+    {"ROR", &ROR, &ABS_X, 7},
+    // 0x7F
+    {"*RRA", &RRA, &ABS_X, 7},
+    // 0x80
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x81
+    {"STA", &STA, &IND_X, 6},
+    // 0x82
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x83
+    {"*SAX", &SAX, &IND_X, 6},
+    // 0x84
+    {"STY", &STY, &ZPG, 3},
+    // 0x85
+    {"STA", &STA, &ZPG, 3},
+    // 0x86
+    {"STX", &STX, &ZPG, 3},
+    // 0x87
+    {"*SAX", &SAX, &ZPG, 3},
+    // 0x88
+    {"DEY", &DEY, &IMPL, 2},
+    // 0x89
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x8A
+    {"TXA", &TXA, &IMPL, 2},
+    // 0x8B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x8C
+    {"STY", &STY, &ABS, 4},
+    // 0x8D
+    {"STA", &STA, &ABS, 4},
+    // 0x8E
+    {"STX", &STX, &ABS, 4},
+    // 0x8F
+    {"*SAX", &SAX, &ABS, 4},
+    // 0x90
+    {"BCC", &BCC, &REL, 2},
+    // 0x91
+    {"STA", &STA, &IND_Y, 6},
+    // 0x92
+    {"*JAM", &JAM, &NONE, -1},
+    // 0x93
+    {"UNK", &UNK, &NONE, -1},
+    // 0x94
+    {"STY", &STY, &ZPG_X, 4},
+    // 0x95
+    {"STA", &STA, &ZPG_X, 4},
+    // 0x96
+    {"STX", &STX, &ZPG_Y, 4},
+    // 0x97
+    {"*SAX", &SAX, &ZPG_Y, 4},
+    // 0x98
+    {"TYA", &TYA, &IMPL, 2},
+    // 0x99
+    {"STA", &STA, &ABS_Y, 5},
+    // 0x9A
+    {"TXS", &TXS, &IMPL, 2},
+    // 0x9B
+    {"UNK", &UNK, &NONE, -1},
+    // 0x9C
+    {"UNK", &UNK, &NONE, -1},
+    // 0x9D
+    {"STA", &STA, &ABS_X, 5},
+    // 0x9E
+    {"UNK", &UNK, &NONE, -1},
+    // 0x9F
+    {"UNK", &UNK, &NONE, -1},
+    // 0xA0
+    {"LDY", &LDY, &IMMED, 2},
+    // 0xA1
+    {"LDA", &LDA, &IND_X, 6},
+    // 0xA2
+    {"LDX", &LDX, &IMMED, 2},
+    // 0xA3
+    {"*LAX", &LAX, &IND_X, 6},
+    // 0xA4
+    {"LDY", &LDY, &ZPG, 3},
+    // 0xA5
+    {"LDA", &LDA, &ZPG, 3},
+    // 0xA6
+    {"LDX", &LDX, &ZPG, 3},
+    // 0xA7
+    {"*LAX", &LAX, &ZPG, 3},
+    // 0xA8
+    {"TAY", &TAY, &IMPL, 2},
+    // 0XA9
+    {"LDA", &LDA, &IMMED, 2},
+    // 0xAA
+    {"TAX", &TAX, &IMPL, 2},
+    // 0xAB
+    {"UNK", &UNK, &NONE, -1},
+    // 0xAC
+    {"LDY", &LDY, &ABS, 4},
+    // 0xAD
+    {"LDA", &LDA, &ABS, 4},
+    // 0xAE
+    {"LDX", &LDX, &ABS, 4},
+    // 0xAF
+    {"*LAX", &LAX, &ABS, 4},
+    // 0xB0
+    {"BCS", &BCS, &REL, 2},
+    // 0xB1
+    {"LDA", &LDA, &IND_Y, 5},
+    // 0xB2
+    {"*JAM", &JAM, &NONE, -1},
+    // 0xB3
+    {"*LAX", &LAX, &IND_Y, 5},
+    // 0xB4
+    {"LDY", &LDY, &ZPG_X, 4},
+    // 0xB5
+    {"LDA", &LDA, &ZPG_X, 4},
+    // 0xB6
+    {"LDX", &LDX, &ZPG_Y, 4},
+    // 0xB7
+    {"*LAX", &LAX, &ZPG_Y, 4},
+    // 0xB8
+    {"CLV", &CLV, &IMPL, 2},
+    // 0xB9
+    {"LDA", &LDA, &ABS_Y, 4},
+    // 0xBA
+    {"TSX", &TSX, &IMPL, 2},
+    // 0xBB
+    {"UNK", &UNK, &NONE, -1},
+    // 0xBC
+    {"LDY", &LDY, &ABS_X, 4},
+    // 0xBD
+    {"LDA", &LDA, &ABS_X, 4},
+    // 0xBE
+    {"LDX", &LDX, &ABS_Y, 4},
+    // 0XBF
+    {"*LAX", &LAX, &ABS_Y, 4},
+    // 0xC0
+    {"CPY", &CPY, &IMMED, 2},
+    // 0xC1
+    {"CMP", &CMP, &IND_X, 6},
+    // 0xC2
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0xC3
+    {"*DCP", &DCP, &IND_X, 8},
+    // 0xC4
+    {"CPY", &CPY, &ZPG, 3},
+    // 0xC5
+    {"CMP", &CMP, &ZPG, 3},
+    // 0xC6
+    {"DEC", &DEC, &ZPG, 5},
+    // 0xC7
+    {"*DCP", &DCP, &ZPG, 5},
+    // 0xC8
+    {"INY", &INY, &IMPL, 2},
+    // 0xC9
+    {"CMP", &CMP, &IMMED, 2},
+    // 0xCA
+    {"DEX", &DEX, &IMPL, 2},
+    // 0xCB
+    {"UNK", &UNK, &NONE, -1},
+    // 0xCC
+    {"CPY", &CPY, &ABS, 4},
+    // 0XCD
+    {"CMP", &CMP, &ABS, 4},
+    // 0xCE
+    {"DEC", &DEC, &ABS, 6},
+    // 0xCF
+    {"*DCP", &DCP, &ABS, 6},
+    // 0xD0
+    {"BNE", &BNE, &REL, 2},
+    // 0xD1
+    {"CMP", &CMP, &IND_Y, 5},
+    // 0xD2
+    {"*JAM", &JAM, &NONE, -1},
+    // 0xD3
+    {"*DCP", &DCP, &IND_Y, 8},
+    // 0xD4
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0xD5
+    {"CMP", &CMP, &ZPG_X, 4},
+    // 0xD6
+    {"DEC", &DEC, &ZPG_X, 6},
+    // 0xD7
+    {"*DCP", &DCP, &ZPG_X, 6},
+    // 0xD8
+    {"CLD", &CLD, &IMPL, 2},
+    // 0xD9
+    {"CMP", &CMP, &ABS_Y, 4},
+    // 0xDA
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0xDB
+    {"*DCP", &DCP, &ABS_Y, 7},
+    // 0xDC
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0xDD
+    {"CMP", &CMP, &ABS_X, 4},
+    // 0xDE
+    {"DEC", &DEC, &ABS_X, 7},
+    // 0xDF
+    {"*DCP", &DCP, &ABS_X, 7},
+    // 0xE0
+    {"CPX", &CPX, &IMMED, 2},
+    // 0xE1
+    {"SBC", &SBC, &IND_X, 6},
+    // 0xE2
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0xE3
+    {"*ISB", &ISB, &IND_X, 8},
+    // 0xE4
+    {"CPX", &CPX, &ZPG, 3},
+    // 0xE5
+    {"SBC", &SBC, &ZPG, 3},
+    // 0xE6
+    {"INC", &INC, &ZPG, 5},
+    // 0xE7
+    {"*ISB", &ISB, &ZPG, 5},
+    // 0xE8
+    {"INX", &INX, &IMPL, 2},
+    // 0xE9
+    {"SBC", &SBC, &IMMED, 2},
+    // 0xEA
+    {"NOP", &NOP, &IMPL, 2},
+    // 0xEB
+    {"*SBC", &SBC, &IMMED, 2},
+    // 0xEC
+    {"CPX", &CPX, &ABS, 4},
+    // 0XED
+    {"SBC", &SBC, &ABS, 4},
+    // 0xEE
+    {"INC", &INC, &ABS, 6},
+    // 0xEF
+    {"*ISB", &ISB, &ABS, 6},
+    // 0xF0
+    {"BEQ", &BEQ, &REL, 2},
+    // 0xF1
+    {"SBC", &SBC, &IND_Y, 5},
+    // 0xF2
+    {"*JAM", &JAM, &NONE, -1},
+    // 0xF3
+    {"*ISB", &ISB, &IND_Y, 8},
+    // 0xF4
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0xF5
+    {"SBC", &SBC, &ZPG_X, 4},
+    // 0xF6
+    {"INC", &INC, &ZPG_X, 6},
+    // 0xF7
+    {"*ISB", &ISB, &ZPG_X, 6},
+    // 0xF8
+    {"SED", &SED, &IMPL, 2},
+    // 0xF9
+    {"SBC", &SBC, &ABS_Y, 4},
+    // 0xFA
+    {"*NOP", &NOP, &IMPL, 2},
+    // 0xFB
+    {"*ISB", &ISB, &ABS_Y, 7},
+    // 0xFC
+    {"*NOP", &NOP, &ABS_X, 4},
+    // 0xFD
+    {"SBC", &SBC, &ABS_X, 4},
+    // 0xFE
+    {"INC", &INC, &ABS_X, 7},
+    // 0xFF
+    {"*ISB", &ISB, &ABS_X, 7},
+};
+#endif
 
 /*
 c6502_init() Initialize 6502 processor to boot up state.
@@ -45,7 +573,50 @@ void c6502_init(uint8_t PC_MSB, uint8_t PC_LSB)
 // c6502_read_opcode() Fetch opcode
 void c6502_read_opcode()
 {
-    c6502.opcode = cpu_read(c6502.PC);
+    c6502.opcode = cpu_fetch(c6502.PC);
+}
+
+// c6502_execute() Advance Program Counter past the opcode and run the instruction.
+void c6502_execute()
+{
+    C6502_PROFILE_BEGIN();
+    c6502.PC++;
+    lookup_table[c6502.opcode].run();
+    C6502_RETIRE();
+    C6502_PROFILE_END();
+}
+
+// c6502_step() Fetch and run one instruction.
+void c6502_step()
+{
+    c6502_read_opcode();
+    c6502_execute();
+}
+
+/*
+c6502_instruction_bytes() Return instruction length in bytes.
+Implied, accumulator and placeholder (NONE) opcodes are a single byte.
+Absolute and indirect address modes take a two byte operand, all other modes one byte.
+*/
+uint8_t c6502_instruction_bytes(uint8_t opcode)
+{
+    void (*mode)(void) = lookup_table[opcode].address_mode;
+
+    if (mode == IMPL || mode == A || mode == NONE)
+    {
+        return 1;
+    }
+    else if (mode == ABS || mode == ABS_X || mode == ABS_Y || mode == IND)
+    {
+        return 3;
+    }
+#if C6502_CMOS
+    else if (mode == ABS_IND_X || mode == ZPG_REL)
+    {
+        return 3;
+    }
+#endif
+    return 2;
 }
 
 // c6502_set_status_flag() Set CPU flag
@@ -95,19 +666,28 @@ Instruction take 7 clock cycles
 */
 void c6502_irq()
 {
+    bool taken = (c6502_get_flag(I) == 0);
 
-    if (c6502_get_flag(I) == 0)
+    if (taken)
     {
         cpu_write(c6502_sp_abs(c6502.SP--), (c6502.PC >> 8) & 0x00FF);
         cpu_write(c6502_sp_abs(c6502.SP--), c6502.PC & 0x00FF);
         cpu_write(c6502_sp_abs(c6502.SP--), c6502.SR);
         c6502_set_status_flag(I, true);
         c6502_set_status_flag(B, false);
+#if C6502_CMOS
+        c6502_set_status_flag(D, false);
+#endif
         uint16_t LSB = (uint16_t)cpu_read(0xFFFE);
         uint16_t MSB = (uint16_t)cpu_read(0xFFFF) << 8;
         c6502.PC = MSB | LSB;
+        c6502_events.interrupts++;
+    }
+    C6502_CYCLES(7);
+    if (taken && c6502_on_interrupt)
+    {
+        c6502_on_interrupt(C6502_INTERRUPT_IRQ);
     }
-    c6502.cycles += 7;
 }
 
 /*
@@ -123,8 +703,16 @@ void c6502_nmi()
     cpu_write(c6502_sp_abs(c6502.SP--), c6502.SR);
     c6502_set_status_flag(I, true);
     c6502_set_status_flag(B, false);
+#if C6502_CMOS
+    c6502_set_status_flag(D, false);
+#endif
     c6502.PC = (uint16_t)cpu_read(0xFFFA) | (uint16_t)cpu_read(0xFFFB) << 8;
-    c6502.cycles += 7;
+    C6502_CYCLES(7);
+    c6502_events.interrupts++;
+    if (c6502_on_interrupt)
+    {
+        c6502_on_interrupt(C6502_INTERRUPT_NMI);
+    }
 }
 
 /*
@@ -161,7 +749,7 @@ void c6502_reset()
 
     // Pull the reset pin high to disable reset routine.
     c6502.reset_pin = 1;
-    c6502.cycles += 7;
+    C6502_CYCLES(7);
 }
 
 //----------------------
@@ -169,7 +757,10 @@ void c6502_reset()
 //----------------------
 
 // UNK() Unknown opcode. Use as place holder for illegal opcode not implemented yet.
-void UNK() {}
+void UNK()
+{
+    c6502_events.unknown++;
+}
 
 /*
 JAM() (KILL, HLT) *illegal opcode*
@@ -185,6 +776,177 @@ void JAM()
 {
     c6502.JAM = true;
     DATABUS = 0xFF;
+    c6502_events.jams++;
+}
+
+#if C6502_DECIMAL
+/*
+Decimal mode ADC and SBC results, indexed by C << 16 | A << 8 | operand. The low byte is the new
+accumulator, the high byte the new N, V, Z and C bits of SR. Built once at start up by
+c6502_decimal_tables(), read only afterwards and shared by all threads.
+*/
+static uint16_t decimal_add[0x20000];
+static uint16_t decimal_subtract[0x20000];
+
+// Pack a decimal result and its flags into a table entry.
+static uint16_t decimal_entry(uint8_t result, bool n, bool v, bool z, bool c)
+{
+    return result | (uint16_t)((n ? N : 0) | (v ? V : 0) | (z ? Z : 0) | (c ? C : 0)) << 8;
+}
+
+/*
+decimal_add_entry() Decimal A + operand + carry as the cpu variant computes it.
+
+Both nibbles are adjusted as the NMOS part does. N and V come from the sum after the low nibble
+adjust, before the high nibble adjust; Z comes from the binary sum. The 65C02 sets N and Z from
+the result.
+*/
+static uint16_t decimal_add_entry(uint8_t augend, uint8_t addend, uint8_t carry)
+{
+    uint16_t sum = augend + addend + carry;
+    uint16_t low = (augend & 0x0F) + (addend & 0x0F) + carry;
+    if (low >= 0x0A)
+    {
+        low = ((low + 0x06) & 0x0F) + 0x10;
+    }
+    uint16_t result = (augend & 0xF0) + (addend & 0xF0) + low;
+    bool n = result & 0x80;
+    bool v = (~(augend ^ addend)) & (augend ^ result) & 0x80;
+    bool z = (sum & 0x00FF) == 0;
+
+    if (result >= 0xA0)
+    {
+        result += 0x60;
+    }
+#if C6502_CMOS
+    n = result & 0x80;
+    z = (result & 0x00FF) == 0;
+#endif
+    return decimal_entry(result & 0x00FF, n, v, z, result >= 0x100);
+}
+
+/*
+decimal_subtract_entry() Decimal A - operand - !carry as the cpu variant computes it.
+
+The NMOS part adjusts the difference digit by digit and sets every flag from the binary
+difference. The 65C02 adjusts the binary difference and sets N and Z from the result.
+*/
+static uint16_t decimal_subtract_entry(uint8_t minuend, uint8_t subtrahend, uint8_t carry)
+{
+    int difference = (int)minuend - (int)subtrahend + carry - 1;
+    int low = (int)(minuend & 0x0F) - (int)(subtrahend & 0x0F) + carry - 1;
+    bool v = (minuend ^ subtrahend) & (minuend ^ difference) & 0x80;
+    int result;
+
+#if C6502_CMOS
+    result = difference;
+    if (result < 0)
+    {
+        result -= 0x60;
+    }
+    if (low < 0)
+    {
+        result -= 0x06;
+    }
+    return decimal_entry(result & 0xFF, result & 0x80, v, (result & 0xFF) == 0, difference >= 0);
+#else
+    if (low < 0)
+    {
+        low = ((low - 0x06) & 0x0F) - 0x10;
+    }
+    result = (int)(minuend & 0xF0) - (int)(subtrahend & 0xF0) + low;
+    if (result < 0)
+    {
+        result -= 0x60;
+    }
+    return decimal_entry(result & 0xFF, difference & 0x80, v, (difference & 0xFF) == 0, difference >= 0);
+#endif
+}
+
+// c6502_decimal_tables() Fill the decimal tables before main() runs.
+__attribute__((constructor)) static void c6502_decimal_tables(void)
+{
+    for (uint32_t i = 0; i < 0x20000; i++)
+    {
+        uint8_t carry = i >> 16;
+        uint8_t a = (i >> 8) & 0xFF;
+        uint8_t operand = i & 0xFF;
+
+        decimal_add[i] = decimal_add_entry(a, operand, carry);
+        decimal_subtract[i] = decimal_subtract_entry(a, operand, carry);
+    }
+}
+
+// Load A and N, V, Z, C from a decimal table entry. The 65C02 takes a cycle more.
+static inline void c6502_decimal_result(uint16_t entry)
+{
+    c6502.A = entry & 0x00FF;
+    c6502.SR = (c6502.SR & ~(N | V | Z | C)) | (entry >> 8);
+    C6502_CYCLES(C6502_CMOS);
+}
+#endif
+
+/*
+c6502_add() A + operand + C -> A, sets N, V, Z and C. Shared by ADC and RRA.
+Decimal mode (C6502_DECIMAL builds with D set) is one lookup in decimal_add.
+*/
+static void c6502_add(uint8_t operand)
+{
+    uint16_t augend = (uint16_t)c6502.A;
+    uint16_t addend = (uint16_t)operand;
+    uint8_t carry = c6502_get_flag(C);
+
+#if C6502_DECIMAL
+    if (c6502.SR & D)
+    {
+        c6502_decimal_result(decimal_add[carry << 16 | augend << 8 | addend]);
+        return;
+    }
+#endif
+
+    uint16_t sum = augend + addend + carry;
+
+    c6502.A = sum & 0x00FF;
+
+    c6502_set_status_flag(N, c6502.A & 0x80);
+    c6502_set_status_flag(Z, c6502.A == 0);
+    c6502_set_status_flag(C, sum & 0xFF00);
+    c6502_set_status_flag(V, (~(augend ^ addend)) & (augend ^ sum) & 0x80);
+}
+
+/*
+c6502_subtract() A - operand - C̅ -> A, sets N, V, Z and C. Shared by SBC and ISB.
+Decimal mode is one lookup in decimal_subtract.
+*/
+static void c6502_subtract(uint8_t operand)
+{
+    uint16_t minuend = (uint16_t)c6502.A;
+    uint16_t subtrahend = (uint16_t)operand;
+    uint8_t carry = c6502_get_flag(C);
+
+#if C6502_DECIMAL
+    if (c6502.SR & D)
+    {
+        c6502_decimal_result(decimal_subtract[carry << 16 | minuend << 8 | subtrahend]);
+        return;
+    }
+#endif
+
+    // Find the one's complement of the subtrahend by flipping the bits.
+    uint16_t ones_complement = subtrahend ^ 0x00FF;
+    // Find the two's complement of the subtrahend by adding the carry bit.
+    uint16_t twos_complement = ones_complement + carry;
+    // Add the two's complement to minuend
+    uint16_t difference = minuend + twos_complement;
+
+    c6502.A = difference & 0x00FF;
+
+    c6502_set_status_flag(N, c6502.A & 0x80);
+    c6502_set_status_flag(Z, c6502.A == 0);
+    c6502_set_status_flag(C, difference & 0xFF00);
+
+    // Overflow is an add of the one's complement: the carry must not flip the sign of the operand.
+    c6502_set_status_flag(V, (~(minuend ^ ones_complement) & (minuend ^ difference) & 0x80));
 }
 
 /*
@@ -207,18 +969,9 @@ void ADC()
 {
     lookup_table[c6502.opcode].address_mode();
 
-    uint16_t augend = (uint16_t)c6502.A;
-    uint16_t addend = (uint16_t)cpu_read(c6502.abs_address);
-    uint16_t sum = augend + addend + c6502_get_flag(C);
+    c6502_add(cpu_read(c6502.abs_address));
 
-    c6502.A = sum & 0x00FF;
-
-    c6502_set_status_flag(N, c6502.A & 0x80);
-    c6502_set_status_flag(Z, c6502.A == 0);
-    c6502_set_status_flag(C, sum & 0xFF00);
-    c6502_set_status_flag(V, (~(augend ^ addend)) & (augend ^ sum) & 0x80);
-
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -247,7 +1000,7 @@ void AND()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -285,7 +1038,7 @@ void ASL()
     c6502_set_status_flag(Z, (temp & 0x00FF) == 0x00);
     c6502_set_status_flag(C, (temp & 0xFF00) > 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -308,19 +1061,19 @@ void BCC()
     if (c6502_get_flag(C) == 0)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -339,19 +1092,19 @@ void BCS()
     if (c6502_get_flag(C) == 1)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -371,19 +1124,19 @@ void BEQ()
     {
 
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -416,7 +1169,7 @@ void BIT()
     c6502_set_status_flag(V, operand & V);
     c6502_set_status_flag(Z, results == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -435,19 +1188,19 @@ void BMI()
     if (c6502_get_flag(N) == 1)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -467,19 +1220,19 @@ void BNE()
     {
 
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -498,19 +1251,19 @@ void BPL()
     if (c6502_get_flag(N) == 0)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -521,22 +1274,31 @@ N	Z	C	I	D	V
 addressing	assembler	opc	bytes	cycles
 implied	    BRK	        00	1	    7
 
-Push PC MSB, PC LSB, and SR onto the stack. Set interrupt disable and break flag.
+Skip the padding byte after the opcode, so the return address is BRK + 2.
+Push PC MSB, PC LSB, and SR with the break flag set onto the stack. Set interrupt disable and break flag.
 
 Load vector (0xFFFE/0xFFFF) to Program Counter.
 */
 void BRK()
 {
-    uint16_t LSB = (uint16_t)cpu_read(c6502.PC++);
-    uint16_t MSB = (uint16_t)cpu_read(c6502.PC++);
+    cpu_fetch(c6502.PC++);
     cpu_write(c6502_sp_abs(c6502.SP--), (c6502.PC >> 8) & 0x00FF);
     cpu_write(c6502_sp_abs(c6502.SP--), c6502.PC & 0x00FF);
-    cpu_write(c6502_sp_abs(c6502.SP--), c6502.SR);
+    cpu_write(c6502_sp_abs(c6502.SP--), c6502.SR | B | U);
     c6502_set_status_flag(I, true);
     c6502_set_status_flag(B, true);
-    c6502.PC = (MSB << 8) | LSB;
+#if C6502_CMOS
+    c6502_set_status_flag(D, false);
+#endif
+    uint16_t LSB = (uint16_t)cpu_read(0xFFFE);
+    uint16_t MSB = (uint16_t)cpu_read(0xFFFF) << 8;
+    c6502.PC = MSB | LSB;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+    if (c6502_on_interrupt)
+    {
+        c6502_on_interrupt(C6502_INTERRUPT_BRK);
+    }
 }
 
 /*
@@ -555,19 +1317,19 @@ void BVC()
     if (c6502_get_flag(V) == 0)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -586,19 +1348,19 @@ void BVS()
     if (c6502_get_flag(V) == 1)
     {
         // add a cycle if the branch is taken
-        c6502.cycles++;
+        C6502_CYCLES(1);
 
         c6502.abs_address = c6502.PC + c6502.rel_address;
 
         // add another cycle if the branch crosses a page boundary.
         if ((c6502.abs_address & 0xFF00) != (c6502.PC & 0xFF00))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
         c6502.PC = c6502.abs_address;
     }
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -615,7 +1377,7 @@ void CLC()
 {
     c6502_set_status_flag(C, false);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -631,7 +1393,7 @@ void CLD()
 {
     c6502_set_status_flag(D, false);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -647,7 +1409,7 @@ void CLI()
 {
     c6502_set_status_flag(I, false);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -663,7 +1425,7 @@ void CLV()
 {
     c6502_set_status_flag(V, false);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -693,7 +1455,7 @@ void CMP()
     c6502_set_status_flag(Z, results == 0x00);
     c6502_set_status_flag(C, c6502.A >= temp);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -718,7 +1480,7 @@ void CPX()
     c6502_set_status_flag(Z, results == 0x00);
     c6502_set_status_flag(C, c6502.X >= temp);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -743,7 +1505,7 @@ void CPY()
     c6502_set_status_flag(Z, results == 0x00);
     c6502_set_status_flag(C, c6502.Y >= temp);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -781,7 +1543,7 @@ void DCP()
     c6502_set_status_flag(Z, results == 0x00);
     c6502_set_status_flag(C, c6502.A >= temp);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -807,7 +1569,7 @@ void DEC()
 
     cpu_write(c6502.abs_address, temp);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -826,7 +1588,7 @@ void DEX()
     c6502_set_status_flag(N, c6502.X & 0x80);
     c6502_set_status_flag(Z, c6502.X == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -845,7 +1607,7 @@ void DEY()
     c6502_set_status_flag(N, c6502.Y & 0x80);
     c6502_set_status_flag(Z, c6502.Y == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -875,7 +1637,7 @@ void EOR()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -901,7 +1663,7 @@ void INC()
 
     cpu_write(c6502.abs_address, results);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -920,7 +1682,7 @@ void INX()
     c6502_set_status_flag(N, c6502.X & 0x80);
     c6502_set_status_flag(Z, c6502.X == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -939,7 +1701,7 @@ void INY()
     c6502_set_status_flag(N, c6502.Y & 0x80);
     c6502_set_status_flag(Z, c6502.Y == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -972,24 +1734,9 @@ void ISB()
     c6502_set_status_flag(Z, results == 0x00);
 
     // SBC()
-    uint16_t minuend = (uint16_t)c6502.A;
-    uint16_t subtrahend = results;
-    // Find the one's complement of the subtrahend by flipping the bits.
-    uint16_t ones_complement = subtrahend ^ 0x00FF;
-    // Find the two's complement of the subtrahend by adding the carry bit.
-    uint16_t twos_complement = ones_complement + c6502_get_flag(C);
-    // Add the two's complement to minuend
-    uint16_t difference = minuend + twos_complement;
+    c6502_subtract(results);
 
-    c6502.A = difference & 0x00FF;
-
-    c6502_set_status_flag(N, c6502.A & 0x80);
-    c6502_set_status_flag(Z, c6502.A == 0);
-    c6502_set_status_flag(C, difference & 0xFF00);
-
-    c6502_set_status_flag(V, (~(minuend ^ twos_complement) & (minuend ^ difference) & 0x80));
-
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1009,7 +1756,7 @@ void JMP()
 
     c6502.PC = c6502.abs_address;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1035,7 +1782,7 @@ void JSR()
     // Point the Program counter to the New Jump location
     c6502.PC = c6502.abs_address;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1064,7 +1811,7 @@ void LAX()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1092,7 +1839,7 @@ void LDA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1117,7 +1864,7 @@ void LDX()
     c6502_set_status_flag(N, c6502.X & 0x80);
     c6502_set_status_flag(Z, c6502.X == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1142,7 +1889,7 @@ void LDY()
     c6502_set_status_flag(N, c6502.Y & 0x80);
     c6502_set_status_flag(Z, c6502.Y == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1184,7 +1931,7 @@ void LSR()
     c6502_set_status_flag(Z, temp == 0x00);
     c6502_set_status_flag(C, data & 0x01);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1232,7 +1979,7 @@ void NOP()
 {
     lookup_table[c6502.opcode].address_mode();
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1263,7 +2010,7 @@ void ORA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1279,7 +2026,7 @@ void PHA()
 {
     cpu_write(c6502_sp_abs(c6502.SP--), c6502.A);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1299,7 +2046,7 @@ void PHP()
 
     cpu_write(c6502_sp_abs(c6502.SP--), c6502.SR | B | U);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1318,7 +2065,7 @@ void PLA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1348,7 +2095,7 @@ void PLP()
     c6502_set_status_flag(B, break_flag);
     c6502_set_status_flag(U, unused_flag);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1386,7 +2133,7 @@ void RLA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1429,7 +2176,7 @@ void ROL()
     // Old MSB is shift into the carry flag.
     c6502_set_status_flag(C, temp & 0xFF00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1473,7 +2220,7 @@ void ROR()
     // Old LSB is shift into the carry flag.
     c6502_set_status_flag(C, temp | 0x0001);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1511,18 +2258,9 @@ void RRA()
     c6502_set_status_flag(C, temp | 0x0001);
 
     // ADC()
-    uint16_t augend = (uint16_t)c6502.A;
-    uint16_t addend = result;
-    uint16_t sum = augend + addend + c6502_get_flag(C);
-
-    c6502.A = sum & 0x00FF;
-
-    c6502_set_status_flag(N, c6502.A & 0x80);
-    c6502_set_status_flag(Z, c6502.A == 0);
-    c6502_set_status_flag(C, sum & 0xFF00);
-    c6502_set_status_flag(V, (~(augend ^ addend)) & (augend ^ sum) & 0x80);
+    c6502_add(result);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1556,7 +2294,7 @@ void RTI()
     // Set program counter address to what pull from the stack
     c6502.PC = (MSB << 8) | LSB;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1575,7 +2313,7 @@ void RTS()
     c6502.PC = (MSB << 8) | LSB;
     c6502.PC++;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1600,7 +2338,7 @@ void SAX()
 
     cpu_write(c6502.abs_address, results);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1624,24 +2362,9 @@ void SBC()
 {
     lookup_table[c6502.opcode].address_mode();
 
-    uint16_t minuend = (uint16_t)c6502.A;
-    uint16_t subtrahend = (uint16_t)cpu_read(c6502.abs_address);
-    // Find the one's complement of the subtrahend by flipping the bits.
-    uint16_t ones_complement = subtrahend ^ 0x00FF;
-    // Find the two's complement of the subtrahend by adding the carry bit.
-    uint16_t twos_complement = ones_complement + c6502_get_flag(C);
-    // Add the two's complement to minuend
-    uint16_t difference = minuend + twos_complement;
-
-    c6502.A = difference & 0x00FF;
-
-    c6502_set_status_flag(N, c6502.A & 0x80);
-    c6502_set_status_flag(Z, c6502.A == 0);
-    c6502_set_status_flag(C, difference & 0xFF00);
-
-    c6502_set_status_flag(V, (~(minuend ^ twos_complement) & (minuend ^ difference) & 0x80));
+    c6502_subtract(cpu_read(c6502.abs_address));
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1657,7 +2380,7 @@ void SEC()
 {
     c6502_set_status_flag(C, true);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1673,7 +2396,7 @@ void SED()
 {
     c6502_set_status_flag(D, true);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1689,7 +2412,7 @@ void SEI()
 {
     c6502_set_status_flag(I, true);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1727,7 +2450,7 @@ void SLO()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1764,7 +2487,7 @@ void SRE()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0x00);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1788,7 +2511,7 @@ void STA()
 
     cpu_write(c6502.abs_address, c6502.A);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1808,7 +2531,7 @@ void STX()
 
     cpu_write(c6502.abs_address, c6502.X);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1828,7 +2551,7 @@ void STY()
 
     cpu_write(c6502.abs_address, c6502.Y);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1847,7 +2570,7 @@ void TAX()
     c6502_set_status_flag(N, c6502.X & 0x80);
     c6502_set_status_flag(Z, c6502.X == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1866,7 +2589,7 @@ void TAY()
     c6502_set_status_flag(N, c6502.Y & 0x80);
     c6502_set_status_flag(Z, c6502.Y == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1885,7 +2608,7 @@ void TSX()
     c6502_set_status_flag(N, c6502.X & 0x80);
     c6502_set_status_flag(Z, c6502.X == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1904,7 +2627,7 @@ void TXA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1920,7 +2643,7 @@ void TXS()
 {
     c6502.SP = c6502.X;
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1939,7 +2662,7 @@ void TYA()
     c6502_set_status_flag(N, c6502.A & 0x80);
     c6502_set_status_flag(Z, c6502.A == 0);
 
-    c6502.cycles += lookup_table[c6502.opcode].cycles;
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
 }
 
 /*
@@ -1981,8 +2704,8 @@ void A()
 // Address Mode: Absolute
 void ABS()
 {
-    uint16_t LSB = (uint16_t)cpu_read(c6502.PC++);
-    uint16_t MSB = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t LSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t MSB = (uint16_t)cpu_fetch(c6502.PC++);
     c6502.abs_address = (MSB << 8) | LSB;
 }
 
@@ -2008,10 +2731,10 @@ absolute,X	    NOP     	    FC	3	    4*
 */
 void ABS_X()
 {
-    uint16_t LSB = (uint16_t)cpu_read(c6502.PC++);
-    uint16_t MSB = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t LSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t MSB = (uint16_t)cpu_fetch(c6502.PC++);
     c6502.abs_address = ((MSB << 8) | LSB) + c6502.X;
-    if (((c6502.abs_address & 0xFF00) != (MSB << 8)))
+    if (C6502_TIMED && (c6502.abs_address & 0xFF00) != (MSB << 8))
     {
         // ADD a cycle if Address mode is one of the following:
         if ((lookup_table[c6502.opcode].run == ADC) |
@@ -2022,9 +2745,15 @@ void ABS_X()
             (lookup_table[c6502.opcode].run == LDY) |
             (lookup_table[c6502.opcode].run == ORA) |
             (lookup_table[c6502.opcode].run == SBC) |
-            (lookup_table[c6502.opcode].run == NOP))
+            (lookup_table[c6502.opcode].run == NOP) |
+            // On the 65C02 page crossing also adds a cycle to shifts and rotates (6 + 1) and BIT abs,X (4 + 1).
+            (C6502_CMOS && ((lookup_table[c6502.opcode].run == ASL) |
+                            (lookup_table[c6502.opcode].run == LSR) |
+                            (lookup_table[c6502.opcode].run == ROL) |
+                            (lookup_table[c6502.opcode].run == ROR) |
+                            (lookup_table[c6502.opcode].run == BIT))))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
     }
 }
@@ -2045,10 +2774,10 @@ absolute,Y	    SBC oper,Y	    F9	3	    4*
 */
 void ABS_Y()
 {
-    uint16_t LSB = (uint16_t)cpu_read(c6502.PC++);
-    uint16_t MSB = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t LSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t MSB = (uint16_t)cpu_fetch(c6502.PC++);
     c6502.abs_address = ((MSB << 8) | LSB) + c6502.Y;
-    if ((c6502.abs_address & 0xFF00) != (MSB << 8))
+    if (C6502_TIMED && (c6502.abs_address & 0xFF00) != (MSB << 8))
     {
         // ADD a cycle if Address mode is one of the following:
         if ((lookup_table[c6502.opcode].run == ADC) |
@@ -2061,7 +2790,7 @@ void ABS_Y()
             (lookup_table[c6502.opcode].run == ORA) |
             (lookup_table[c6502.opcode].run == SBC))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
     }
 }
@@ -2078,16 +2807,17 @@ void IMPL() {}
 // Address Mode: Indirect
 void IND()
 {
-    uint16_t LSB = (uint16_t)cpu_read(c6502.PC++);
-    uint16_t MSB = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t LSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t MSB = (uint16_t)cpu_fetch(c6502.PC++);
 
     /*
     The original 6502 does not fetch the target address correctly in an indirect JMP() if the target address falls on a page boundary ($xxFF).
     In this case the LSB address is fetched as expected but the MSB is taken from $xx00 instead of $xxFF+1.
     So we need to replicate this for our nes test rom to pass its indirect JMP() test.
+    The 65C02 fixed the bug, at the cost of a cycle (JMP ($xxxx) takes 6 cycles there).
      */
     uint16_t ptr_address = (MSB << 8) | LSB;
-    if (LSB == 0x00FF)
+    if (!C6502_CMOS && LSB == 0x00FF)
     {
         c6502.abs_address = cpu_read(ptr_address & 0xFF00) << 8 | cpu_read(ptr_address);
     }
@@ -2100,7 +2830,7 @@ void IND()
 // Address Mode: Indirect X-indexed
 void IND_X()
 {
-    uint16_t temp = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t temp = (uint16_t)cpu_fetch(c6502.PC++);
     uint16_t LSB = (uint16_t)cpu_read((uint16_t)(temp + (uint16_t)c6502.X) & 0x00FF);
     uint16_t MSB = (uint16_t)cpu_read((uint16_t)(temp + 1 + (uint16_t)c6502.X) & 0x00FF);
     c6502.abs_address = (MSB << 8) | LSB;
@@ -2118,11 +2848,11 @@ Address Mode: Indirect Y-indexed
 */
 void IND_Y()
 {
-    uint16_t temp = (uint16_t)cpu_read(c6502.PC++);
+    uint16_t temp = (uint16_t)cpu_fetch(c6502.PC++);
     uint16_t LSB = (uint16_t)cpu_read((uint16_t)(temp) & 0x00FF);
     uint16_t MSB = (uint16_t)cpu_read((uint16_t)(temp + 1) & 0x00FF);
     c6502.abs_address = ((MSB << 8) | LSB) + c6502.Y;
-    if ((c6502.abs_address & 0xFF00) != (MSB << 8))
+    if (C6502_TIMED && (c6502.abs_address & 0xFF00) != (MSB << 8))
     {
         // ADD a cycle if Address mode is one of the following:
         if ((lookup_table[c6502.opcode].run == ADC) |
@@ -2134,7 +2864,7 @@ void IND_Y()
             (lookup_table[c6502.opcode].run == ORA) |
             (lookup_table[c6502.opcode].run == SBC))
         {
-            c6502.cycles++;
+            C6502_CYCLES(1);
         }
     }
 }
@@ -2143,7 +2873,7 @@ void IND_Y()
 void REL()
 {
 
-    uint8_t temp = cpu_read(c6502.PC++);
+    uint8_t temp = cpu_fetch(c6502.PC++);
     c6502.rel_address = temp & 0x00FF;
     if (temp & 0x80)
     {
@@ -2154,14 +2884,14 @@ void REL()
 // Address Mode: Zero Page
 void ZPG()
 {
-    c6502.abs_address = cpu_read(c6502.PC++);
+    c6502.abs_address = cpu_fetch(c6502.PC++);
     c6502.abs_address &= 0x00FF;
 }
 
 // Address Mode: Zero Page X-indexed
 void ZPG_X()
 {
-    c6502.abs_address = cpu_read(c6502.PC++) + c6502.X;
+    c6502.abs_address = cpu_fetch(c6502.PC++) + c6502.X;
 
     c6502.abs_address &= 0x00FF;
 }
@@ -2169,7 +2899,7 @@ void ZPG_X()
 // Address Mode: Zero Page Y-indexed
 void ZPG_Y()
 {
-    c6502.abs_address = cpu_read(c6502.PC++) + c6502.Y;
+    c6502.abs_address = cpu_fetch(c6502.PC++) + c6502.Y;
     c6502.abs_address &= 0x00FF;
 }
 
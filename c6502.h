@@ -1,5 +1,8 @@
 // c6502.h
 
+#ifndef C6502_H
+#define C6502_H
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -18,6 +21,67 @@ typedef enum
     N = 0b10000000, // Negative
 } c6502_status_flags;
 
+/*
+Untimed engine, compiled in with -DC6502_UNTIMED (the c6502-batch-untimed program).
+
+The handlers skip all cycle bookkeeping: base cycles, taken branch and page crossing penalties
+and interrupt entry cycles. c6502.cycles counts retired instructions instead, one per
+instruction run by c6502_execute(). Results in memory and registers are unchanged.
+
+Code that needs real timing (cycle columns of traces, cycle checks, the profiler, devices clocked
+from c6502.cycles) tests C6502_TIMED and refuses to build or run untimed. C6502_TIMING names the
+engine for reports.
+*/
+#ifdef C6502_UNTIMED
+#define C6502_TIMED 0
+#define C6502_TIMING "untimed"
+#define C6502_CYCLES(n) ((void)0)
+#define C6502_RETIRE() (c6502.cycles++)
+#else
+#define C6502_TIMED 1
+#define C6502_TIMING "timed"
+#define C6502_CYCLES(n) (c6502.cycles += (n))
+#define C6502_RETIRE() ((void)0)
+#endif
+
+/*
+Cpu variant, chosen at compile time with -DC6502_VARIANT=C6502_VARIANT_<name>:
+
+C6502_VARIANT_2A03   NES cpu, the default: NMOS core with the decimal mode circuit cut, so D
+                     is stored but ADC and SBC stay binary. Illegal opcodes as on the NMOS part.
+C6502_VARIANT_NMOS   NMOS 6502 with decimal mode ADC and SBC, including the RRA and ISB illegal
+                     opcodes, and N, V and Z as the NMOS part computes them.
+C6502_VARIANT_65C02  WDC 65C02: new opcodes and (zp) address mode, Rockwell bit opcodes, WAI
+                     and STP, undefined opcodes are NOPs. JMP ($xxFF) reads across the page,
+                     decimal mode sets N and Z from the result and takes a cycle more, and
+                     interrupts clear D. Its lookup_table is defined in c65c02.c.
+
+The differences are #if blocks and compile time constants, so the handlers of a variant carry no
+run time variant checks. C6502_VARIANT_NAME names the variant for reports.
+*/
+#define C6502_VARIANT_2A03 0
+#define C6502_VARIANT_NMOS 1
+#define C6502_VARIANT_65C02 2
+
+#ifndef C6502_VARIANT
+#define C6502_VARIANT C6502_VARIANT_2A03
+#endif
+
+#if C6502_VARIANT == C6502_VARIANT_2A03
+#define C6502_VARIANT_NAME "2A03"
+#elif C6502_VARIANT == C6502_VARIANT_NMOS
+#define C6502_VARIANT_NAME "NMOS 6502"
+#elif C6502_VARIANT == C6502_VARIANT_65C02
+#define C6502_VARIANT_NAME "65C02"
+#else
+#error "C6502_VARIANT must be C6502_VARIANT_2A03, C6502_VARIANT_NMOS or C6502_VARIANT_65C02"
+#endif
+
+// 1 if ADC and SBC honour the D flag.
+#define C6502_DECIMAL (C6502_VARIANT != C6502_VARIANT_2A03)
+// 1 for the CMOS instruction set and bug fixes.
+#define C6502_CMOS (C6502_VARIANT == C6502_VARIANT_65C02)
+
 // Struct definition for 6502 cpu state and register
 typedef struct
 {
@@ -27,7 +91,7 @@ typedef struct
     uint8_t SP;           // Stack pointer 0x0100-0x01FF
     uint8_t X;            // X register
     uint8_t Y;            // Y register
-    uint16_t cycles;      // Variable to keep track of cpu cycles
+    uint64_t cycles;      // Variable to keep track of cpu cycles, instructions when untimed
     uint16_t abs_address; // Variable to keep track of absolute address
     uint16_t rel_address; // Variable to keep track of relative address
     uint8_t opcode;       // Variable to keep track of cpu opcode fetched. Using the fetch_opcode() function
@@ -36,7 +100,7 @@ typedef struct
 } c6502_cpu;
 
 // Struct used to manipulate state of 6502 computer
-extern c6502_cpu c6502;
+extern C6502_THREAD_LOCAL c6502_cpu c6502;
 
 // Struct used for lookup table
 typedef struct
@@ -56,6 +120,18 @@ void c6502_init(uint8_t PC_MSB, uint8_t PC_LSB);
 // fetch opcode.
 void c6502_read_opcode();
 
+// Run the instruction fetched by c6502_read_opcode().
+void c6502_execute();
+
+// Fetch and run one instruction.
+void c6502_step();
+
+/*
+Return the number of bytes (opcode plus operands) used by an instruction.
+The length is derived from the address mode in the lookup table.
+*/
+uint8_t c6502_instruction_bytes(uint8_t opcode);
+
 // set 6502 status flag
 void c6502_set_status_flag(c6502_status_flags flag, bool x);
 
@@ -84,6 +160,32 @@ Instruction take 7 clock cycles
 */
 void c6502_nmi();
 
+// Interrupt kinds reported to c6502_on_interrupt.
+typedef enum
+{
+    C6502_INTERRUPT_IRQ,
+    C6502_INTERRUPT_NMI,
+    C6502_INTERRUPT_BRK,
+} c6502_interrupt;
+
+typedef void (*c6502_interrupt_hook)(c6502_interrupt kind);
+
+/*
+Called after the cpu entered an interrupt handler: return address and SR pushed, PC loaded.
+A masked IRQ is not reported. NULL when no one listens.
+*/
+extern C6502_THREAD_LOCAL c6502_interrupt_hook c6502_on_interrupt;
+
+// Rare cpu events, counted for telemetry. Running totals, never cleared by the core.
+typedef struct
+{
+    uint64_t interrupts; // IRQs taken plus NMIs
+    uint64_t jams;       // JAM opcodes run
+    uint64_t unknown;    // UNK placeholder opcodes run
+} c6502_event_counts;
+
+extern C6502_THREAD_LOCAL c6502_event_counts c6502_events;
+
 /*
 c6502_reset() Reset 6502 cpu.
 Load vector (0xFFFC/0xFFFD) to Program Counter.
@@ -164,6 +266,24 @@ void TXA(); // Transfer X to accumulator
 void TXS(); // Transfer X to stack pointer
 void TYA(); // Transfer Y to accumulator
 
+#if C6502_CMOS
+// 65C02 opcodes, defined in c65c02.c.
+void BRA(); // Branch always
+void BBR(); // Branch on bit reset (bit number in opcode bits 4-6)
+void BBS(); // Branch on bit set
+void PHX(); // Push X
+void PHY(); // Push Y
+void PLX(); // Pull X
+void PLY(); // Pull Y
+void RMB(); // Reset memory bit
+void SMB(); // Set memory bit
+void STP(); // Stop the clock until reset
+void STZ(); // Store zero
+void TRB(); // Test and reset bits
+void TSB(); // Test and set bits
+void WAI(); // Wait for interrupt
+#endif
+
 /*-----------
 Address Mode
 ------------*/
@@ -183,524 +303,13 @@ void ZPG_X(); // Zero Page X-indexed
 void ZPG_Y(); // Zero Page Y-indexed
 void NONE();  // None
 
-/*------------------------------------------------------------------------------------
-6502 instruction lookup table using opcode as the key:
-Instuction name, Function Pointer, Address Mode, and Number of Cycles:
-
-Note: Opcode names listed below with an * in front of them are illegal opcodes implemented.
-      Opcode UNK is a placeholder for illegal opcodes yet to be implemented.
-----------------------------------------------------------------------------------------*/
-static c6502_instruction lookup_table[256] = {
-    // 0x00
-    {"BRK", &BRK, &IMPL, 7},
-    // 0x01
-    {"ORA", &ORA, &IND_X, 6},
-    // 0x02
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x03
-    {"*SLO", &SLO, &IND_X, 8},
-    // 0x04
-    {"*NOP", &NOP, &ZPG, 3},
-    // 0x05
-    {"ORA", &ORA, &ZPG, 3},
-    // 0x06
-    {"ASL", &ASL, &ZPG, 5},
-    // 0x07
-    {"*SLO", &SLO, &ZPG, 5},
-    // 0x08
-    {"PHP", &PHP, &IMPL, 3},
-    // 0x09
-    {"ORA", &ORA, &IMMED, 2},
-    // 0x0A
-    {"ASL", &ASL, &A, 2},
-    // 0x0B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x0C
-    {"*NOP", &NOP, &ABS, 4},
-    // 0x0D
-    {"ORA", &ORA, &ABS, 4},
-    // 0x0E
-    {"ASL", &ASL, &ABS, 6},
-    // 0x0F
-    {"*SLO", &SLO, &ABS, 6},
-    // 0x10
-    {"BPL", &BPL, &REL, 2},
-    // 0x11
-    {"ORA", &ORA, &IND_Y, 5},
-    // 0x12
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x13
-    {"*SLO", &SLO, &IND_Y, 8},
-    // 0x14
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0x15
-    {"ORA", &ORA, &ZPG_X, 4},
-    // 0x16
-    {"ASL", &ASL, &ZPG_X, 6},
-    // 0x17
-    {"*SLO", &SLO, &ZPG_X, 6},
-    // 0x18
-    {"CLC", &CLC, &IMPL, 2},
-    // 0x19
-    {"ORA", &ORA, &ABS_Y, 4},
-    // 0x1A
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0x1B
-    {"*SLO", &SLO, &ABS_Y, 7},
-    // 0x1C
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0x1D
-    {"ORA", &ORA, &ABS_X, 4},
-    // 0x1E
-    {"ASL", &ASL, &ABS_X, 7},
-    // 0x1F
-    {"*SLO", &SLO, &ABS_X, 7},
-    // 0x20
-    {"JSR", &JSR, &ABS, 6},
-    // 0x21
-    {"AND", &AND, &IND_X, 6},
-    // 0x22
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x23
-    {"*RLA", &RLA, &IND_X, 8},
-    // 0x24
-    {"BIT", &BIT, &ZPG, 3},
-    // 0x25
-    {"AND", &AND, &ZPG, 3},
-    // 0x26
-    {"ROL", &ROL, &ZPG, 5},
-    // 0x27
-    {"*RLA", &RLA, &ZPG, 5},
-    // 0x28
-    {"PLP", &PLP, &IMPL, 4},
-    // 0x29
-    {"AND", &AND, &IMMED, 2},
-    // 0x2A
-    {"ROL", &ROL, &A, 2},
-    // 0x2B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x2C
-    {"BIT", &BIT, &ABS, 4},
-    // 0x2D
-    {"AND", &AND, &ABS, 4},
-    // 0x2E
-    {"ROL", &ROL, &ABS, 6},
-    // 0x2F
-    {"*RLA", &RLA, &ABS, 6},
-    // 0x30
-    {"BMI", &BMI, &REL, 2},
-    // 0x31
-    {"AND", &AND, &IND_Y, 5},
-    // 0x32
-    {"*JAM", &JAM, &NONE, -1},
-    // 0X33
-    {"*RLA", &RLA, &IND_Y, 8},
-    // 0x34
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0x35
-    {"AND", &AND, &ZPG_X, 4},
-    // 0x36
-    {"ROL", &ROL, &ZPG_X, 6},
-    // 0x37
-    {"*RLA", &RLA, &ZPG_X, 6},
-    // 0x38
-    {"SEC", &SEC, &IMPL, 2},
-    // 0x39
-    {"AND", &AND, &ABS_Y, 4},
-    // 0x3A
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0x3B
-    {"*RLA", &RLA, &ABS_Y, 7},
-    // 0x3C
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0x3D
-    {"AND", &AND, &ABS_X, 4},
-    // 0x3E
-    {"ROL", &ROL, &ABS_X, 7},
-    // 0x3F
-    {"*RLA", &RLA, &ABS_X, 7},
-    // 0x40
-    {"RTI", &RTI, &IMPL, 6},
-    // 0x41
-    {"EOR", &EOR, &IND_X, 6},
-    // 0x42
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x43
-    {"*SRE", &SRE, &IND_X, 8},
-    // 0x44
-    {"*NOP", &NOP, &ZPG, 3},
-    // 0x45
-    {"EOR", &EOR, &ZPG, 3},
-    // 0x46
-    {"LSR", &LSR, &ZPG, 5},
-    // 0x47
-    {"*SRE", &SRE, &ZPG, 5},
-    // 0x48
-    {"PHA", &PHA, &IMPL, 3},
-    // 0x49
-    {"EOR", &EOR, &IMMED, 2},
-    // 0x4A
-    {"LSR", &LSR, &A, 2},
-    // 0x4B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x4C
-    {"JMP", &JMP, &ABS, 3},
-    // 0x4D
-    {"EOR", &EOR, &ABS, 4},
-    // 0x4E
-    {"LSR", &LSR, &ABS, 6},
-    // 0x4F
-    {"*SRE", &SRE, &ABS, 6},
-    // 0x50
-    {"BVC", &BVC, &REL, 2},
-    // 0x51
-    {"EOR", &EOR, &IND_Y, 5},
-    // 0x52
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x53
-    {"*SRE", &SRE, &IND_Y, 8},
-    // 0x54
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0x55
-    {"EOR", &EOR, &ZPG_X, 4},
-    // 0x56
-    {"LSR", &LSR, &ZPG_X, 6},
-    // 0x57
-    {"*SRE", &SRE, &ZPG_X, 6},
-    // 0x58
-    {"CLI", &CLI, &IMPL, 2},
-    // 0x59
-    {"EOR", &EOR, &ABS_Y, 4},
-    // 0x5A
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0x5B
-    {"*SRE", &SRE, &ABS_Y, 7},
-    // 0x5C
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0x5D
-    {"EOR", &EOR, &ABS_X, 4},
-    // 0x5E
-    {"LSR", &LSR, &ABS_X, 7},
-    // 0x5F
-    {"*SRE", &SRE, &ABS_X, 7},
-    // 0x60
-    {"RTS", &RTS, &IMPL, 6},
-    // 0x61
-    {"ADC", &ADC, &IND_X, 6},
-    // 0x62
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x63
-    {"*RRA", &RRA, &IND_X, 8},
-    // 0x64
-    {"*NOP", &NOP, &ZPG, 3},
-    // 0x65
-    {"ADC", &ADC, &ZPG, 3},
-    // 0x66
-    {"ROR", &ROR, &ZPG, 5},
-    // 0x67
-    {"*RRA", &RRA, &ZPG, 5},
-    // 0x68
-    {"PLA", &PLA, &IMPL, 4},
-    // 0x69
-    {"ADC", &ADC, &IMMED, 2},
-    // 0x6A
-    {"ROR", &ROR, &A, 2},
-    // 0x6B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x6C
-    {"JMP", &JMP, &IND, 5},
-    // 0x6D
-    {"ADC", &ADC, &ABS, 4},
-    // 0x6E
-    {"ROR", &ROR, &ABS, 6},
-    // 0x6F
-    {"*RRA", &RRA, &ABS, 6},
-    // 0x70
-    {"BVS", &BVS, &REL, 2},
-    // 0x71
-    {"ADC", &ADC, &IND_Y, 5},
-    // 0x72
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x73
-    {"*RRA", &RRA, &IND_Y, 8},
-    // 0x74
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0x75
-    {"ADC", &ADC, &ZPG_X, 4},
-    // 0x76
-    {"ROR", &ROR, &ZPG_X, 6},
-    // 0x77
-    {"*RRA", &RRA, &ZPG_X, 6},
-    // 0x78
-    {"SEI", &SEI, &IMPL, 2},
-    // 0x79
-    {"ADC", &ADC, &ABS_Y, 4},
-    // 0x7A
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0x7B
-    {"*RRA", &RRA, &ABS_Y, 7},
-    // 0x7C
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0x7D
-    {"ADC", &ADC, &ABS_X, 4},
-    // 0x7E
-    {"ROR", &ROR, &ABS_X, 7},
-    // 0x7F
-    {"*RRA", &RRA, &ABS_X, 7},
-    // 0x80
-    {"*NOP", &NOP, &IMMED, 2},
-    // 0x81
-    {"STA", &STA, &IND_X, 6},
-    // 0x82
-    {"*NOP", &NOP, &IMMED, 2},
-    // 0x83
-    {"*SAX", &SAX, &IND_X, 6},
-    // 0x84
-    {"STY", &STY, &ZPG, 3},
-    // 0x85
-    {"STA", &STA, &ZPG, 3},
-    // 0x86
-    {"STX", &STX, &ZPG, 3},
-    // 0x87
-    {"*SAX", &SAX, &ZPG, 3},
-    // 0x88
-    {"DEY", &DEY, &IMPL, 2},
-    // 0x89
-    {"*NOP", &NOP, &IMMED, 2},
-    // 0x8A
-    {"TXA", &TXA, &IMPL, 2},
-    // 0x8B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x8C
-    {"STY", &STY, &ABS, 4},
-    // 0x8D
-    {"STA", &STA, &ABS, 4},
-    // 0x8E
-    {"STX", &STX, &ABS, 4},
-    // 0x8F
-    {"*SAX", &SAX, &ABS, 4},
-    // 0x90
-    {"BCC", &BCC, &REL, 2},
-    // 0x91
-    {"STA", &STA, &IND_Y, 6},
-    // 0x92
-    {"*JAM", &JAM, &NONE, -1},
-    // 0x93
-    {"UNK", &UNK, &NONE, -1},
-    // 0x94
-    {"STY", &STY, &ZPG_X, 4},
-    // 0x95
-    {"STA", &STA, &ZPG_X, 4},
-    // 0x96
-    {"STX", &STX, &ZPG_Y, 4},
-    // 0x97
-    {"*SAX", &SAX, &ZPG_Y, 4},
-    // 0x98
-    {"TYA", &TYA, &IMPL, 2},
-    // 0x99
-    {"STA", &STA, &ABS_Y, 5},
-    // 0x9A
-    {"TXS", &TXS, &IMPL, 2},
-    // 0x9B
-    {"UNK", &UNK, &NONE, -1},
-    // 0x9C
-    {"UNK", &UNK, &NONE, -1},
-    // 0x9D
-    {"STA", &STA, &ABS_X, 5},
-    // 0x9E
-    {"UNK", &UNK, &NONE, -1},
-    // 0x9F
-    {"UNK", &UNK, &NONE, -1},
-    // 0xA0
-    {"LDY", &LDY, &IMMED, 2},
-    // 0xA1
-    {"LDA", &LDA, &IND_X, 6},
-    // 0xA2
-    {"LDX", &LDX, &IMMED, 2},
-    // 0xA3
-    {"*LAX", &LAX, &IND_X, 6},
-    // 0xA4
-    {"LDY", &LDY, &ZPG, 3},
-    // 0xA5
-    {"LDA", &LDA, &ZPG, 3},
-    // 0xA6
-    {"LDX", &LDX, &ZPG, 3},
-    // 0xA7
-    {"*LAX", &LAX, &ZPG, 3},
-    // 0xA8
-    {"TAY", &TAY, &IMPL, 2},
-    // 0XA9
-    {"LDA", &LDA, &IMMED, 2},
-    // 0xAA
-    {"TAX", &TAX, &IMPL, 2},
-    // 0xAB
-    {"UNK", &UNK, &NONE, -1},
-    // 0xAC
-    {"LDY", &LDY, &ABS, 4},
-    // 0xAD
-    {"LDA", &LDA, &ABS, 4},
-    // 0xAE
-    {"LDX", &LDX, &ABS, 4},
-    // 0xAF
-    {"*LAX", &LAX, &ABS, 4},
-    // 0xB0
-    {"BCS", &BCS, &REL, 2},
-    // 0xB1
-    {"LDA", &LDA, &IND_Y, 5},
-    // 0xB2
-    {"*JAM", &JAM, &NONE, -1},
-    // 0xB3
-    {"*LAX", &LAX, &IND_Y, 5},
-    // 0xB4
-    {"LDY", &LDY, &ZPG_X, 4},
-    // 0xB5
-    {"LDA", &LDA, &ZPG_X, 4},
-    // 0xB6
-    {"LDX", &LDX, &ZPG_Y, 4},
-    // 0xB7
-    {"*LAX", &LAX, &ZPG_Y, 4},
-    // 0xB8
-    {"CLV", &CLV, &IMPL, 2},
-    // 0xB9
-    {"LDA", &LDA, &ABS_Y, 4},
-    // 0xBA
-    {"TSX", &TSX, &IMPL, 2},
-    // 0xBB
-    {"UNK", &UNK, &NONE, -1},
-    // 0xBC
-    {"LDY", &LDY, &ABS_X, 4},
-    // 0xBD
-    {"LDA", &LDA, &ABS_X, 4},
-    // 0xBE
-    {"LDX", &LDX, &ABS_Y, 4},
-    // 0XBF
-    {"*LAX", &LAX, &ABS_Y, 4},
-    // 0xC0
-    {"CPY", &CPY, &IMMED, 2},
-    // 0xC1
-    {"CMP", &CMP, &IND_X, 6},
-    // 0xC2
-    {"*NOP", &NOP, &IMMED, 2},
-    // 0xC3
-    {"*DCP", &DCP, &IND_X, 8},
-    // 0xC4
-    {"CPY", &CPY, &ZPG, 3},
-    // 0xC5
-    {"CMP", &CMP, &ZPG, 3},
-    // 0xC6
-    {"DEC", &DEC, &ZPG, 5},
-    // 0xC7
-    {"*DCP", &DCP, &ZPG, 5},
-    // 0xC8
-    {"INY", &INY, &IMPL, 2},
-    // 0xC9
-    {"CMP", &CMP, &IMMED, 2},
-    // 0xCA
-    {"DEX", &DEX, &IMPL, 2},
-    // 0xCB
-    {"UNK", &UNK, &NONE, -1},
-    // 0xCC
-    {"CPY", &CPY, &ABS, 4},
-    // 0XCD
-    {"CMP", &CMP, &ABS, 4},
-    // 0xCE
-    {"DEC", &DEC, &ABS, 6},
-    // 0xCF
-    {"*DCP", &DCP, &ABS, 6},
-    // 0xD0
-    {"BNE", &BNE, &REL, 2},
-    // 0xD1
-    {"CMP", &CMP, &IND_Y, 5},
-    // 0xD2
-    {"*JAM", &JAM, &NONE, -1},
-    // 0xD3
-    {"*DCP", &DCP, &IND_Y, 8},
-    // 0xD4
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0xD5
-    {"CMP", &CMP, &ZPG_X, 4},
-    // 0xD6
-    {"DEC", &DEC, &ZPG_X, 6},
-    // 0xD7
-    {"*DCP", &DCP, &ZPG_X, 6},
-    // 0xD8
-    {"CLD", &CLD, &IMPL, 2},
-    // 0xD9
-    {"CMP", &CMP, &ABS_Y, 4},
-    // 0xDA
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0xDB
-    {"*DCP", &DCP, &ABS_Y, 7},
-    // 0xDC
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0xDD
-    {"CMP", &CMP, &ABS_X, 4},
-    // 0xDE
-    {"DEC", &DEC, &ABS_X, 7},
-    // 0xDF
-    {"*DCP", &DCP, &ABS_X, 7},
-    // 0xE0
-    {"CPX", &CPX, &IMMED, 2},
-    // 0xE1
-    {"SBC", &SBC, &IND_X, 6},
-    // 0xE2
-    {"*NOP", &NOP, &IMMED, 2},
-    // 0xE3
-    {"*ISB", &ISB, &IND_X, 8},
-    // 0xE4
-    {"CPX", &CPX, &ZPG, 3},
-    // 0xE5
-    {"SBC", &SBC, &ZPG, 3},
-    // 0xE6
-    {"INC", &INC, &ZPG, 5},
-    // 0xE7
-    {"*ISB", &ISB, &ZPG, 5},
-    // 0xE8
-    {"INX", &INX, &IMPL, 2},
-    // 0xE9
-    {"SBC", &SBC, &IMMED, 2},
-    // 0xEA
-    {"NOP", &NOP, &IMPL, 2},
-    // 0xEB
-    {"*SBC", &SBC, &IMMED, 2},
-    // 0xEC
-    {"CPX", &CPX, &ABS, 4},
-    // 0XED
-    {"SBC", &SBC, &ABS, 4},
-    // 0xEE
-    {"INC", &INC, &ABS, 6},
-    // 0xEF
-    {"*ISB", &ISB, &ABS, 6},
-    // 0xF0
-    {"BEQ", &BEQ, &REL, 2},
-    // 0xF1
-    {"SBC", &SBC, &IND_Y, 5},
-    // 0xF2
-    {"*JAM", &JAM, &NONE, -1},
-    // 0xF3
-    {"*ISB", &ISB, &IND_Y, 8},
-    // 0xF4
-    {"*NOP", &NOP, &ZPG_X, 4},
-    // 0xF5
-    {"SBC", &SBC, &ZPG_X, 4},
-    // 0xF6
-    {"INC", &INC, &ZPG_X, 6},
-    // 0xF7
-    {"*ISB", &ISB, &ZPG_X, 6},
-    // 0xF8
-    {"SED", &SED, &IMPL, 2},
-    // 0xF9
-    {"SBC", &SBC, &ABS_Y, 4},
-    // 0xFA
-    {"*NOP", &NOP, &IMPL, 2},
-    // 0xFB
-    {"*ISB", &ISB, &ABS_Y, 7},
-    // 0xFC
-    {"*NOP", &NOP, &ABS_X, 4},
-    // 0xFD
-    {"SBC", &SBC, &ABS_X, 4},
-    // 0xFE
-    {"INC", &INC, &ABS_X, 7},
-    // 0xFF
-    {"*ISB", &ISB, &ABS_X, 7},
-};
+#if C6502_CMOS
+void ZPG_IND();   // Zero page indirect, (oper)
+void ABS_IND_X(); // Absolute X-indexed indirect, JMP (oper,X)
+void ZPG_REL();   // Zero page and relative, BBR and BBS
+#endif
+
+// 6502 instruction lookup table using opcode as the key. Defined in c6502.c, or c65c02.c for the 65C02.
+extern c6502_instruction lookup_table[256];
+
+#endif
@@ -0,0 +1,902 @@
+/*
+c65c02.c
+WDC 65C02 opcodes, address modes and lookup table. Compiled to nothing unless
+C6502_VARIANT is C6502_VARIANT_65C02; the handlers shared with the NMOS part are in c6502.c.
+
+Legend to Flags as in c6502.c.
+*/
+
+#include "c6502.h"
+
+#if C6502_CMOS
+
+/*
+Take a branch to PC + rel_address when taken.
+One cycle more when taken, another when the target is on another page.
+*/
+static void c65c02_branch(bool taken)
+{
+    if (taken)
+    {
+        uint16_t target = c6502.PC + c6502.rel_address;
+
+        C6502_CYCLES(1);
+        if ((target & 0xFF00) != (c6502.PC & 0xFF00))
+        {
+            C6502_CYCLES(1);
+        }
+        c6502.PC = target;
+    }
+}
+
+/*
+BRA() Branch Always
+
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+relative	BRA oper	80	2	    3*
+*/
+void BRA()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    c65c02_branch(true);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+BBR() Branch on Bit Reset
+
+branch on M(bit) = 0, bit is opcode bits 4-6
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	    assembler	        opc	bytes	cycles
+zeropage,rel	BBR0 oper,target	0F	3	    5**
+...
+zeropage,rel	BBR7 oper,target	7F	3	    5**
+*/
+void BBR()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t bit = 1 << ((c6502.opcode >> 4) & 0x07);
+    c65c02_branch((cpu_read(c6502.abs_address) & bit) == 0);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+BBS() Branch on Bit Set
+
+branch on M(bit) = 1, bit is opcode bits 4-6
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	    assembler	        opc	bytes	cycles
+zeropage,rel	BBS0 oper,target	8F	3	    5**
+...
+zeropage,rel	BBS7 oper,target	FF	3	    5**
+*/
+void BBS()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t bit = 1 << ((c6502.opcode >> 4) & 0x07);
+    c65c02_branch((cpu_read(c6502.abs_address) & bit) != 0);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+BIT_IMMED() Test Bits, immediate
+
+A AND M -> Z. Unlike the other BIT address modes N and V are left alone.
+N	Z	C	I	D	V
+-	+	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+immediate	BIT #oper	89	2	    2
+*/
+static void BIT_IMMED()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    c6502_set_status_flag(Z, (c6502.A & cpu_read(c6502.abs_address)) == 0);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+INA() Increment Accumulator (INC A)
+
+A + 1 -> A
+N	Z	C	I	D	V
++	+	-	-	-	-
+addressing	    assembler	opc	bytes	cycles
+accumulator	    INC A	    1A	1	    2
+*/
+static void INA()
+{
+    c6502.A++;
+
+    c6502_set_status_flag(N, c6502.A & 0x80);
+    c6502_set_status_flag(Z, c6502.A == 0x00);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+DEA() Decrement Accumulator (DEC A)
+
+A - 1 -> A
+N	Z	C	I	D	V
++	+	-	-	-	-
+addressing	    assembler	opc	bytes	cycles
+accumulator	    DEC A	    3A	1	    2
+*/
+static void DEA()
+{
+    c6502.A--;
+
+    c6502_set_status_flag(N, c6502.A & 0x80);
+    c6502_set_status_flag(Z, c6502.A == 0x00);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+PHX() Push Index X on Stack
+
+push X
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+implied	    PHX	        DA	1	    3
+*/
+void PHX()
+{
+    cpu_write(c6502_sp_abs(c6502.SP--), c6502.X);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+PHY() Push Index Y on Stack
+
+push Y
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+implied	    PHY	        5A	1	    3
+*/
+void PHY()
+{
+    cpu_write(c6502_sp_abs(c6502.SP--), c6502.Y);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+PLX() Pull Index X from Stack
+
+pull X
+N	Z	C	I	D	V
++	+	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+implied	    PLX	        FA	1	    4
+*/
+void PLX()
+{
+    c6502.X = cpu_read(c6502_sp_abs(++c6502.SP));
+
+    c6502_set_status_flag(N, c6502.X & 0x80);
+    c6502_set_status_flag(Z, c6502.X == 0x00);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+PLY() Pull Index Y from Stack
+
+pull Y
+N	Z	C	I	D	V
++	+	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+implied	    PLY	        7A	1	    4
+*/
+void PLY()
+{
+    c6502.Y = cpu_read(c6502_sp_abs(++c6502.SP));
+
+    c6502_set_status_flag(N, c6502.Y & 0x80);
+    c6502_set_status_flag(Z, c6502.Y == 0x00);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+RMB() Reset Memory Bit
+
+0 -> M(bit), bit is opcode bits 4-6
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+zeropage	RMB0 oper	07	2	    5
+...
+zeropage	RMB7 oper	77	2	    5
+*/
+void RMB()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t bit = 1 << ((c6502.opcode >> 4) & 0x07);
+    cpu_write(c6502.abs_address, cpu_read(c6502.abs_address) & ~bit);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+SMB() Set Memory Bit
+
+1 -> M(bit), bit is opcode bits 4-6
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+zeropage	SMB0 oper	87	2	    5
+...
+zeropage	SMB7 oper	F7	2	    5
+*/
+void SMB()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t bit = 1 << ((c6502.opcode >> 4) & 0x07);
+    cpu_write(c6502.abs_address, cpu_read(c6502.abs_address) | bit);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+STP() Stop the Clock
+
+The processor stops until reset. Reported through the JAM flag like the NMOS JAM opcodes, but
+not counted in c6502_events.jams.
+addressing	assembler	opc	bytes	cycles
+implied	    STP	        DB	1	    3
+*/
+void STP()
+{
+    c6502.JAM = true;
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+STZ() Store Zero in Memory
+
+0 -> M
+N	Z	C	I	D	V
+-	-	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+zeropage	STZ oper	64	2	    3
+zeropage,X	STZ oper,X	74	2	    4
+absolute	STZ oper	9C	3	    4
+absolute,X	STZ oper,X	9E	3	    5
+*/
+void STZ()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    cpu_write(c6502.abs_address, 0x00);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+TRB() Test and Reset Memory Bits with Accumulator
+
+A AND M -> Z, M AND NOT A -> M
+N	Z	C	I	D	V
+-	+	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+zeropage	TRB oper	14	2	    5
+absolute	TRB oper	1C	3	    6
+*/
+void TRB()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t operand = cpu_read(c6502.abs_address);
+    c6502_set_status_flag(Z, (c6502.A & operand) == 0);
+    cpu_write(c6502.abs_address, operand & ~c6502.A);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+TSB() Test and Set Memory Bits with Accumulator
+
+A AND M -> Z, M OR A -> M
+N	Z	C	I	D	V
+-	+	-	-	-	-
+addressing	assembler	opc	bytes	cycles
+zeropage	TSB oper	04	2	    5
+absolute	TSB oper	0C	3	    6
+*/
+void TSB()
+{
+    lookup_table[c6502.opcode].address_mode();
+
+    uint8_t operand = cpu_read(c6502.abs_address);
+    c6502_set_status_flag(Z, (c6502.A & operand) == 0);
+    cpu_write(c6502.abs_address, operand | c6502.A);
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+/*
+WAI() Wait for Interrupt
+
+The processor sleeps until an interrupt. Modelled by running WAI again (PC stays on it) until
+c6502_irq() or c6502_nmi() moves PC to a handler; runners see it as a trap.
+addressing	assembler	opc	bytes	cycles
+implied	    WAI	        CB	1	    3
+*/
+void WAI()
+{
+    c6502.PC--;
+
+    C6502_CYCLES(lookup_table[c6502.opcode].cycles);
+}
+
+//----------------------
+// 65C02 Address Modes
+//----------------------
+
+// Address Mode: Zero Page Indirect
+void ZPG_IND()
+{
+    uint16_t temp = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t LSB = (uint16_t)cpu_read(temp & 0x00FF);
+    uint16_t MSB = (uint16_t)cpu_read((temp + 1) & 0x00FF);
+    c6502.abs_address = (MSB << 8) | LSB;
+}
+
+// Address Mode: Absolute X-indexed Indirect, reads the pointer at (oper + X) without a page wrap.
+void ABS_IND_X()
+{
+    uint16_t LSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t MSB = (uint16_t)cpu_fetch(c6502.PC++);
+    uint16_t ptr_address = ((MSB << 8) | LSB) + c6502.X;
+    c6502.abs_address = cpu_read(ptr_address + 1) << 8 | cpu_read(ptr_address);
+}
+
+// Address Mode: Zero Page and Relative. Zero page address in abs_address, offset in rel_address.
+void ZPG_REL()
+{
+    ZPG();
+    REL();
+}
+
+/*------------------------------------------------------------------------------------
+65C02 instruction lookup table using opcode as the key, as in c6502.c.
+
+Opcodes the NMOS part decoded as illegal are new instructions or NOPs of fixed length and
+timing here. Those NOPs keep the * of undocumented opcodes.
+----------------------------------------------------------------------------------------*/
+c6502_instruction lookup_table[256] = {
+    // 0x00
+    {"BRK", &BRK, &IMPL, 7},
+    // 0x01
+    {"ORA", &ORA, &IND_X, 6},
+    // 0x02
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x03
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x04
+    {"TSB", &TSB, &ZPG, 5},
+    // 0x05
+    {"ORA", &ORA, &ZPG, 3},
+    // 0x06
+    {"ASL", &ASL, &ZPG, 5},
+    // 0x07
+    {"RMB0", &RMB, &ZPG, 5},
+    // 0x08
+    {"PHP", &PHP, &IMPL, 3},
+    // 0x09
+    {"ORA", &ORA, &IMMED, 2},
+    // 0x0A
+    {"ASL", &ASL, &A, 2},
+    // 0x0B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x0C
+    {"TSB", &TSB, &ABS, 6},
+    // 0x0D
+    {"ORA", &ORA, &ABS, 4},
+    // 0x0E
+    {"ASL", &ASL, &ABS, 6},
+    // 0x0F
+    {"BBR0", &BBR, &ZPG_REL, 5},
+    // 0x10
+    {"BPL", &BPL, &REL, 2},
+    // 0x11
+    {"ORA", &ORA, &IND_Y, 5},
+    // 0x12
+    {"ORA", &ORA, &ZPG_IND, 5},
+    // 0x13
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x14
+    {"TRB", &TRB, &ZPG, 5},
+    // 0x15
+    {"ORA", &ORA, &ZPG_X, 4},
+    // 0x16
+    {"ASL", &ASL, &ZPG_X, 6},
+    // 0x17
+    {"RMB1", &RMB, &ZPG, 5},
+    // 0x18
+    {"CLC", &CLC, &IMPL, 2},
+    // 0x19
+    {"ORA", &ORA, &ABS_Y, 4},
+    // 0x1A
+    {"INC", &INA, &A, 2},
+    // 0x1B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x1C
+    {"TRB", &TRB, &ABS, 6},
+    // 0x1D
+    {"ORA", &ORA, &ABS_X, 4},
+    // 0x1E
+    {"ASL", &ASL, &ABS_X, 6},
+    // 0x1F
+    {"BBR1", &BBR, &ZPG_REL, 5},
+    // 0x20
+    {"JSR", &JSR, &ABS, 6},
+    // 0x21
+    {"AND", &AND, &IND_X, 6},
+    // 0x22
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x23
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x24
+    {"BIT", &BIT, &ZPG, 3},
+    // 0x25
+    {"AND", &AND, &ZPG, 3},
+    // 0x26
+    {"ROL", &ROL, &ZPG, 5},
+    // 0x27
+    {"RMB2", &RMB, &ZPG, 5},
+    // 0x28
+    {"PLP", &PLP, &IMPL, 4},
+    // 0x29
+    {"AND", &AND, &IMMED, 2},
+    // 0x2A
+    {"ROL", &ROL, &A, 2},
+    // 0x2B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x2C
+    {"BIT", &BIT, &ABS, 4},
+    // 0x2D
+    {"AND", &AND, &ABS, 4},
+    // 0x2E
+    {"ROL", &ROL, &ABS, 6},
+    // 0x2F
+    {"BBR2", &BBR, &ZPG_REL, 5},
+    // 0x30
+    {"BMI", &BMI, &REL, 2},
+    // 0x31
+    {"AND", &AND, &IND_Y, 5},
+    // 0x32
+    {"AND", &AND, &ZPG_IND, 5},
+    // 0x33
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x34
+    {"BIT", &BIT, &ZPG_X, 4},
+    // 0x35
+    {"AND", &AND, &ZPG_X, 4},
+    // 0x36
+    {"ROL", &ROL, &ZPG_X, 6},
+    // 0x37
+    {"RMB3", &RMB, &ZPG, 5},
+    // 0x38
+    {"SEC", &SEC, &IMPL, 2},
+    // 0x39
+    {"AND", &AND, &ABS_Y, 4},
+    // 0x3A
+    {"DEC", &DEA, &A, 2},
+    // 0x3B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x3C
+    {"BIT", &BIT, &ABS_X, 4},
+    // 0x3D
+    {"AND", &AND, &ABS_X, 4},
+    // 0x3E
+    {"ROL", &ROL, &ABS_X, 6},
+    // 0x3F
+    {"BBR3", &BBR, &ZPG_REL, 5},
+    // 0x40
+    {"RTI", &RTI, &IMPL, 6},
+    // 0x41
+    {"EOR", &EOR, &IND_X, 6},
+    // 0x42
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x43
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x44
+    {"*NOP", &NOP, &ZPG, 3},
+    // 0x45
+    {"EOR", &EOR, &ZPG, 3},
+    // 0x46
+    {"LSR", &LSR, &ZPG, 5},
+    // 0x47
+    {"RMB4", &RMB, &ZPG, 5},
+    // 0x48
+    {"PHA", &PHA, &IMPL, 3},
+    // 0x49
+    {"EOR", &EOR, &IMMED, 2},
+    // 0x4A
+    {"LSR", &LSR, &A, 2},
+    // 0x4B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x4C
+    {"JMP", &JMP, &ABS, 3},
+    // 0x4D
+    {"EOR", &EOR, &ABS, 4},
+    // 0x4E
+    {"LSR", &LSR, &ABS, 6},
+    // 0x4F
+    {"BBR4", &BBR, &ZPG_REL, 5},
+    // 0x50
+    {"BVC", &BVC, &REL, 2},
+    // 0x51
+    {"EOR", &EOR, &IND_Y, 5},
+    // 0x52
+    {"EOR", &EOR, &ZPG_IND, 5},
+    // 0x53
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x54
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0x55
+    {"EOR", &EOR, &ZPG_X, 4},
+    // 0x56
+    {"LSR", &LSR, &ZPG_X, 6},
+    // 0x57
+    {"RMB5", &RMB, &ZPG, 5},
+    // 0x58
+    {"CLI", &CLI, &IMPL, 2},
+    // 0x59
+    {"EOR", &EOR, &ABS_Y, 4},
+    // 0x5A
+    {"PHY", &PHY, &IMPL, 3},
+    // 0x5B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x5C
+    {"*NOP", &NOP, &ABS, 8},
+    // 0x5D
+    {"EOR", &EOR, &ABS_X, 4},
+    // 0x5E
+    {"LSR", &LSR, &ABS_X, 6},
+    // 0x5F
+    {"BBR5", &BBR, &ZPG_REL, 5},
+    // 0x60
+    {"RTS", &RTS, &IMPL, 6},
+    // 0x61
+    {"ADC", &ADC, &IND_X, 6},
+    // 0x62
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x63
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x64
+    {"STZ", &STZ, &ZPG, 3},
+    // 0x65
+    {"ADC", &ADC, &ZPG, 3},
+    // 0x66
+    {"ROR", &ROR, &ZPG, 5},
+    // 0x67
+    {"RMB6", &RMB, &ZPG, 5},
+    // 0x68
+    {"PLA", &PLA, &IMPL, 4},
+    // 0x69
+    {"ADC", &ADC, &IMMED, 2},
+    // 0x6A
+    {"ROR", &ROR, &A, 2},
+    // 0x6B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x6C
+    {"JMP", &JMP, &IND, 6},
+    // 0x6D
+    {"ADC", &ADC, &ABS, 4},
+    // 0x6E
+    {"ROR", &ROR, &ABS, 6},
+    // 0x6F
+    {"BBR6", &BBR, &ZPG_REL, 5},
+    // 0x70
+    {"BVS", &BVS, &REL, 2},
+    // 0x71
+    {"ADC", &ADC, &IND_Y, 5},
+    // 0x72
+    {"ADC", &ADC, &ZPG_IND, 5},
+    // 0x73
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x74
+    {"STZ", &STZ, &ZPG_X, 4},
+    // 0x75
+    {"ADC", &ADC, &ZPG_X, 4},
+    // 0x76
+    {"ROR", &ROR, &ZPG_X, 6},
+    // 0x77
+    {"RMB7", &RMB, &ZPG, 5},
+    // 0x78
+    {"SEI", &SEI, &IMPL, 2},
+    // 0x79
+    {"ADC", &ADC, &ABS_Y, 4},
+    // 0x7A
+    {"PLY", &PLY, &IMPL, 4},
+    // 0x7B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x7C
+    {"JMP", &JMP, &ABS_IND_X, 6},
+    // 0x7D
+    {"ADC", &ADC, &ABS_X, 4},
+    // 0x7E
+    {"ROR", &ROR, &ABS_X, 6},
+    // 0x7F
+    {"BBR7", &BBR, &ZPG_REL, 5},
+    // 0x80
+    {"BRA", &BRA, &REL, 2},
+    // 0x81
+    {"STA", &STA, &IND_X, 6},
+    // 0x82
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0x83
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x84
+    {"STY", &STY, &ZPG, 3},
+    // 0x85
+    {"STA", &STA, &ZPG, 3},
+    // 0x86
+    {"STX", &STX, &ZPG, 3},
+    // 0x87
+    {"SMB0", &SMB, &ZPG, 5},
+    // 0x88
+    {"DEY", &DEY, &IMPL, 2},
+    // 0x89
+    {"BIT", &BIT_IMMED, &IMMED, 2},
+    // 0x8A
+    {"TXA", &TXA, &IMPL, 2},
+    // 0x8B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x8C
+    {"STY", &STY, &ABS, 4},
+    // 0x8D
+    {"STA", &STA, &ABS, 4},
+    // 0x8E
+    {"STX", &STX, &ABS, 4},
+    // 0x8F
+    {"BBS0", &BBS, &ZPG_REL, 5},
+    // 0x90
+    {"BCC", &BCC, &REL, 2},
+    // 0x91
+    {"STA", &STA, &IND_Y, 6},
+    // 0x92
+    {"STA", &STA, &ZPG_IND, 5},
+    // 0x93
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x94
+    {"STY", &STY, &ZPG_X, 4},
+    // 0x95
+    {"STA", &STA, &ZPG_X, 4},
+    // 0x96
+    {"STX", &STX, &ZPG_Y, 4},
+    // 0x97
+    {"SMB1", &SMB, &ZPG, 5},
+    // 0x98
+    {"TYA", &TYA, &IMPL, 2},
+    // 0x99
+    {"STA", &STA, &ABS_Y, 5},
+    // 0x9A
+    {"TXS", &TXS, &IMPL, 2},
+    // 0x9B
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0x9C
+    {"STZ", &STZ, &ABS, 4},
+    // 0x9D
+    {"STA", &STA, &ABS_X, 5},
+    // 0x9E
+    {"STZ", &STZ, &ABS_X, 5},
+    // 0x9F
+    {"BBS1", &BBS, &ZPG_REL, 5},
+    // 0xA0
+    {"LDY", &LDY, &IMMED, 2},
+    // 0xA1
+    {"LDA", &LDA, &IND_X, 6},
+    // 0xA2
+    {"LDX", &LDX, &IMMED, 2},
+    // 0xA3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xA4
+    {"LDY", &LDY, &ZPG, 3},
+    // 0xA5
+    {"LDA", &LDA, &ZPG, 3},
+    // 0xA6
+    {"LDX", &LDX, &ZPG, 3},
+    // 0xA7
+    {"SMB2", &SMB, &ZPG, 5},
+    // 0xA8
+    {"TAY", &TAY, &IMPL, 2},
+    // 0xA9
+    {"LDA", &LDA, &IMMED, 2},
+    // 0xAA
+    {"TAX", &TAX, &IMPL, 2},
+    // 0xAB
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xAC
+    {"LDY", &LDY, &ABS, 4},
+    // 0xAD
+    {"LDA", &LDA, &ABS, 4},
+    // 0xAE
+    {"LDX", &LDX, &ABS, 4},
+    // 0xAF
+    {"BBS2", &BBS, &ZPG_REL, 5},
+    // 0xB0
+    {"BCS", &BCS, &REL, 2},
+    // 0xB1
+    {"LDA", &LDA, &IND_Y, 5},
+    // 0xB2
+    {"LDA", &LDA, &ZPG_IND, 5},
+    // 0xB3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xB4
+    {"LDY", &LDY, &ZPG_X, 4},
+    // 0xB5
+    {"LDA", &LDA, &ZPG_X, 4},
+    // 0xB6
+    {"LDX", &LDX, &ZPG_Y, 4},
+    // 0xB7
+    {"SMB3", &SMB, &ZPG, 5},
+    // 0xB8
+    {"CLV", &CLV, &IMPL, 2},
+    // 0xB9
+    {"LDA", &LDA, &ABS_Y, 4},
+    // 0xBA
+    {"TSX", &TSX, &IMPL, 2},
+    // 0xBB
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xBC
+    {"LDY", &LDY, &ABS_X, 4},
+    // 0xBD
+    {"LDA", &LDA, &ABS_X, 4},
+    // 0xBE
+    {"LDX", &LDX, &ABS_Y, 4},
+    // 0xBF
+    {"BBS3", &BBS, &ZPG_REL, 5},
+    // 0xC0
+    {"CPY", &CPY, &IMMED, 2},
+    // 0xC1
+    {"CMP", &CMP, &IND_X, 6},
+    // 0xC2
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0xC3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xC4
+    {"CPY", &CPY, &ZPG, 3},
+    // 0xC5
+    {"CMP", &CMP, &ZPG, 3},
+    // 0xC6
+    {"DEC", &DEC, &ZPG, 5},
+    // 0xC7
+    {"SMB4", &SMB, &ZPG, 5},
+    // 0xC8
+    {"INY", &INY, &IMPL, 2},
+    // 0xC9
+    {"CMP", &CMP, &IMMED, 2},
+    // 0xCA
+    {"DEX", &DEX, &IMPL, 2},
+    // 0xCB
+    {"WAI", &WAI, &IMPL, 3},
+    // 0xCC
+    {"CPY", &CPY, &ABS, 4},
+    // 0xCD
+    {"CMP", &CMP, &ABS, 4},
+    // 0xCE
+    {"DEC", &DEC, &ABS, 6},
+    // 0xCF
+    {"BBS4", &BBS, &ZPG_REL, 5},
+    // 0xD0
+    {"BNE", &BNE, &REL, 2},
+    // 0xD1
+    {"CMP", &CMP, &IND_Y, 5},
+    // 0xD2
+    {"CMP", &CMP, &ZPG_IND, 5},
+    // 0xD3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xD4
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0xD5
+    {"CMP", &CMP, &ZPG_X, 4},
+    // 0xD6
+    {"DEC", &DEC, &ZPG_X, 6},
+    // 0xD7
+    {"SMB5", &SMB, &ZPG, 5},
+    // 0xD8
+    {"CLD", &CLD, &IMPL, 2},
+    // 0xD9
+    {"CMP", &CMP, &ABS_Y, 4},
+    // 0xDA
+    {"PHX", &PHX, &IMPL, 3},
+    // 0xDB
+    {"STP", &STP, &IMPL, 3},
+    // 0xDC
+    {"*NOP", &NOP, &ABS, 4},
+    // 0xDD
+    {"CMP", &CMP, &ABS_X, 4},
+    // 0xDE
+    {"DEC", &DEC, &ABS_X, 7},
+    // 0xDF
+    {"BBS5", &BBS, &ZPG_REL, 5},
+    // 0xE0
+    {"CPX", &CPX, &IMMED, 2},
+    // 0xE1
+    {"SBC", &SBC, &IND_X, 6},
+    // 0xE2
+    {"*NOP", &NOP, &IMMED, 2},
+    // 0xE3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xE4
+    {"CPX", &CPX, &ZPG, 3},
+    // 0xE5
+    {"SBC", &SBC, &ZPG, 3},
+    // 0xE6
+    {"INC", &INC, &ZPG, 5},
+    // 0xE7
+    {"SMB6", &SMB, &ZPG, 5},
+    // 0xE8
+    {"INX", &INX, &IMPL, 2},
+    // 0xE9
+    {"SBC", &SBC, &IMMED, 2},
+    // 0xEA
+    {"NOP", &NOP, &IMPL, 2},
+    // 0xEB
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xEC
+    {"CPX", &CPX, &ABS, 4},
+    // 0xED
+    {"SBC", &SBC, &ABS, 4},
+    // 0xEE
+    {"INC", &INC, &ABS, 6},
+    // 0xEF
+    {"BBS6", &BBS, &ZPG_REL, 5},
+    // 0xF0
+    {"BEQ", &BEQ, &REL, 2},
+    // 0xF1
+    {"SBC", &SBC, &IND_Y, 5},
+    // 0xF2
+    {"SBC", &SBC, &ZPG_IND, 5},
+    // 0xF3
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xF4
+    {"*NOP", &NOP, &ZPG_X, 4},
+    // 0xF5
+    {"SBC", &SBC, &ZPG_X, 4},
+    // 0xF6
+    {"INC", &INC, &ZPG_X, 6},
+    // 0xF7
+    {"SMB7", &SMB, &ZPG, 5},
+    // 0xF8
+    {"SED", &SED, &IMPL, 2},
+    // 0xF9
+    {"SBC", &SBC, &ABS_Y, 4},
+    // 0xFA
+    {"PLX", &PLX, &IMPL, 4},
+    // 0xFB
+    {"*NOP", &NOP, &IMPL, 1},
+    // 0xFC
+    {"*NOP", &NOP, &ABS, 4},
+    // 0xFD
+    {"SBC", &SBC, &ABS_X, 4},
+    // 0xFE
+    {"INC", &INC, &ABS_X, 7},
+    // 0xFF
+    {"BBS7", &BBS, &ZPG_REL, 5},
+};
+
+#endif
@@ -0,0 +1,328 @@
+/*
+callstack.c
+Shadow call stack following JSR and interrupts, cycles attributed per call path.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "callstack.h"
+
+// Cycles of an interrupt entry, charged to the handler frame.
+#define CALLSTACK_INTERRUPT_CYCLES (C6502_TIMED ? 7 : 0)
+
+// Frame kinds. Calls are 0, interrupts are their c6502_interrupt kind + 1.
+#define CALLSTACK_CALL 0
+
+// Call tree node: one per distinct call path.
+typedef struct
+{
+    uint16_t address;
+    uint8_t kind;
+    int parent;
+    int first_child;
+    int next_sibling;
+    uint64_t cycles; // Cycles spent in this path, callees not included
+} callstack_node;
+
+typedef struct
+{
+    int node;
+    uint8_t sp; // SP before the call or interrupt
+} callstack_frame;
+
+static callstack_node *nodes = NULL;
+static int node_count = 0;
+static int node_capacity = 0;
+
+static callstack_frame frames[C6502_CALLSTACK_DEPTH + 1];
+static int depth = 0;
+
+// c6502.cycles when cycles were last attributed.
+static uint64_t last_cycles = 0;
+
+// Label per address, NULL if the address has none.
+static char **labels = NULL;
+
+// Add cycles since the last attribution to the frame on top.
+static void callstack_attribute(uint64_t cycles)
+{
+    nodes[frames[depth].node].cycles += cycles - last_cycles;
+    last_cycles = cycles;
+}
+
+// Return the child of parent for address and kind, creating it if needed. Return -1 if out of memory.
+static int callstack_child(int parent, uint16_t address, uint8_t kind)
+{
+    for (int i = nodes[parent].first_child; i >= 0; i = nodes[i].next_sibling)
+    {
+        if (nodes[i].address == address && nodes[i].kind == kind)
+        {
+            return i;
+        }
+    }
+    if (node_count == node_capacity)
+    {
+        int grown = node_capacity ? node_capacity * 2 : 1024;
+        callstack_node *larger = realloc(nodes, grown * sizeof(callstack_node));
+        if (!larger)
+        {
+            return -1;
+        }
+        nodes = larger;
+        node_capacity = grown;
+    }
+    nodes[node_count] = (callstack_node){address, kind, parent, -1, nodes[parent].first_child, 0};
+    nodes[parent].first_child = node_count;
+    return node_count++;
+}
+
+// Push a frame for address entered with SP at sp. Frames past the depth limit are not tracked.
+static void callstack_push(uint16_t address, uint8_t kind, uint8_t sp)
+{
+    if (depth == C6502_CALLSTACK_DEPTH)
+    {
+        return;
+    }
+    int node = callstack_child(frames[depth].node, address, kind);
+    if (node >= 0)
+    {
+        frames[++depth] = (callstack_frame){node, sp};
+    }
+}
+
+// Pop every frame whose return address is off the stack.
+static void callstack_unwind()
+{
+    while (depth > 0 && c6502.SP >= frames[depth].sp)
+    {
+        depth--;
+    }
+}
+
+// Interrupt hook. The 7 entry cycles are already counted and go to the handler frame.
+static void callstack_interrupt(c6502_interrupt kind)
+{
+    callstack_attribute(c6502.cycles - CALLSTACK_INTERRUPT_CYCLES);
+    callstack_push(c6502.PC, (uint8_t)(kind + 1), (uint8_t)(c6502.SP + 3));
+}
+
+// Parse a hex address with optional "$" or "0x" prefix. Return -1 if it is not one.
+static long callstack_parse_address(const char *text)
+{
+    char *end = NULL;
+
+    if (text[0] == '$')
+    {
+        text++;
+    }
+    else if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+    {
+        text += 2;
+    }
+    long value = strtol(text, &end, 16);
+    if (end == text || *end != '\0' || value < 0)
+    {
+        return -1;
+    }
+    return value & 0xFFFF;
+}
+
+// Read label lines. Return false if the file can not be opened or memory allocated.
+static bool callstack_read_labels(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+
+    if (!fp)
+    {
+        printf("Label file %s does not exist\n", path);
+        return false;
+    }
+    labels = calloc(65536, sizeof(char *));
+    if (!labels)
+    {
+        fclose(fp);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *tokens[4] = {NULL};
+        int count = 0;
+        const char *name = NULL;
+        long address = -1;
+
+        for (char *token = strtok(line, " \t\r\n"); token && count < 4; token = strtok(NULL, " \t\r\n"))
+        {
+            tokens[count++] = token;
+        }
+        if (count < 2 || tokens[0][0] == ';' || tokens[0][0] == '#')
+        {
+            continue;
+        }
+        if (strcmp(tokens[0], "al") == 0 && count >= 3)
+        {
+            // VICE: "al C:C000 .name", bank prefix optional
+            char *colon = strchr(tokens[1], ':');
+            address = callstack_parse_address(colon ? colon + 1 : tokens[1]);
+            name = (tokens[2][0] == '.') ? tokens[2] + 1 : tokens[2];
+        }
+        else if (count >= 3 && strcmp(tokens[1], "=") == 0)
+        {
+            address = callstack_parse_address(tokens[2]);
+            name = tokens[0];
+        }
+        else
+        {
+            address = callstack_parse_address(tokens[0]);
+            name = tokens[1];
+        }
+        if (address < 0 || labels[address])
+        {
+            continue;
+        }
+        labels[address] = strdup(name);
+    }
+    fclose(fp);
+    return true;
+}
+
+/*
+c6502_callstack_init() Start profiling at the current PC.
+*/
+bool c6502_callstack_init(const char *label_path)
+{
+    c6502_callstack_free();
+    if (label_path && !callstack_read_labels(label_path))
+    {
+        c6502_callstack_free();
+        return false;
+    }
+    nodes = malloc(1024 * sizeof(callstack_node));
+    if (!nodes)
+    {
+        c6502_callstack_free();
+        return false;
+    }
+    node_capacity = 1024;
+    node_count = 1;
+    nodes[0] = (callstack_node){c6502.PC, CALLSTACK_CALL, -1, -1, -1, 0};
+    frames[0] = (callstack_frame){0, 0};
+    depth = 0;
+    last_cycles = c6502.cycles;
+    c6502_on_interrupt = callstack_interrupt;
+    return true;
+}
+
+/*
+c6502_callstack_free() Free the call tree and labels.
+*/
+void c6502_callstack_free()
+{
+    if (c6502_on_interrupt == callstack_interrupt)
+    {
+        c6502_on_interrupt = NULL;
+    }
+    if (labels)
+    {
+        for (int i = 0; i < 65536; i++)
+        {
+            free(labels[i]);
+        }
+        free(labels);
+        labels = NULL;
+    }
+    free(nodes);
+    nodes = NULL;
+    node_count = 0;
+    node_capacity = 0;
+    depth = 0;
+}
+
+/*
+c6502_callstack_execute() Run the fetched opcode.
+The instruction's cycles go to the frame it ran in, a JSR's to the caller. BRK pushes its frame
+through the interrupt hook, so its cycles go to the handler like those of IRQ and NMI.
+*/
+void c6502_callstack_execute()
+{
+    uint8_t sp = c6502.SP;
+
+    c6502_execute();
+    callstack_attribute(c6502.cycles);
+    if (c6502.opcode == 0x20)
+    {
+        callstack_push(c6502.PC, CALLSTACK_CALL, sp);
+    }
+    else
+    {
+        callstack_unwind();
+    }
+}
+
+/*
+c6502_callstack_step() Fetch and run one instruction.
+*/
+void c6502_callstack_step()
+{
+    c6502_read_opcode();
+    c6502_callstack_execute();
+}
+
+/*
+c6502_callstack_depth() Number of frames above the root.
+*/
+int c6502_callstack_depth()
+{
+    return depth;
+}
+
+// Write the name of node to fp.
+static void callstack_print_name(FILE *fp, const callstack_node *node)
+{
+    static const char *kinds[] = {"", "[irq] ", "[nmi] ", "[brk] "};
+
+    fputs(kinds[node->kind], fp);
+    if (labels && labels[node->address])
+    {
+        fputs(labels[node->address], fp);
+    }
+    else
+    {
+        fprintf(fp, "sub_%04X", node->address);
+    }
+}
+
+/*
+c6502_callstack_write() Write one folded stack line per call path that used cycles.
+*/
+bool c6502_callstack_write(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    int path_nodes[C6502_CALLSTACK_DEPTH + 1];
+
+    if (!fp)
+    {
+        return false;
+    }
+    for (int i = 0; i < node_count; i++)
+    {
+        int length = 0;
+
+        if (nodes[i].cycles == 0)
+        {
+            continue;
+        }
+        for (int n = i; n >= 0; n = nodes[n].parent)
+        {
+            path_nodes[length++] = n;
+        }
+        for (int k = length - 1; k >= 0; k--)
+        {
+            callstack_print_name(fp, &nodes[path_nodes[k]]);
+            fputc(k ? ';' : ' ', fp);
+        }
+        fprintf(fp, "%llu\n", (unsigned long long)nodes[i].cycles);
+    }
+    return fclose(fp) == 0;
+}
@@ -0,0 +1,54 @@
+// callstack.h
+
+#ifndef CALLSTACK_H
+#define CALLSTACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Guest call stack profiler.
+
+Run the machine with c6502_callstack_step() (or c6502_read_opcode() followed by
+c6502_callstack_execute()) instead of c6502_step(). A shadow call stack follows JSR and the
+interrupt entries reported through c6502_on_interrupt (IRQ, NMI and BRK). Every instruction's
+cycles are added to the call path on top of the shadow stack, so the totals are exact.
+
+Each frame remembers the SP from before its call. A frame ends as soon as the SP is back at or
+above that value, whatever instruction got it there: RTS, RTI, PLA/PLA discarding the return
+address, or TXS. An RTS used as a jump table (push target - 1, RTS) leaves the SP below the
+frame's entry value and stays in the current frame.
+
+c6502_callstack_write() writes folded stacks ("root;outer;inner cycles" lines), the input of
+flamegraph.pl and compatible viewers. Names come from an optional label file, otherwise a call
+to $C72A is named sub_C72A. Interrupt frames are named [irq], [nmi] or [brk] plus the handler.
+*/
+
+// Frames deeper than this are not tracked, their cycles go to the deepest tracked frame.
+#define C6502_CALLSTACK_DEPTH 128
+
+/*
+Start profiling at the current PC, which names the root frame. label_path is a label file or NULL.
+Label lines are "C000 name", "name = $C000" or VICE style "al C:C000 .name"; blank lines and
+lines starting with ';' or '#' are skipped.
+Return false if memory can not be allocated or the label file can not be read.
+*/
+bool c6502_callstack_init(const char *label_path);
+
+// Free the call tree and labels, remove the interrupt hook.
+void c6502_callstack_free();
+
+// Run c6502_execute() on the fetched opcode and update the shadow stack.
+void c6502_callstack_execute();
+
+// Fetch and run one instruction.
+void c6502_callstack_step();
+
+// Number of frames on the shadow stack, the root frame not counted.
+int c6502_callstack_depth();
+
+// Write folded stacks to path. Return false if the file can not be written.
+bool c6502_callstack_write(const char *path);
+
+#endif
@@ -0,0 +1,63 @@
+/*
+check.c
+c6502-check runs the self tests of modules that no program exercises on every build.
+
+Each test prints one line with its result. Built with AddressSanitizer by make check, so a test
+that overruns a buffer fails even when the overrun happens not to corrupt anything.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "c6502.h"
+#include "rewind.h"
+
+/*
+Changed and unchanged bytes alternating over all of memory is the largest delta a snapshot can
+encode. Stepping back over it must restore memory exactly.
+*/
+static bool check_rewind_worst_case(void)
+{
+    bool ok = true;
+
+    memset(ADDRESS, 0, sizeof(ADDRESS));
+    c6502.cycles = 0;
+    if (!c6502_rewind_init(0, 1 << 20))
+    {
+        return false;
+    }
+    for (int address = 0; address < 65536; address += 2)
+    {
+        cpu_write(address, 0xFF);
+    }
+    c6502.cycles = 1;
+    ok &= c6502_rewind_snapshot();
+    ok &= c6502_rewind_count() == 2;
+    ok &= c6502_rewind_step_back();
+    for (int address = 0; address < 65536; address++)
+    {
+        ok &= ADDRESS[address] == 0;
+    }
+    ok &= c6502.cycles == 0 && c6502_rewind_count() == 1;
+    c6502_rewind_free();
+    return ok;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        const char *name;
+        bool (*run)(void);
+    } tests[] = {
+        {"rewind worst case delta", check_rewind_worst_case},
+    };
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        bool ok = tests[i].run();
+        printf("%-32s %s\n", tests[i].name, ok ? "pass" : "fail");
+        failed += !ok;
+    }
+    return failed ? 1 : 0;
+}
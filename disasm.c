@@ -0,0 +1,299 @@
+/*
+disasm.c
+Cached disassembly of the nestest.log style trace line.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "disasm.h"
+
+// How the dynamic part of the line is formatted.
+typedef enum
+{
+    DISASM_NONE,  // Line is fully static
+    DISASM_ABS,   // = value
+    DISASM_ZPG,   // = value
+    DISASM_ABS_X, // effective address = value
+    DISASM_ABS_Y, // effective address = value
+    DISASM_ZPG_X, // effective address = value
+    DISASM_ZPG_Y, // effective address = value
+    DISASM_IND,   // jump target
+    DISASM_IND_X, // pointer @ effective address = value
+    DISASM_IND_Y, // pointer @ effective address = value
+} disasm_kind;
+
+// Cached disassembly for one PC. len is 0 if the entry is not valid.
+typedef struct
+{
+    char text[C6502_DISASM_TEXT];
+    uint8_t len;
+    uint8_t kind;
+    uint8_t LSB;
+    uint8_t MSB;
+} disasm_entry;
+
+// One cache page per 256 byte page of the address space, allocated on first use.
+static disasm_entry *disasm_pages[256];
+
+// Bus write hook. Drop entries whose instruction bytes include the written address.
+static void disasm_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        uint16_t pc = abs_address - i;
+        disasm_entry *page = disasm_pages[pc >> 8];
+        if (page)
+        {
+            page[pc & 0xFF].len = 0;
+        }
+    }
+}
+
+// c6502_disasm_init() Install write hook.
+bool c6502_disasm_init(void)
+{
+    return bus_add_write_hook(disasm_write, NULL);
+}
+
+// c6502_disasm_free() Remove write hook and free cache pages.
+void c6502_disasm_free(void)
+{
+    bus_remove_write_hook(disasm_write, NULL);
+    for (int i = 0; i < 256; i++)
+    {
+        free(disasm_pages[i]);
+        disasm_pages[i] = NULL;
+    }
+}
+
+// c6502_disasm_invalidate_all() Drop every cached entry.
+void c6502_disasm_invalidate_all(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        if (disasm_pages[i])
+        {
+            memset(disasm_pages[i], 0, 256 * sizeof(disasm_entry));
+        }
+    }
+}
+
+// Render the static prefix for the instruction at pc into entry.
+static void disasm_render(disasm_entry *entry, uint16_t pc)
+{
+    uint8_t opcode = bus_peek(pc);
+    const c6502_instruction *op = &lookup_table[opcode];
+    // Read ahead next two bytes after the opcode.
+    uint16_t LSB = bus_peek(pc + 1) & 0x00FF;
+    uint16_t MSB = bus_peek(pc + 2) & 0x00FF;
+    uint16_t temp = 0;
+    char *text = entry->text;
+    size_t size = sizeof(entry->text);
+    int len = 0;
+
+    entry->kind = DISASM_NONE;
+    entry->LSB = LSB;
+    entry->MSB = MSB;
+
+    if (op->address_mode == IMPL)
+    {
+        len = snprintf(text, size, "%-4X %-8X  %4s \t\t\t\t", pc, opcode, op->name);
+    }
+    else if (op->address_mode == A)
+    {
+        len = snprintf(text, size, "%-4X %-8X  %4s A\t\t\t\t", pc, opcode, op->name);
+    }
+    else if (op->address_mode == IMMED)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  #$%02X \t\t\t", pc, opcode, LSB, op->name, LSB);
+    }
+    else if (op->address_mode == ABS)
+    {
+        temp = (MSB << 8) | LSB;
+        if (op->run == JMP || op->run == JSR)
+        {
+            len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%04X \t\t\t", pc, opcode, LSB, MSB, op->name, temp);
+        }
+        else
+        {
+            len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%04X = ", pc, opcode, LSB, MSB, op->name, temp);
+            entry->kind = DISASM_ABS;
+        }
+    }
+    else if (op->address_mode == ZPG)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  $%02X = ", pc, opcode, LSB, op->name, LSB);
+        entry->kind = DISASM_ZPG;
+    }
+    else if (op->address_mode == ABS_X)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%02X%02X,X @ ", pc, opcode, LSB, MSB, op->name, MSB, LSB);
+        entry->kind = DISASM_ABS_X;
+    }
+    else if (op->address_mode == ABS_Y)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%02X%02X,Y @ ", pc, opcode, LSB, MSB, op->name, MSB, LSB);
+        entry->kind = DISASM_ABS_Y;
+    }
+    else if (op->address_mode == ZPG_X)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  $%02X,X @ ", pc, opcode, LSB, op->name, LSB);
+        entry->kind = DISASM_ZPG_X;
+    }
+    else if (op->address_mode == ZPG_Y)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  $%02X,Y @ ", pc, opcode, LSB, op->name, LSB);
+        entry->kind = DISASM_ZPG_Y;
+    }
+    else if (op->address_mode == IND)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  ($%02X%02X) = ", pc, opcode, LSB, MSB, op->name, MSB, LSB);
+        entry->kind = DISASM_IND;
+    }
+    else if (op->address_mode == IND_X)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  ($%02X,X) @ ", pc, opcode, LSB, op->name, LSB);
+        entry->kind = DISASM_IND_X;
+    }
+    else if (op->address_mode == IND_Y)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  ($%02X),Y = ", pc, opcode, LSB, op->name, LSB);
+        entry->kind = DISASM_IND_Y;
+    }
+    else if (op->address_mode == REL)
+    {
+        // Sign extend the branch offset. The target is printed as an int like the original trace.
+        temp = LSB & 0x00FF;
+        if (LSB & 0x80)
+        {
+            temp = LSB | 0xFF00;
+        }
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  $%02X \t\t\t", pc, opcode, LSB, op->name, pc + 2 + temp);
+    }
+#if C6502_CMOS
+    else if (op->address_mode == ZPG_IND)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X     %4s  ($%02X) \t\t\t", pc, opcode, LSB, op->name, LSB);
+    }
+    else if (op->address_mode == ABS_IND_X)
+    {
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  ($%02X%02X,X) \t\t", pc, opcode, LSB, MSB, op->name, MSB, LSB);
+    }
+    else if (op->address_mode == ZPG_REL)
+    {
+        temp = (uint16_t)(int8_t)MSB;
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%02X,$%04X \t\t", pc, opcode, LSB, MSB, op->name, LSB,
+                       (uint16_t)(pc + 3 + temp));
+    }
+#endif
+    else
+    {
+        len = snprintf(text, size, "%-4X %02X %02X %02X  %4s  $%02X%02X \t\t\t", pc, opcode, LSB, MSB, op->name, MSB, LSB);
+    }
+
+    entry->len = (len > 0 && len < (int)size) ? len : size - 1;
+}
+
+// Return cache entry for pc, rendering it if not valid.
+static disasm_entry *disasm_lookup(uint16_t pc)
+{
+    disasm_entry *page = disasm_pages[pc >> 8];
+
+    if (!page)
+    {
+        page = calloc(256, sizeof(disasm_entry));
+        if (!page)
+        {
+            return NULL;
+        }
+        disasm_pages[pc >> 8] = page;
+    }
+
+    disasm_entry *entry = &page[pc & 0xFF];
+    if (entry->len == 0)
+    {
+        disasm_render(entry, pc);
+    }
+    return entry;
+}
+
+// c6502_disasm_prefix() Return cached static prefix.
+const char *c6502_disasm_prefix(uint16_t pc)
+{
+    disasm_entry *entry = disasm_lookup(pc);
+    return entry ? entry->text : "";
+}
+
+// c6502_disasm_print() Print cached prefix, effective address contents and registers.
+void c6502_disasm_print(FILE *fp)
+{
+    disasm_entry *entry = disasm_lookup(c6502.PC);
+    if (!entry)
+    {
+        return;
+    }
+
+    uint16_t LSB = entry->LSB;
+    uint16_t MSB = entry->MSB;
+    uint16_t temp = 0;
+    uint16_t temp2 = 0;
+    uint16_t temp3 = 0;
+
+    fwrite(entry->text, 1, entry->len, fp);
+
+    switch (entry->kind)
+    {
+    case DISASM_ABS:
+        temp = (MSB << 8) | LSB;
+        fprintf(fp, "%02X \t\t", bus_peek(temp));
+        break;
+    case DISASM_ZPG:
+        fprintf(fp, "%02X \t\t\t", bus_peek(LSB));
+        break;
+    case DISASM_ABS_X:
+        temp = ((MSB << 8) | LSB) + c6502.X;
+        fprintf(fp, "%04X = %02X \t", temp, bus_peek(temp));
+        break;
+    case DISASM_ABS_Y:
+        temp = ((MSB << 8) | LSB) + c6502.Y;
+        fprintf(fp, "%04X = %02X \t", temp, bus_peek(temp));
+        break;
+    case DISASM_ZPG_X:
+        temp = (LSB + c6502.X) & 0x00FF;
+        fprintf(fp, "%02X = %02X \t\t", temp, bus_peek(temp));
+        break;
+    case DISASM_ZPG_Y:
+        temp = (LSB + c6502.Y) & 0x00FF;
+        fprintf(fp, "%02X = %02X \t\t", temp, bus_peek(temp));
+        break;
+    case DISASM_IND:
+        // Replicate the indirect JMP page boundary bug, fixed on the 65C02.
+        temp2 = (MSB << 8) | LSB;
+        if (!C6502_CMOS && LSB == 0x00FF)
+        {
+            temp = bus_peek(temp2 & 0xFF00) << 8 | bus_peek(temp2);
+        }
+        else
+        {
+            temp = bus_peek(temp2 + 1) << 8 | bus_peek(temp2);
+        }
+        fprintf(fp, "%04X \t\t", temp);
+        break;
+    case DISASM_IND_X:
+        temp2 = (uint16_t)bus_peek((uint16_t)(LSB + (uint16_t)c6502.X) & 0x00FF);
+        temp3 = (uint16_t)bus_peek((uint16_t)(LSB + 1 + (uint16_t)c6502.X) & 0x00FF);
+        temp = (temp3 << 8) | temp2;
+        fprintf(fp, "%02X = %04X = %02X \t", LSB + c6502.X, temp, bus_peek(temp));
+        break;
+    case DISASM_IND_Y:
+        temp2 = (uint16_t)bus_peek((uint16_t)(LSB) & 0x00FF);
+        temp3 = (uint16_t)bus_peek((uint16_t)(LSB + 1) & 0x00FF);
+        temp = ((temp3 << 8) | temp2) + c6502.Y;
+        fprintf(fp, "%02X%02X @ %04X = %02X ", temp3, temp2, temp, bus_peek(temp));
+        break;
+    default:
+        break;
+    }
+
+    fprintf(fp, "A:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6llu\n", c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, (unsigned long long)c6502.cycles);
+}
@@ -0,0 +1,44 @@
+// disasm.h
+
+#ifndef DISASM_H
+#define DISASM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Disassembly cache for the nestest.log style trace.
+
+The static part of a trace line (PC, instruction bytes, mnemonic and operand) only depends
+on the three bytes at PC, so it is rendered once and cached per PC. Cache pages are allocated
+on first use. A bus write hook drops cached entries whose bytes are overwritten.
+Only the effective address contents and the registers are formatted for every line.
+
+Writes made directly to ADDRESS (for example loading a rom) bypass the write hook,
+call c6502_disasm_invalidate_all() afterwards.
+*/
+
+// Size of a cached static prefix, including the terminating zero.
+#define C6502_DISASM_TEXT 44
+
+// Install the bus write hook. Return false if no hook slot is free.
+bool c6502_disasm_init(void);
+
+// Remove the bus write hook and free the cache.
+void c6502_disasm_free(void);
+
+// Drop every cached entry.
+void c6502_disasm_invalidate_all(void);
+
+// Return the cached static prefix for the instruction at pc, rendering it if needed.
+const char *c6502_disasm_prefix(uint16_t pc);
+
+/*
+Print the trace line for the instruction at c6502.PC.
+Call after c6502_read_opcode() and before the instruction runs.
+*/
+void c6502_disasm_print(FILE *fp);
+
+#endif
@@ -0,0 +1,486 @@
+/*
+fuzz.c
+c6502-fuzz differential fuzzer. Runs random machines on the reference interpreter and on the
+lockstep engine side by side and compares them after every instruction.
+
+Every case is a random 64KB memory image plus random registers, generated from the seed and
+the case number, so a case can be reproduced from those two numbers. Cases run in batches of
+C6502_LOCKSTEP_LANES lanes on all cores. After each instruction the registers, cycles, jam flag
+and the bus writes of the instruction are compared.
+
+Only opcodes with a vector kernel run different code on the two sides; every other opcode runs
+the same lookup_table handler on both. So a share of the memory bytes (-k, default 50%) is
+replaced by kernel opcodes, and the summary reports how many of the compared instructions went
+through a vector kernel.
+
+A failing case is minimized: the shortest tail of the instruction sequence that still fails is
+found by restarting from the reference state a few instructions before the mismatch, then every
+memory page and byte that is not needed for the failure is cleared.
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "c6502.h"
+#include "lockstep.h"
+
+// Maximum bus writes logged per instruction.
+#define FUZZ_MAX_WRITES 8
+
+typedef struct
+{
+    int count;
+    uint16_t address[FUZZ_MAX_WRITES];
+    uint8_t data[FUZZ_MAX_WRITES];
+} fuzz_writes;
+
+typedef struct
+{
+    c6502_cpu cpu;
+    uint8_t *memory;
+} fuzz_case;
+
+// Per thread totals.
+typedef struct
+{
+    uint64_t cases;
+    uint64_t vector;
+    uint64_t scalar;
+} fuzz_totals;
+
+static uint64_t seed = 1;
+static uint64_t case_total = 100000;
+static int steps = 100;
+static int max_failures = 10;
+static int kernel_percent = 50;
+// Opcodes with a vector kernel.
+static uint8_t kernel_opcodes[256];
+static int kernel_count = 0;
+static atomic_ullong next_batch = 0;
+static atomic_int failures = 0;
+static pthread_mutex_t print_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Write logs of the current thread. Writes are matched to a lane through bus_memory.
+static C6502_THREAD_LOCAL c6502_lockstep *hook_engine = NULL;
+static C6502_THREAD_LOCAL fuzz_writes *hook_engine_writes = NULL;
+static C6502_THREAD_LOCAL fuzz_writes *hook_reference_writes = NULL;
+
+static void fuzz_log(fuzz_writes *log, uint16_t abs_address, uint8_t data)
+{
+    if (log->count < FUZZ_MAX_WRITES)
+    {
+        log->address[log->count] = abs_address;
+        log->data[log->count] = data;
+    }
+    log->count++;
+}
+
+// Bus write hook. Log the write of the reference step or of the lockstep lane that made it.
+static void fuzz_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+    if (hook_reference_writes)
+    {
+        fuzz_log(hook_reference_writes, abs_address, data);
+        return;
+    }
+    for (int i = 0; hook_engine && i < hook_engine->lanes; i++)
+    {
+        if (hook_engine->memory[i] == bus_memory)
+        {
+            fuzz_log(&hook_engine_writes[i], abs_address, data);
+            return;
+        }
+    }
+}
+
+// splitmix64 step.
+static uint64_t fuzz_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Fill case number n with random memory and registers.
+static void fuzz_generate(uint64_t n, fuzz_case *c)
+{
+    uint64_t state = seed ^ (n * 0xD1B54A32D192ED03ULL);
+
+    for (int i = 0; i < 65536; i += 8)
+    {
+        uint64_t r = fuzz_random(&state);
+        memcpy(&c->memory[i], &r, 8);
+    }
+    // Replace kernel_percent of the bytes with kernel opcodes, so the kernels run often.
+    for (int i = 0; i < 65536 && kernel_count; i++)
+    {
+        uint64_t r = fuzz_random(&state);
+        if ((int)(r % 100) < kernel_percent)
+        {
+            c->memory[i] = kernel_opcodes[(r >> 32) % kernel_count];
+        }
+    }
+    uint64_t r = fuzz_random(&state);
+    memset(&c->cpu, 0, sizeof(c6502_cpu));
+    c->cpu.A = r;
+    c->cpu.X = r >> 8;
+    c->cpu.Y = r >> 16;
+    c->cpu.SP = r >> 24;
+    c->cpu.SR = (r >> 32) | U;
+    c->cpu.PC = r >> 40;
+}
+
+// Run one reference instruction on memory, logging its writes.
+static void fuzz_reference_step(c6502_cpu *cpu, uint8_t *memory, fuzz_writes *writes)
+{
+    writes->count = 0;
+    hook_reference_writes = writes;
+    c6502 = *cpu;
+    bus_memory = memory;
+    c6502_step();
+    *cpu = c6502;
+    bus_memory = NULL;
+    hook_reference_writes = NULL;
+}
+
+// Return true if the reference and the lane agree after an instruction.
+static bool fuzz_compare(const c6502_cpu *cpu, const fuzz_writes *ref, const c6502_lockstep *ls, int lane,
+                         const fuzz_writes *engine)
+{
+    if (cpu->A != ls->A[lane] || cpu->X != ls->X[lane] || cpu->Y != ls->Y[lane] ||
+        cpu->SP != ls->SP[lane] || cpu->SR != ls->SR[lane] || cpu->PC != ls->PC[lane] ||
+        cpu->cycles != ls->cycles[lane] || (cpu->JAM != 0) != (ls->JAM[lane] != 0) ||
+        ref->count != engine->count)
+    {
+        return false;
+    }
+    for (int i = 0; i < ref->count && i < FUZZ_MAX_WRITES; i++)
+    {
+        if (ref->address[i] != engine->address[i] || ref->data[i] != engine->data[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Run cases side by side for up to count instructions.
+Return the instruction index at which each lane first disagrees in mismatch[], or -1.
+*/
+static void fuzz_run(fuzz_case *cases, int lanes, int count, c6502_lockstep *ls, uint8_t **ref_memory, int *mismatch)
+{
+    fuzz_writes engine_writes[C6502_LOCKSTEP_LANES];
+    fuzz_writes ref_writes;
+    c6502_cpu ref[C6502_LOCKSTEP_LANES];
+    int live = lanes;
+
+    ls->lanes = lanes;
+    for (int i = 0; i < lanes; i++)
+    {
+        memcpy(ls->memory[i], cases[i].memory, 65536);
+        memcpy(ref_memory[i], cases[i].memory, 65536);
+        ref[i] = cases[i].cpu;
+        ls->A[i] = ref[i].A;
+        ls->X[i] = ref[i].X;
+        ls->Y[i] = ref[i].Y;
+        ls->SP[i] = ref[i].SP;
+        ls->SR[i] = ref[i].SR;
+        ls->PC[i] = ref[i].PC;
+        ls->JAM[i] = ref[i].JAM;
+        ls->cycles[i] = ref[i].cycles;
+        mismatch[i] = -1;
+    }
+
+    hook_engine = ls;
+    hook_engine_writes = engine_writes;
+    for (int step = 0; step < count && live > 0; step++)
+    {
+        memset(engine_writes, 0, sizeof(engine_writes));
+        c6502_lockstep_step(ls);
+
+        for (int i = 0; i < lanes; i++)
+        {
+            if (mismatch[i] >= 0 || ref[i].JAM)
+            {
+                continue;
+            }
+            fuzz_reference_step(&ref[i], ref_memory[i], &ref_writes);
+            if (!fuzz_compare(&ref[i], &ref_writes, ls, i, &engine_writes[i]))
+            {
+                mismatch[i] = step;
+                // Stop the lane so later steps can not cascade.
+                ls->JAM[i] = 1;
+                live--;
+            }
+        }
+    }
+    hook_engine = NULL;
+    hook_engine_writes = NULL;
+}
+
+// Return true if c still fails within count instructions.
+static bool fuzz_fails(fuzz_case *c, int count, c6502_lockstep *ls, uint8_t **ref_memory)
+{
+    int mismatch = -1;
+    fuzz_run(c, 1, count, ls, ref_memory, &mismatch);
+    return mismatch >= 0;
+}
+
+/*
+Minimize a case that fails at instruction index fail. Return the number of instructions of the
+minimized case in c, which is rewritten in place.
+*/
+static int fuzz_minimize(fuzz_case *c, int fail, c6502_lockstep *ls, uint8_t **ref_memory, uint8_t *scratch)
+{
+    fuzz_case start = {c->cpu, scratch};
+    fuzz_writes writes;
+    int length = fail + 1;
+
+    // Shortest tail: start from the reference state before instruction fail + 1 - n.
+    for (int n = 1; n <= fail + 1; n++)
+    {
+        memcpy(scratch, c->memory, 65536);
+        start.cpu = c->cpu;
+        for (int i = 0; i < fail + 1 - n; i++)
+        {
+            fuzz_reference_step(&start.cpu, scratch, &writes);
+        }
+        if (fuzz_fails(&start, n, ls, ref_memory))
+        {
+            memcpy(c->memory, scratch, 65536);
+            c->cpu = start.cpu;
+            length = n;
+            break;
+        }
+    }
+
+    // Clear whole pages, then single bytes, keeping only what the failure needs.
+    for (int page = 0; page < 256; page++)
+    {
+        uint8_t saved[256];
+        memcpy(saved, &c->memory[page << 8], 256);
+        memset(&c->memory[page << 8], 0, 256);
+        if (!fuzz_fails(c, length, ls, ref_memory))
+        {
+            memcpy(&c->memory[page << 8], saved, 256);
+            for (int i = page << 8; i < (page + 1) << 8; i++)
+            {
+                uint8_t byte = c->memory[i];
+                if (byte == 0)
+                {
+                    continue;
+                }
+                c->memory[i] = 0;
+                if (!fuzz_fails(c, length, ls, ref_memory))
+                {
+                    c->memory[i] = byte;
+                }
+            }
+        }
+    }
+    return length;
+}
+
+// Print the minimized case with the registers of both sides after its last instruction.
+static void fuzz_report(uint64_t n, int fail, fuzz_case *c, int length, c6502_lockstep *ls, uint8_t **ref_memory)
+{
+    fuzz_writes writes;
+    c6502_cpu ref = c->cpu;
+    int mismatch = -1;
+
+    memcpy(ref_memory[1], c->memory, 65536);
+    for (int i = 0; i < length; i++)
+    {
+        fuzz_reference_step(&ref, ref_memory[1], &writes);
+    }
+    fuzz_run(c, 1, length, ls, ref_memory, &mismatch);
+
+    pthread_mutex_lock(&print_lock);
+    printf("MISMATCH seed %llu case %llu instruction %d, minimized to %d instruction(s)\n",
+           (unsigned long long)seed, (unsigned long long)n, fail, length);
+    printf("  start     A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X\n",
+           c->cpu.A, c->cpu.X, c->cpu.Y, c->cpu.SR, c->cpu.SP, c->cpu.PC);
+    printf("  memory   ");
+    for (int i = 0; i < 65536; i++)
+    {
+        if (c->memory[i])
+        {
+            printf(" %04X=%02X", i, c->memory[i]);
+        }
+    }
+    printf("\n");
+    printf("  reference A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%llu\n",
+           ref.A, ref.X, ref.Y, ref.SR, ref.SP, ref.PC, (unsigned long long)ref.cycles);
+    printf("  lockstep  A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%llu\n",
+           ls->A[0], ls->X[0], ls->Y[0], ls->SR[0], ls->SP[0], ls->PC[0], (unsigned long long)ls->cycles[0]);
+    pthread_mutex_unlock(&print_lock);
+}
+
+static void *fuzz_worker(void *arg)
+{
+    static const int lanes = C6502_LOCKSTEP_LANES;
+    fuzz_case cases[C6502_LOCKSTEP_LANES];
+    uint8_t *ref_memory[C6502_LOCKSTEP_LANES];
+    uint8_t *scratch = malloc(65536);
+    c6502_lockstep *ls = malloc(sizeof(c6502_lockstep));
+    int mismatch[C6502_LOCKSTEP_LANES];
+    fuzz_totals *totals = arg;
+
+    if (!scratch || !ls || !c6502_lockstep_init(ls, lanes) || !bus_add_write_hook(fuzz_write, NULL))
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < lanes; i++)
+    {
+        cases[i].memory = malloc(65536);
+        ref_memory[i] = malloc(65536);
+        if (!cases[i].memory || !ref_memory[i])
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    for (;;)
+    {
+        uint64_t first = atomic_fetch_add(&next_batch, lanes);
+        if (first >= case_total || atomic_load(&failures) >= max_failures)
+        {
+            break;
+        }
+        int count = (case_total - first < (uint64_t)lanes) ? (int)(case_total - first) : lanes;
+
+        for (int i = 0; i < count; i++)
+        {
+            fuzz_generate(first + i, &cases[i]);
+        }
+        uint64_t vector = ls->vector_count;
+        uint64_t scalar = ls->scalar_count;
+        fuzz_run(cases, count, steps, ls, ref_memory, mismatch);
+        totals->cases += count;
+        totals->vector += ls->vector_count - vector;
+        totals->scalar += ls->scalar_count - scalar;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (mismatch[i] >= 0 && atomic_fetch_add(&failures, 1) < max_failures)
+            {
+                fuzz_generate(first + i, &cases[i]);
+                int length = fuzz_minimize(&cases[i], mismatch[i], ls, ref_memory, scratch);
+                fuzz_report(first + i, mismatch[i], &cases[i], length, ls, ref_memory);
+            }
+        }
+    }
+
+    bus_remove_write_hook(fuzz_write, NULL);
+    for (int i = 0; i < lanes; i++)
+    {
+        free(cases[i].memory);
+        free(ref_memory[i]);
+    }
+    c6502_lockstep_free(ls);
+    free(ls);
+    free(scratch);
+    return NULL;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-fuzz [-s seed] [-n cases] [-i instructions] [-k percent] [-m failures] [-j threads]\n");
+    printf("  -s seed          random seed, default 1\n");
+    printf("  -n cases         number of random machines, default 100000\n");
+    printf("  -i instructions  instructions per case, default 100\n");
+    printf("  -k percent       share of memory bytes replaced by vector kernel opcodes, default 50\n");
+    printf("  -m failures      stop after this many mismatches, default 10\n");
+    printf("  -j threads       worker threads, default one per online cpu\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-s") == 0)
+        {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (has_value && strcmp(argv[i], "-n") == 0)
+        {
+            case_total = strtoull(argv[++i], NULL, 10);
+        }
+        else if (has_value && strcmp(argv[i], "-i") == 0)
+        {
+            steps = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-k") == 0)
+        {
+            kernel_percent = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-m") == 0)
+        {
+            max_failures = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-j") == 0)
+        {
+            thread_count = atoi(argv[++i]);
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (thread_count < 1 || steps < 1 || kernel_percent < 0 || kernel_percent > 100)
+    {
+        usage();
+        return 1;
+    }
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        if (c6502_lockstep_vectorized(opcode))
+        {
+            kernel_opcodes[kernel_count++] = opcode;
+        }
+    }
+
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    fuzz_totals *totals = calloc(thread_count, sizeof(fuzz_totals));
+    if (!threads || !totals)
+    {
+        return 1;
+    }
+    for (int i = 0; i < thread_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, fuzz_worker, &totals[i]) != 0)
+        {
+            fprintf(stderr, "Unable to start worker thread\n");
+            return 1;
+        }
+    }
+    fuzz_totals total = {0};
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+        total.cases += totals[i].cases;
+        total.vector += totals[i].vector;
+        total.scalar += totals[i].scalar;
+    }
+
+    int found = atomic_load(&failures);
+    uint64_t compared = total.vector + total.scalar;
+    printf("%llu cases, %d instructions each, %d mismatch(es)\n", (unsigned long long)total.cases, steps, found);
+    printf("%llu instructions compared, %llu (%.1f%%) through vector kernels, %llu through the interpreter\n",
+           (unsigned long long)compared, (unsigned long long)total.vector,
+           compared ? 100.0 * total.vector / compared : 0.0, (unsigned long long)total.scalar);
+    free(threads);
+    free(totals);
+    return found ? 1 : 0;
+}
@@ -0,0 +1,698 @@
+/*
+gen.c
+c6502-gen writes synthetic 6502 programs with a chosen instruction mix and addressing mode mix.
+
+The program is a flat image for c6502-run (or c6502_load_binary()) that runs a generated loop
+body forever, or a given number of times and then traps. Instructions are drawn slot by slot:
+first a class by the -m weights, then an addressing mode by the -a weights among the modes that
+class has, then an official opcode with that class and mode from lookup_table. Because every
+opcode comes from lookup_table, its length and cycle cost are known while generating, and the
+expected cycles per pass of the loop are printed with the program.
+
+The generator tracks X and Y, so every effective address is known up front:
+    reads and writes go to zero page $00-$7F or to pages $02-$07, never to code or stack,
+    indexed modes cross a page with the -x probability (only possible while the index is not 0),
+    branches are taken with the -t probability. Each branch is preceded by the instruction that
+    decides it (CLC, SEC, CLV, BIT or CPX #) and both count as one branch slot. A taken branch
+    lands on the next instruction.
+Instructions that would make X, Y or the stack unknown (TAX, TAY, TSX, TXS, LDX/LDY from memory,
+JMP indirect) and SED, SEI, CLI, BRK, RTI are never generated. Pushes and pulls stay balanced.
+JSR calls a subroutine that only returns, JMP jumps to the next instruction.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "c6502.h"
+
+#define GEN_BASE 0x0800
+#define GEN_SLOTS 1000
+// Deepest PHA/PHP nesting the generator builds.
+#define GEN_MAX_PUSH 32
+// Bytes kept free for the loop end and the subroutine.
+#define GEN_RESERVE 64
+
+// Zero page used by the generated code: pointers for (ind),Y and (ind,X), a BIT operand with
+// only V set, and the loop counter.
+#define GEN_POINTER_LOW 0xF0   // -> $0600, page crossing impossible
+#define GEN_POINTER_HIGH 0xF2  // -> $05FF, page crossing when Y > 0
+#define GEN_BIT_V 0xE2
+#define GEN_COUNTER 0xE8
+
+// Opcodes of the branch condition setters and the loop frame.
+#define OP_CLC 0x18
+#define OP_SEC 0x38
+#define OP_CLV 0xB8
+#define OP_CLD 0xD8
+#define OP_BIT_ZPG 0x24
+#define OP_CPX_IMM 0xE0
+#define OP_LDA_IMM 0xA9
+#define OP_LDX_IMM 0xA2
+#define OP_LDY_IMM 0xA0
+#define OP_STA_ZPG 0x85
+#define OP_DEC_ZPG 0xC6
+#define OP_TXS 0x9A
+#define OP_PHA 0x48
+#define OP_PHP 0x08
+#define OP_PLA 0x68
+#define OP_PLP 0x28
+#define OP_BNE 0xD0
+#define OP_BEQ 0xF0
+#define OP_JMP 0x4C
+#define OP_RTS 0x60
+
+typedef enum
+{
+    GEN_LOAD,
+    GEN_STORE,
+    GEN_ALU,
+    GEN_RMW,
+    GEN_BRANCH,
+    GEN_JUMP,
+    GEN_STACK,
+    GEN_REGISTER,
+    GEN_CLASSES,
+} gen_class;
+
+static const char *const class_names[GEN_CLASSES] = {"load", "store", "alu", "rmw", "branch", "jump", "stack", "register"};
+
+typedef struct
+{
+    const char *name;
+    void (*mode)(void);
+} gen_mode;
+
+static const gen_mode modes[] = {
+    {"imm", &IMMED}, {"zp", &ZPG},    {"zpx", &ZPG_X},  {"zpy", &ZPG_Y}, {"abs", &ABS},   {"absx", &ABS_X},
+    {"absy", &ABS_Y}, {"indx", &IND_X}, {"indy", &IND_Y}, {"acc", &A},    {"impl", &IMPL}, {"rel", &REL},
+};
+
+#define GEN_MODES (int)(sizeof(modes) / sizeof(modes[0]))
+
+// Opcodes per class and mode.
+static uint8_t candidates[GEN_CLASSES][GEN_MODES][16];
+static int candidate_count[GEN_CLASSES][GEN_MODES];
+
+static int class_weight[GEN_CLASSES];
+static int mode_weight[GEN_MODES];
+static int taken_percent = 50;
+static int cross_percent = 10;
+static uint64_t seed = 1;
+
+static uint8_t image[65536];
+static uint16_t base = GEN_BASE;
+static size_t size = 0;
+
+// Generator state: index registers and pushed opcodes.
+static uint8_t X = 0;
+static uint8_t Y = 0;
+static uint8_t pushed[GEN_MAX_PUSH];
+static int depth = 0;
+
+// Image offsets of JSR operands, patched once the subroutine address is known.
+static size_t *calls = NULL;
+static int call_count = 0;
+
+// Statistics of the loop body.
+static int slot_count[GEN_CLASSES];
+static int mode_count[GEN_MODES];
+static uint64_t instructions = 0;
+static uint64_t cycles = 0;
+static int branches = 0;
+static int taken = 0;
+static int indexed = 0;
+static int crossings = 0;
+
+// splitmix64 step.
+static uint64_t gen_random(void)
+{
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int gen_percent(void)
+{
+    return (int)(gen_random() % 100);
+}
+
+// Return the index in modes of the address mode of opcode, or -1.
+static int gen_mode_of(uint8_t opcode)
+{
+    for (int m = 0; m < GEN_MODES; m++)
+    {
+        if (lookup_table[opcode].address_mode == modes[m].mode)
+        {
+            return m;
+        }
+    }
+    return -1;
+}
+
+// Return the class of an official opcode, or -1 for opcodes the generator never emits.
+static int gen_class_of(uint8_t opcode)
+{
+    const c6502_instruction *in = &lookup_table[opcode];
+    void (*run)(void) = in->run;
+
+    if (in->name[0] == '*' || run == &UNK || run == &JAM)
+    {
+        return -1;
+    }
+    if (run == &LDA || ((run == &LDX || run == &LDY) && in->address_mode == &IMMED))
+    {
+        return GEN_LOAD;
+    }
+    if (run == &STA || run == &STX || run == &STY)
+    {
+        return GEN_STORE;
+    }
+    if (run == &ADC || run == &SBC || run == &AND || run == &ORA || run == &EOR || run == &CMP ||
+        run == &CPX || run == &CPY || run == &BIT)
+    {
+        return GEN_ALU;
+    }
+    if (run == &ASL || run == &LSR || run == &ROL || run == &ROR || run == &INC || run == &DEC)
+    {
+        return GEN_RMW;
+    }
+    if (in->address_mode == &REL)
+    {
+        return GEN_BRANCH;
+    }
+    if (run == &JSR || (run == &JMP && in->address_mode == &ABS))
+    {
+        return GEN_JUMP;
+    }
+    if (run == &PHA || run == &PHP || run == &PLA || run == &PLP)
+    {
+        return GEN_STACK;
+    }
+    if (run == &INX || run == &INY || run == &DEX || run == &DEY || run == &TXA || run == &TYA ||
+        run == &CLC || run == &SEC || run == &CLV || run == &NOP)
+    {
+        return GEN_REGISTER;
+    }
+    return -1;
+}
+
+// Sort official opcodes into candidates by class and address mode.
+static void gen_init_candidates(void)
+{
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        int class = gen_class_of(opcode);
+        int mode = gen_mode_of(opcode);
+
+        if (class >= 0 && mode >= 0 && candidate_count[class][mode] < 16)
+        {
+            candidates[class][mode][candidate_count[class][mode]++] = opcode;
+        }
+    }
+}
+
+// True if opcode pays a cycle when its indexed address crosses a page.
+static bool gen_crossing_penalty(uint8_t opcode)
+{
+    void (*run)(void) = lookup_table[opcode].run;
+
+    return run == &LDA || run == &LDX || run == &LDY || run == &ADC || run == &SBC || run == &AND ||
+           run == &ORA || run == &EOR || run == &CMP;
+}
+
+// Append opcode and its operand, count its base cycles.
+static void gen_emit(uint8_t opcode, uint16_t operand)
+{
+    uint8_t bytes = c6502_instruction_bytes(opcode);
+
+    image[size++] = opcode;
+    if (bytes > 1)
+    {
+        image[size++] = operand & 0xFF;
+    }
+    if (bytes > 2)
+    {
+        image[size++] = operand >> 8;
+    }
+    instructions++;
+    cycles += lookup_table[opcode].cycles;
+}
+
+static uint16_t gen_pc(void)
+{
+    return (uint16_t)(base + size);
+}
+
+// Pick an index from weights. Return -1 if all weights are 0.
+static int gen_pick(const int *weights, int count)
+{
+    int total = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        total += weights[i];
+    }
+    if (total == 0)
+    {
+        return -1;
+    }
+    int r = (int)(gen_random() % total);
+    for (int i = 0; i < count; i++)
+    {
+        if (r < weights[i])
+        {
+            return i;
+        }
+        r -= weights[i];
+    }
+    return count - 1;
+}
+
+/*
+Return the low byte of an indexed base address. With crossing wanted and index > 0 the base is
+chosen so that base + index passes the page end.
+*/
+static uint8_t gen_indexed_low(uint8_t opcode, uint8_t index)
+{
+    bool cross = index > 0 && gen_percent() < cross_percent;
+
+    indexed++;
+    if (cross)
+    {
+        crossings++;
+        cycles += gen_crossing_penalty(opcode);
+        return (uint8_t)(0x100 - index + gen_random() % index);
+    }
+    return (uint8_t)(gen_random() % (0x100 - index));
+}
+
+// Return the operand for opcode in mode, keeping effective addresses inside the data areas.
+static uint16_t gen_operand(uint8_t opcode, int mode)
+{
+    void (*address_mode)(void) = modes[mode].mode;
+    // Base pages $02-$06, so an indexed access ends below $07FF.
+    uint16_t page = (uint16_t)(0x02 + gen_random() % 5) << 8;
+
+    if (address_mode == &IMMED)
+    {
+        return gen_random() & 0xFF;
+    }
+    if (address_mode == &ZPG)
+    {
+        return gen_random() & 0x7F;
+    }
+    if (address_mode == &ZPG_X)
+    {
+        return ((gen_random() & 0x7F) - X) & 0xFF;
+    }
+    if (address_mode == &ZPG_Y)
+    {
+        return ((gen_random() & 0x7F) - Y) & 0xFF;
+    }
+    if (address_mode == &ABS)
+    {
+        return page | (gen_random() & 0xFF);
+    }
+    if (address_mode == &ABS_X)
+    {
+        return page | gen_indexed_low(opcode, X);
+    }
+    if (address_mode == &ABS_Y)
+    {
+        return page | gen_indexed_low(opcode, Y);
+    }
+    if (address_mode == &IND_X)
+    {
+        return (GEN_POINTER_LOW - X) & 0xFF;
+    }
+    if (address_mode == &IND_Y)
+    {
+        // Decide the crossing as for absolute indexed, then pick the pointer that gives it:
+        // $0600 + Y never crosses, $05FF + Y crosses for any Y > 0.
+        return gen_indexed_low(opcode, Y) > 0xFF - Y ? GEN_POINTER_HIGH : GEN_POINTER_LOW;
+    }
+    return 0;
+}
+
+// Emit the condition setter and branch opcode, taken with the -t probability.
+static void gen_branch(uint8_t opcode)
+{
+    void (*run)(void) = lookup_table[opcode].run;
+    bool take = gen_percent() < taken_percent;
+
+    if (run == &BCC || run == &BCS)
+    {
+        gen_emit((run == &BCS) == take ? OP_SEC : OP_CLC, 0);
+    }
+    else if (run == &BVC || run == &BVS)
+    {
+        if ((run == &BVS) == take)
+        {
+            gen_emit(OP_BIT_ZPG, GEN_BIT_V);
+        }
+        else
+        {
+            gen_emit(OP_CLV, 0);
+        }
+    }
+    else if (run == &BEQ || run == &BNE)
+    {
+        // X - X sets Z, X - (X + 1) clears it.
+        gen_emit(OP_CPX_IMM, (run == &BEQ) == take ? X : (uint8_t)(X + 1));
+    }
+    else
+    {
+        // X - X clears N, X - (X - $80) sets it.
+        gen_emit(OP_CPX_IMM, (run == &BMI) == take ? (uint8_t)(X - 0x80) : X);
+    }
+    gen_emit(opcode, 0);
+    branches++;
+    taken += take;
+    cycles += take;
+}
+
+// Emit a push or a pull, turned around where needed to keep the stack balanced.
+static void gen_stack(uint8_t opcode)
+{
+    bool pull = (opcode == OP_PLA || opcode == OP_PLP);
+
+    if (pull && depth == 0)
+    {
+        opcode = (opcode == OP_PLA) ? OP_PHA : OP_PHP;
+        pull = false;
+    }
+    else if (!pull && depth == GEN_MAX_PUSH)
+    {
+        opcode = OP_PLA;
+        pull = true;
+    }
+    if (pull)
+    {
+        // Only a status byte pushed by PHP goes back into SR.
+        if (pushed[--depth] != OP_PHP)
+        {
+            opcode = OP_PLA;
+        }
+    }
+    else
+    {
+        pushed[depth++] = opcode;
+    }
+    gen_emit(opcode, 0);
+}
+
+// Emit one slot.
+static void gen_slot(void)
+{
+    int class = -1;
+    int mode = -1;
+    int weights[GEN_MODES];
+    int class_weights[GEN_CLASSES];
+
+    for (int c = 0; c < GEN_CLASSES; c++)
+    {
+        bool available = false;
+        for (int m = 0; m < GEN_MODES; m++)
+        {
+            available = available || candidate_count[c][m] > 0;
+        }
+        class_weights[c] = available ? class_weight[c] : 0;
+    }
+    class = gen_pick(class_weights, GEN_CLASSES);
+    if (class < 0)
+    {
+        class = GEN_REGISTER;
+    }
+
+    // Mode by weight among the modes of the class, any of them if all their weights are 0.
+    for (int m = 0; m < GEN_MODES; m++)
+    {
+        weights[m] = candidate_count[class][m] > 0 ? mode_weight[m] : 0;
+    }
+    mode = gen_pick(weights, GEN_MODES);
+    if (mode < 0)
+    {
+        for (int m = 0; m < GEN_MODES; m++)
+        {
+            weights[m] = candidate_count[class][m] > 0;
+        }
+        mode = gen_pick(weights, GEN_MODES);
+    }
+
+    uint8_t opcode = candidates[class][mode][gen_random() % candidate_count[class][mode]];
+    void (*run)(void) = lookup_table[opcode].run;
+
+    slot_count[class]++;
+    mode_count[mode]++;
+    if (class == GEN_BRANCH)
+    {
+        gen_branch(opcode);
+    }
+    else if (class == GEN_STACK)
+    {
+        gen_stack(opcode);
+    }
+    else if (run == &JSR)
+    {
+        calls[call_count++] = size + 1;
+        gen_emit(opcode, 0);
+        instructions++;
+        cycles += lookup_table[OP_RTS].cycles;
+    }
+    else if (run == &JMP)
+    {
+        gen_emit(opcode, gen_pc() + 3);
+    }
+    else
+    {
+        uint16_t operand = gen_operand(opcode, mode);
+        gen_emit(opcode, operand);
+        X = (run == &LDX) ? (uint8_t)operand : (run == &INX) ? X + 1 : (run == &DEX) ? X - 1 : X;
+        Y = (run == &LDY) ? (uint8_t)operand : (run == &INY) ? Y + 1 : (run == &DEY) ? Y - 1 : Y;
+    }
+}
+
+/*
+Parse "name=weight,name=weight" into weights, names not listed get 0. The names are count
+string pointers stride bytes apart. Return false if a name is unknown.
+*/
+static bool gen_parse_weights(const char *arg, const char *const *names, size_t stride, int count, int *weights)
+{
+    char buf[256];
+
+    memset(weights, 0, count * sizeof(int));
+    strncpy(buf, arg, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (char *item = strtok(buf, ","); item; item = strtok(NULL, ","))
+    {
+        char *equals = strchr(item, '=');
+        int i = 0;
+
+        if (!equals)
+        {
+            return false;
+        }
+        *equals = '\0';
+        while (i < count && strcmp(*(const char *const *)((const char *)names + i * stride), item) != 0)
+        {
+            i++;
+        }
+        if (i == count)
+        {
+            return false;
+        }
+        weights[i] = atoi(equals + 1);
+    }
+    return true;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-gen [-n slots] [-m mix] [-a modes] [-t taken] [-x cross] [-r passes] [-b base] [-s seed] image\n");
+    printf("  -n slots   instruction slots in the loop body, default %d\n", GEN_SLOTS);
+    printf("  -m mix     class weights, e.g. load=40,branch=20,alu=30,store=10, default all equal\n");
+    printf("             classes: load store alu rmw branch jump stack register\n");
+    printf("  -a modes   addressing mode weights, e.g. absx=10,indy=10,zp=40, default all equal\n");
+    printf("             modes: imm zp zpx zpy abs absx absy indx indy acc impl rel\n");
+    printf("  -t taken   percent of branches taken, default 50\n");
+    printf("  -x cross   percent of indexed accesses crossing a page, default 10\n");
+    printf("  -r passes  run the loop body this many times then trap, default forever\n");
+    printf("  -b base    hex load and start address, default %04X\n", GEN_BASE);
+    printf("  -s seed    random seed, default 1\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int slots = GEN_SLOTS;
+    long passes = 0;
+    const char *path = NULL;
+
+    for (int c = 0; c < GEN_CLASSES; c++)
+    {
+        class_weight[c] = 1;
+    }
+    for (int m = 0; m < GEN_MODES; m++)
+    {
+        mode_weight[m] = 1;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-n") == 0)
+        {
+            slots = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-m") == 0 &&
+                 gen_parse_weights(argv[i + 1], class_names, sizeof(char *), GEN_CLASSES, class_weight))
+        {
+            i++;
+        }
+        else if (has_value && strcmp(argv[i], "-a") == 0 &&
+                 gen_parse_weights(argv[i + 1], &modes[0].name, sizeof(gen_mode), GEN_MODES, mode_weight))
+        {
+            i++;
+        }
+        else if (has_value && strcmp(argv[i], "-t") == 0)
+        {
+            taken_percent = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-x") == 0)
+        {
+            cross_percent = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-r") == 0)
+        {
+            passes = atol(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-b") == 0)
+        {
+            base = (uint16_t)strtoul(argv[++i], NULL, 16);
+        }
+        else if (has_value && strcmp(argv[i], "-s") == 0)
+        {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (argv[i][0] != '-' && !path)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (!path || slots < 1 || passes < 0 || passes > 65535 || base < 0x0800)
+    {
+        usage();
+        return 1;
+    }
+
+    gen_init_candidates();
+    calls = malloc(slots * sizeof(size_t));
+    if (!calls)
+    {
+        return 1;
+    }
+
+    // Prologue: stack, binary mode, pointers, the V only BIT operand, loop counter, X = Y = 0.
+    uint8_t counter_low = passes & 0xFF;
+    uint8_t counter_high = (passes >> 8) + (counter_low != 0);
+    const uint8_t prologue[][2] = {
+        {OP_LDX_IMM, 0xFF}, {OP_TXS, 0},           {OP_CLD, 0},
+        {OP_LDA_IMM, 0x00}, {OP_STA_ZPG, GEN_POINTER_LOW},  {OP_LDA_IMM, 0x06}, {OP_STA_ZPG, GEN_POINTER_LOW + 1},
+        {OP_LDA_IMM, 0xFF}, {OP_STA_ZPG, GEN_POINTER_HIGH}, {OP_LDA_IMM, 0x05}, {OP_STA_ZPG, GEN_POINTER_HIGH + 1},
+        {OP_LDA_IMM, 0x40}, {OP_STA_ZPG, GEN_BIT_V},
+        {OP_LDA_IMM, counter_low}, {OP_STA_ZPG, GEN_COUNTER}, {OP_LDA_IMM, counter_high}, {OP_STA_ZPG, GEN_COUNTER + 1},
+        {OP_LDX_IMM, 0x00}, {OP_LDY_IMM, 0x00},
+    };
+    for (size_t i = 0; i < sizeof(prologue) / sizeof(prologue[0]); i++)
+    {
+        gen_emit(prologue[i][0], prologue[i][1]);
+    }
+
+    // Loop body, counted from here.
+    uint16_t loop = gen_pc();
+    instructions = 0;
+    cycles = 0;
+    int generated = 0;
+    while (generated < slots && base + size + GEN_RESERVE + GEN_MAX_PUSH < 0x10000)
+    {
+        gen_slot();
+        generated++;
+    }
+    while (depth > 0)
+    {
+        gen_stack(OP_PLA);
+    }
+    gen_emit(OP_LDX_IMM, 0x00);
+    gen_emit(OP_LDY_IMM, 0x00);
+    uint64_t body_instructions = instructions;
+    uint64_t body_cycles = cycles;
+
+    // Loop end: forever, or a 16 bit pass counter then a trap.
+    uint16_t trap = 0;
+    if (passes == 0)
+    {
+        gen_emit(OP_JMP, loop);
+        body_instructions++;
+        body_cycles += lookup_table[OP_JMP].cycles;
+    }
+    else
+    {
+        gen_emit(OP_DEC_ZPG, GEN_COUNTER);
+        gen_emit(OP_BNE, 4);
+        gen_emit(OP_DEC_ZPG, GEN_COUNTER + 1);
+        gen_emit(OP_BEQ, 3);
+        gen_emit(OP_JMP, loop);
+        trap = gen_pc();
+        gen_emit(OP_JMP, trap);
+    }
+
+    // The subroutine called by every JSR.
+    uint16_t subroutine = gen_pc();
+    gen_emit(OP_RTS, 0);
+    for (int i = 0; i < call_count; i++)
+    {
+        image[calls[i]] = subroutine & 0xFF;
+        image[calls[i] + 1] = subroutine >> 8;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp || fwrite(image, size, 1, fp) != 1 || fclose(fp) != 0)
+    {
+        printf("Unable to write %s\n", path);
+        return 1;
+    }
+
+    printf("%s: %zu bytes at $%04X, start $%04X, loop $%04X", path, size, base, base, loop);
+    if (passes)
+    {
+        printf(", trap $%04X after %ld passes", trap, passes);
+    }
+    printf("\n%d slots, %llu instructions and %llu cycles per pass%s\n", generated,
+           (unsigned long long)body_instructions, (unsigned long long)body_cycles,
+           passes ? " plus the pass counter" : "");
+    if (generated < slots)
+    {
+        printf("image full, generated %d of %d slots\n", generated, slots);
+    }
+    printf("class     slots\n");
+    for (int c = 0; c < GEN_CLASSES; c++)
+    {
+        printf("%-9s %5.1f%%\n", class_names[c], 100.0 * slot_count[c] / generated);
+    }
+    printf("mode      slots\n");
+    for (int m = 0; m < GEN_MODES; m++)
+    {
+        if (mode_count[m])
+        {
+            printf("%-9s %5.1f%%\n", modes[m].name, 100.0 * mode_count[m] / generated);
+        }
+    }
+    printf("branches taken %d of %d, indexed page crossings %d of %d\n", taken, branches, crossings, indexed);
+    free(calls);
+    return 0;
+}
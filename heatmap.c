@@ -0,0 +1,192 @@
+/*
+heatmap.c
+Allocation, export and text summary of bus access heatmaps.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "heatmap.h"
+
+#define HEATMAP_HEADER_SIZE 12
+#define HEATMAP_ADDRESSES 0x00000001
+
+static const uint8_t heatmap_magic[4] = {'C', '6', 'H', 'M'};
+
+// Sort keys for the summary. Counts are totals over all access kinds.
+typedef struct
+{
+    uint32_t index;
+    uint64_t count;
+} heatmap_rank;
+
+/*
+c6502_heatmap_new() Allocate a cleared heatmap.
+*/
+bus_heatmap *c6502_heatmap_new(bool addresses)
+{
+    bus_heatmap *heatmap = calloc(1, sizeof(bus_heatmap));
+
+    if (heatmap && addresses)
+    {
+        heatmap->addresses = calloc(BUS_ACCESS_KINDS, sizeof(*heatmap->addresses));
+        if (!heatmap->addresses)
+        {
+            free(heatmap);
+            return NULL;
+        }
+    }
+    return heatmap;
+}
+
+/*
+c6502_heatmap_free() Free counters.
+*/
+void c6502_heatmap_free(bus_heatmap *heatmap)
+{
+    if (!heatmap)
+    {
+        return;
+    }
+    if (bus_heat == heatmap)
+    {
+        bus_heat = NULL;
+    }
+    free(heatmap->addresses);
+    free(heatmap);
+}
+
+/*
+c6502_heatmap_start() Collect into heatmap.
+*/
+void c6502_heatmap_start(bus_heatmap *heatmap)
+{
+    bus_heat = heatmap;
+}
+
+/*
+c6502_heatmap_stop() Stop collecting.
+*/
+void c6502_heatmap_stop(void)
+{
+    bus_heat = NULL;
+}
+
+/*
+c6502_heatmap_reset() Clear counters.
+*/
+void c6502_heatmap_reset(bus_heatmap *heatmap)
+{
+    memset(heatmap->pages, 0, sizeof(heatmap->pages));
+    if (heatmap->addresses)
+    {
+        memset(heatmap->addresses, 0, BUS_ACCESS_KINDS * sizeof(*heatmap->addresses));
+    }
+}
+
+/*
+c6502_heatmap_save() Write header, page counters and address counters.
+*/
+bool c6502_heatmap_save(const bus_heatmap *heatmap, const char *path)
+{
+    uint8_t header[HEATMAP_HEADER_SIZE];
+    uint16_t version = C6502_HEATMAP_VERSION;
+    uint16_t order = 0x0102;
+    uint32_t flags = heatmap->addresses ? HEATMAP_ADDRESSES : 0;
+    FILE *fp = fopen(path, "wb");
+    bool ok;
+
+    if (!fp)
+    {
+        return false;
+    }
+    memcpy(&header[0], heatmap_magic, 4);
+    memcpy(&header[4], &version, 2);
+    memcpy(&header[6], &order, 2);
+    memcpy(&header[8], &flags, 4);
+
+    ok = fwrite(header, sizeof(header), 1, fp) == 1;
+    ok = ok && fwrite(heatmap->pages, sizeof(heatmap->pages), 1, fp) == 1;
+    if (heatmap->addresses)
+    {
+        ok = ok && fwrite(heatmap->addresses, BUS_ACCESS_KINDS * sizeof(*heatmap->addresses), 1, fp) == 1;
+    }
+    return (fclose(fp) == 0) && ok;
+}
+
+// Sort by count, descending, then by index.
+static int heatmap_compare(const void *a, const void *b)
+{
+    const heatmap_rank *x = a;
+    const heatmap_rank *y = b;
+
+    if (x->count != y->count)
+    {
+        return (x->count < y->count) - (x->count > y->count);
+    }
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Fill ranks with the total accesses of each of count entries of counts[kind][], sort them.
+static void heatmap_rank_entries(heatmap_rank *ranks, const uint64_t *counts, size_t stride, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ranks[i].index = i;
+        ranks[i].count = counts[i] + counts[stride + i] + counts[2 * stride + i];
+    }
+    qsort(ranks, count, sizeof(heatmap_rank), heatmap_compare);
+}
+
+/*
+c6502_heatmap_summary() Totals and the top pages and addresses.
+*/
+void c6502_heatmap_summary(const bus_heatmap *heatmap, FILE *fp, int top)
+{
+    uint64_t totals[BUS_ACCESS_KINDS] = {0};
+    int touched = 0;
+    heatmap_rank *ranks = malloc((heatmap->addresses ? 65536 : 256) * sizeof(heatmap_rank));
+
+    if (!ranks)
+    {
+        return;
+    }
+
+    for (int page = 0; page < 256; page++)
+    {
+        uint64_t sum = 0;
+        for (int kind = 0; kind < BUS_ACCESS_KINDS; kind++)
+        {
+            totals[kind] += heatmap->pages[kind][page];
+            sum += heatmap->pages[kind][page];
+        }
+        touched += (sum > 0);
+    }
+    fprintf(fp, "reads %llu writes %llu fetches %llu, %d pages touched\n", (unsigned long long)totals[BUS_READ],
+            (unsigned long long)totals[BUS_WRITE], (unsigned long long)totals[BUS_FETCH], touched);
+
+    heatmap_rank_entries(ranks, &heatmap->pages[0][0], 256, 256);
+    fprintf(fp, "page         reads       writes      fetches\n");
+    for (int i = 0; i < top && i < 256 && ranks[i].count; i++)
+    {
+        uint32_t page = ranks[i].index;
+        fprintf(fp, "%02X   %12llu %12llu %12llu\n", page, (unsigned long long)heatmap->pages[BUS_READ][page],
+                (unsigned long long)heatmap->pages[BUS_WRITE][page],
+                (unsigned long long)heatmap->pages[BUS_FETCH][page]);
+    }
+
+    if (!heatmap->addresses)
+    {
+        free(ranks);
+        return;
+    }
+    heatmap_rank_entries(ranks, &heatmap->addresses[0][0], 65536, 65536);
+    fprintf(fp, "address      reads       writes      fetches\n");
+    for (int i = 0; i < top && ranks[i].count; i++)
+    {
+        uint32_t address = ranks[i].index;
+        fprintf(fp, "%04X %12llu %12llu %12llu\n", address, (unsigned long long)heatmap->addresses[BUS_READ][address],
+                (unsigned long long)heatmap->addresses[BUS_WRITE][address],
+                (unsigned long long)heatmap->addresses[BUS_FETCH][address]);
+    }
+    free(ranks);
+}
@@ -0,0 +1,56 @@
+// heatmap.h
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bus.h"
+
+/*
+Memory access heatmaps.
+
+Counts reads, writes and instruction fetches (opcode and operand bytes) per 256 byte page, and
+optionally per address, in cpu_read(), cpu_write() and cpu_fetch(). Collection is off until
+c6502_heatmap_start(). While on, a page only heatmap costs one increment per access, which is
+cheap enough for long soak tests; per address counters add a second increment on a 1.5MB table.
+Lanes of the lockstep engine that run in vector kernels do not go through the bus and are not
+counted.
+
+A binary dump is a header followed by the counters:
+
+    header   "C6HM", uint16 version, uint16 byte order mark 0x0102, uint32 flags
+    pages    uint64 [3][256], indexed by bus_access then page
+    addresses uint64 [3][65536], indexed by bus_access then address, if flags bit 0 is set
+
+Values are in host byte order, as in save states.
+*/
+
+#define C6502_HEATMAP_VERSION 1
+
+// Allocate a cleared heatmap, with per address counters if addresses is true. NULL if out of memory.
+bus_heatmap *c6502_heatmap_new(bool addresses);
+
+// Free heatmap. Stops collection first if heatmap is collecting.
+void c6502_heatmap_free(bus_heatmap *heatmap);
+
+// Collect accesses of this thread into heatmap, replacing any heatmap that was collecting.
+void c6502_heatmap_start(bus_heatmap *heatmap);
+
+// Stop collecting on this thread.
+void c6502_heatmap_stop(void);
+
+// Clear all counters.
+void c6502_heatmap_reset(bus_heatmap *heatmap);
+
+// Write a binary dump. Return false if the file can not be written.
+bool c6502_heatmap_save(const bus_heatmap *heatmap, const char *path);
+
+/*
+Write a text summary: access totals, then the top pages by total accesses, then, with per address
+counters, the top addresses.
+*/
+void c6502_heatmap_summary(const bus_heatmap *heatmap, FILE *fp, int top);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+instance.c
+Machine instances sharing reference counted memory pages copy-on-write.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "instance.h"
+
+struct c6502_page
+{
+    int refs;
+    uint8_t data[256];
+};
+
+static c6502_instance *active = NULL;
+// Epoch started when the active instance was last synced or activated.
+static uint32_t epoch = 0;
+static size_t page_count = 0;
+
+static c6502_page *instance_page_new(const uint8_t *data)
+{
+    c6502_page *block = malloc(sizeof(c6502_page));
+    if (block)
+    {
+        block->refs = 1;
+        memcpy(block->data, data, 256);
+        page_count++;
+    }
+    return block;
+}
+
+static void instance_page_release(c6502_page *block)
+{
+    if (block && --block->refs == 0)
+    {
+        free(block);
+        page_count--;
+    }
+}
+
+/*
+c6502_instance_new() Sync the running instance, then copy the machine into fresh pages and make
+the new instance active.
+*/
+c6502_instance *c6502_instance_new(void)
+{
+    if (active && !c6502_instance_sync())
+    {
+        return NULL;
+    }
+
+    c6502_instance *instance = calloc(1, sizeof(c6502_instance));
+
+    if (!instance)
+    {
+        return NULL;
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        instance->pages[page] = instance_page_new(&ADDRESS[page << 8]);
+        if (!instance->pages[page])
+        {
+            c6502_instance_free(instance);
+            return NULL;
+        }
+    }
+    instance->cpu = c6502;
+    instance->databus = DATABUS;
+    active = instance;
+    epoch = bus_new_epoch();
+    return instance;
+}
+
+// c6502_fork() Sync the parent if it is running, then share its page table.
+c6502_instance *c6502_fork(c6502_instance *parent)
+{
+    if (parent == active && !c6502_instance_sync())
+    {
+        return NULL;
+    }
+
+    c6502_instance *child = malloc(sizeof(c6502_instance));
+    if (!child)
+    {
+        return NULL;
+    }
+    *child = *parent;
+    for (int page = 0; page < 256; page++)
+    {
+        child->pages[page]->refs++;
+    }
+    return child;
+}
+
+// c6502_instance_sync() Copy registers and written pages into the active instance.
+bool c6502_instance_sync(void)
+{
+    if (!active)
+    {
+        return false;
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        c6502_page *block = active->pages[page];
+        const uint8_t *mem = &ADDRESS[page << 8];
+
+        if (!bus_page_dirty(page, epoch) || memcmp(block->data, mem, 256) == 0)
+        {
+            continue;
+        }
+        if (block->refs > 1)
+        {
+            c6502_page *own = instance_page_new(mem);
+            if (!own)
+            {
+                return false;
+            }
+            block->refs--;
+            active->pages[page] = own;
+        }
+        else
+        {
+            memcpy(block->data, mem, 256);
+        }
+    }
+    active->cpu = c6502;
+    active->databus = DATABUS;
+    epoch = bus_new_epoch();
+    return true;
+}
+
+// c6502_instance_activate() Sync the running instance, then load the pages that differ.
+bool c6502_instance_activate(c6502_instance *instance)
+{
+    c6502_instance *previous = active;
+
+    if (previous && !c6502_instance_sync())
+    {
+        return false;
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        if (!previous || previous->pages[page] != instance->pages[page])
+        {
+            memcpy(&ADDRESS[page << 8], instance->pages[page]->data, 256);
+            bus_touch_page(page);
+        }
+    }
+    c6502 = instance->cpu;
+    DATABUS = instance->databus;
+    active = instance;
+    epoch = bus_new_epoch();
+    return true;
+}
+
+// c6502_instance_active() Active instance.
+c6502_instance *c6502_instance_active(void)
+{
+    return active;
+}
+
+// c6502_instance_free() Release pages. ADDRESS keeps the contents of a freed active instance.
+void c6502_instance_free(c6502_instance *instance)
+{
+    if (!instance)
+    {
+        return;
+    }
+    if (instance == active)
+    {
+        active = NULL;
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        instance_page_release(instance->pages[page]);
+    }
+    free(instance);
+}
+
+// c6502_instance_pages() Pages allocated by all instances.
+size_t c6502_instance_pages(void)
+{
+    return page_count;
+}
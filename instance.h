@@ -0,0 +1,63 @@
+// instance.h
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Machine instances with copy-on-write forking.
+
+An instance is the cpu registers, DATABUS and a table of 256 pointers to reference counted
+256 byte memory pages. Forking copies the page table and takes a reference on every page, so a
+child costs one small struct and shares all memory with its parent.
+
+The core always runs on ADDRESS, so one instance is active at a time and its memory lives in
+ADDRESS while it runs. Writes are found with bus dirty page tracking: when the active instance
+is synced (on fork, activate or c6502_instance_sync()), each page written since it became
+active is copied back into its page, and a page still shared with another instance gets its
+own copy first. A page that was written but still holds the same bytes stays shared. Switching
+between instances copies only the pages whose pointers differ, so forking thousands of children
+costs only the pages they actually write.
+
+Code that changes ADDRESS without cpu_write() must call bus_touch_page() for the pages it changes.
+*/
+
+typedef struct c6502_page c6502_page;
+
+typedef struct
+{
+    c6502_cpu cpu;
+    uint8_t databus;
+    c6502_page *pages[256];
+} c6502_instance;
+
+// Sync the active instance, then create an instance from the current machine and make it active.
+// Return NULL if out of memory.
+c6502_instance *c6502_instance_new(void);
+
+/*
+Create a child of parent sharing all its pages. The active instance is not changed.
+Return NULL if out of memory.
+*/
+c6502_instance *c6502_fork(c6502_instance *parent);
+
+// Copy the machine back into the active instance, unsharing the pages it wrote.
+bool c6502_instance_sync(void);
+
+// Make instance the running machine. The previously active instance is synced first.
+bool c6502_instance_activate(c6502_instance *instance);
+
+// Return the active instance, NULL if none.
+c6502_instance *c6502_instance_active(void);
+
+// Drop instance and its page references. Freeing the active instance leaves the machine as is.
+void c6502_instance_free(c6502_instance *instance);
+
+// Number of pages allocated by all instances.
+size_t c6502_instance_pages(void);
+
+#endif
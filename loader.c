@@ -0,0 +1,310 @@
+/*
+loader.c
+Rom and program image loading.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "loader.h"
+
+// c6502_read_file() Read whole file.
+uint8_t *c6502_read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t *data = NULL;
+
+    if (!fp)
+    {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (length >= 0)
+    {
+        data = malloc(length + 1);
+    }
+    if (data && fread(data, 1, length, fp) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+// c6502_load_ines_image() Copy PRG chunks below $FFFF.
+bool c6502_load_ines_image(const uint8_t *data, size_t size)
+{
+    iNesHeader header = {0};
+    size_t offset = sizeof(iNesHeader);
+
+    if (size < sizeof(iNesHeader))
+    {
+        return false;
+    }
+    memcpy(&header, data, sizeof(iNesHeader));
+    // If trainer is present skip it.
+    if (header.mapper1 & 0x04)
+    {
+        offset += 512;
+    }
+
+    // Mappers are not emulated, only the first 32KB of program rom fits the address space.
+    size_t prg_size = header.prg_chunks * 16384;
+    if (prg_size > 32768)
+    {
+        prg_size = 32768;
+    }
+    if (prg_size == 0 || size < offset + prg_size)
+    {
+        return false;
+    }
+    // Write program chunks to ram address.
+    memcpy(&ADDRESS[0x10000 - prg_size], &data[offset], prg_size);
+    return true;
+}
+
+// c6502_load_ines() Read rom file and load it.
+bool c6502_load_ines(const char *path)
+{
+    size_t size = 0;
+    uint8_t *data = c6502_read_file(path, &size);
+
+    if (!data)
+    {
+        printf("Rom file %s does not exist\n", path);
+        return false;
+    }
+    bool ok = c6502_load_ines_image(data, size);
+    if (!ok)
+    {
+        printf("%s is not a valid iNES rom\n", path);
+    }
+    free(data);
+    return ok;
+}
+
+// Copy size bytes of data to address. Return false if they do not fit below $10000.
+static bool loader_copy(uint32_t address, const uint8_t *data, size_t size)
+{
+    if (address + size > sizeof(ADDRESS))
+    {
+        return false;
+    }
+    memcpy(&ADDRESS[address], data, size);
+    return true;
+}
+
+// c6502_load_binary() Copy the whole file to base.
+bool c6502_load_binary(const char *path, uint16_t base)
+{
+    size_t size = 0;
+    uint8_t *data = c6502_read_file(path, &size);
+
+    if (!data)
+    {
+        printf("Image file %s does not exist\n", path);
+        return false;
+    }
+    bool ok = loader_copy(base, data, size);
+    if (!ok)
+    {
+        printf("%s does not fit at $%04X\n", path, base);
+    }
+    free(data);
+    return ok;
+}
+
+// Value of the hex digit c, or -1.
+static int loader_hex_digit(int c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Decode one Intel HEX record starting after the ':'. Return false if it is not valid.
+static bool loader_ihex_record(const char *text, uint32_t *offset, bool *end)
+{
+    uint8_t record[260];
+    size_t n = 0;
+    uint8_t sum = 0;
+
+    while (loader_hex_digit(text[0]) >= 0 && loader_hex_digit(text[1]) >= 0 && n < sizeof(record))
+    {
+        record[n] = loader_hex_digit(text[0]) << 4 | loader_hex_digit(text[1]);
+        sum += record[n++];
+        text += 2;
+    }
+    // count, address (2), type, data, checksum
+    if (n < 5 || n != (size_t)record[0] + 5 || sum != 0)
+    {
+        return false;
+    }
+
+    uint16_t address = record[1] << 8 | record[2];
+    switch (record[3])
+    {
+    case 0x00:
+        return loader_copy(*offset + address, &record[4], record[0]);
+    case 0x01:
+        *end = true;
+        return true;
+    case 0x02:
+        *offset = (uint32_t)(record[4] << 8 | record[5]) << 4;
+        return record[0] == 2;
+    case 0x04:
+        *offset = (uint32_t)(record[4] << 8 | record[5]) << 16;
+        return record[0] == 2;
+    case 0x03:
+    case 0x05:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// c6502_load_ihex() Decode records line by line until the end of file record.
+bool c6502_load_ihex(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[600];
+    uint32_t offset = 0;
+    bool end = false;
+    int number = 0;
+
+    if (!fp)
+    {
+        printf("Image file %s does not exist\n", path);
+        return false;
+    }
+    while (!end && fgets(line, sizeof(line), fp))
+    {
+        number++;
+        if (line[0] != ':')
+        {
+            continue;
+        }
+        if (!loader_ihex_record(&line[1], &offset, &end))
+        {
+            printf("%s:%d: bad Intel HEX record\n", path, number);
+            fclose(fp);
+            return false;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// c6502_load_prg() Two byte load address followed by data.
+bool c6502_load_prg(const char *path)
+{
+    size_t size = 0;
+    uint8_t *data = c6502_read_file(path, &size);
+    bool ok = false;
+
+    if (!data)
+    {
+        printf("Image file %s does not exist\n", path);
+        return false;
+    }
+    if (size >= 2)
+    {
+        ok = loader_copy(data[0] | data[1] << 8, &data[2], size - 2);
+    }
+    if (!ok)
+    {
+        printf("%s is not a valid PRG file\n", path);
+    }
+    free(data);
+    return ok;
+}
+
+// c6502_load_xex() Copy every segment. The FFFF marker is optional after the first segment.
+bool c6502_load_xex(const char *path)
+{
+    size_t size = 0;
+    uint8_t *data = c6502_read_file(path, &size);
+    size_t pos = 0;
+    bool ok = false;
+
+    if (!data)
+    {
+        printf("Image file %s does not exist\n", path);
+        return false;
+    }
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFF)
+    {
+        ok = true;
+        pos = 2;
+    }
+    while (ok && pos < size)
+    {
+        if (size - pos >= 2 && data[pos] == 0xFF && data[pos + 1] == 0xFF)
+        {
+            pos += 2;
+        }
+        if (size - pos < 4)
+        {
+            ok = false;
+            break;
+        }
+        uint16_t start = data[pos] | data[pos + 1] << 8;
+        uint16_t end = data[pos + 2] | data[pos + 3] << 8;
+        size_t length = (size_t)end - start + 1;
+        pos += 4;
+        ok = end >= start && size - pos >= length && loader_copy(start, &data[pos], length);
+        pos += length;
+    }
+    if (!ok)
+    {
+        printf("%s is not a valid XEX file\n", path);
+    }
+    free(data);
+    return ok;
+}
+
+// Return true if path ends with extension, ignoring case.
+static bool loader_extension(const char *path, const char *extension)
+{
+    size_t n = strlen(path);
+    size_t m = strlen(extension);
+
+    return n >= m && strcasecmp(&path[n - m], extension) == 0;
+}
+
+// c6502_load_file() Pick the loader by extension.
+bool c6502_load_file(const char *path, uint16_t base)
+{
+    if (loader_extension(path, ".nes"))
+    {
+        return c6502_load_ines(path);
+    }
+    if (loader_extension(path, ".hex") || loader_extension(path, ".ihx"))
+    {
+        return c6502_load_ihex(path);
+    }
+    if (loader_extension(path, ".prg"))
+    {
+        return c6502_load_prg(path);
+    }
+    if (loader_extension(path, ".xex"))
+    {
+        return c6502_load_xex(path);
+    }
+    return c6502_load_binary(path, base);
+}
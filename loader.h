@@ -0,0 +1,77 @@
+// loader.h
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/* Nes Header
+Bytes
+0-3     Constant 4E 45 53 1A
+4       Size of PRG rom in 16kb chucks
+5       Size of CHR rom in 8kb chucks
+6       Flag 6 Mapper, mirroring, battery, trainer
+7       Flag 7 Mapper, VS/Playchoice, NES 2.0
+8       Flag 8 PGR Ram size
+9       Flag 9 TV system
+10      Flag 10 TV System, PGR-RAM presence
+11-15   Unused padding
+*/
+typedef struct
+{
+    uint8_t nes[4];
+    uint8_t prg_chunks;
+    uint8_t chr_chunks;
+    uint8_t mapper1;
+    uint8_t mapper2;
+    uint8_t prg_ram_size;
+    uint8_t tv_system1;
+    uint8_t tv_system2;
+    uint8_t unused[5];
+} iNesHeader;
+
+/*
+Read a whole file into a malloc'd buffer. Return NULL if the file can not be read.
+size is set to the number of bytes read.
+*/
+uint8_t *c6502_read_file(const char *path, size_t *size);
+
+/*
+Copy the PRG rom of an iNES image into ADDRESS so that it ends at $FFFF ($C000 for one 16KB
+chunk, $8000 for two). A trainer is skipped. Return false if the image is too short.
+*/
+bool c6502_load_ines_image(const uint8_t *data, size_t size);
+
+// Load an iNES rom file. Return false if the file does not exist or is not valid.
+bool c6502_load_ines(const char *path);
+
+// Load a raw binary at base. Return false if the file does not exist or runs past $FFFF.
+bool c6502_load_binary(const char *path, uint16_t base);
+
+/*
+Load an Intel HEX file. Data (00), end of file (01) and extended segment / linear address
+(02, 04) records are supported, start address records are ignored. Return false on a bad
+record, checksum or an address past $FFFF.
+*/
+bool c6502_load_ihex(const char *path);
+
+// Load a segmented file: C64 PRG (load address then data). Return false if it is not valid.
+bool c6502_load_prg(const char *path);
+
+/*
+Load a segmented file: Atari XEX (FFFF marker, then start and end address followed by data, for
+every segment). The run address, if any, is left at $02E0 like the Atari loader does.
+Return false if it is not valid.
+*/
+bool c6502_load_xex(const char *path);
+
+/*
+Load by file extension: .nes iNES, .hex/.ihx Intel HEX, .prg C64 PRG, .xex Atari XEX,
+anything else a raw binary at base.
+*/
+bool c6502_load_file(const char *path, uint16_t base);
+
+#endif
@@ -0,0 +1,470 @@
+/*
+lockstep.c
+Structure of arrays engine. Register only opcodes run as masked loops over all lanes,
+everything else falls back to the scalar interpreter per lane.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "lockstep.h"
+
+#define LANES C6502_LOCKSTEP_LANES
+
+/*
+On x86-64 the kernels are compiled twice, for AVX2 and for the SSE2 baseline, and the loader picks
+the clone the host can run. The branch and commit helpers are inlined into each clone.
+*/
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define LOCKSTEP_TARGETS __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef LOCKSTEP_TARGETS
+#define LOCKSTEP_TARGETS
+#endif
+
+// c6502_lockstep_init() Allocate 64KB per lane.
+bool c6502_lockstep_init(c6502_lockstep *ls, int lanes)
+{
+    memset(ls, 0, sizeof(c6502_lockstep));
+    if (lanes < 1 || lanes > LANES)
+    {
+        return false;
+    }
+    ls->lanes = lanes;
+    for (int i = 0; i < lanes; i++)
+    {
+        ls->memory[i] = calloc(1, sizeof(ADDRESS));
+        if (!ls->memory[i])
+        {
+            c6502_lockstep_free(ls);
+            return false;
+        }
+    }
+    return true;
+}
+
+// c6502_lockstep_free() Free lane memory.
+void c6502_lockstep_free(c6502_lockstep *ls)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        free(ls->memory[i]);
+        ls->memory[i] = NULL;
+    }
+    ls->lanes = 0;
+}
+
+// c6502_lockstep_load() Copy registers and ADDRESS into lane.
+void c6502_lockstep_load(c6502_lockstep *ls, int lane)
+{
+    ls->A[lane] = c6502.A;
+    ls->X[lane] = c6502.X;
+    ls->Y[lane] = c6502.Y;
+    ls->SP[lane] = c6502.SP;
+    ls->SR[lane] = c6502.SR;
+    ls->JAM[lane] = c6502.JAM;
+    ls->PC[lane] = c6502.PC;
+    ls->cycles[lane] = c6502.cycles;
+    memcpy(ls->memory[lane], ADDRESS, sizeof(ADDRESS));
+}
+
+// c6502_lockstep_store() Copy lane registers and memory into the current machine.
+void c6502_lockstep_store(c6502_lockstep *ls, int lane)
+{
+    c6502.A = ls->A[lane];
+    c6502.X = ls->X[lane];
+    c6502.Y = ls->Y[lane];
+    c6502.SP = ls->SP[lane];
+    c6502.SR = ls->SR[lane];
+    c6502.JAM = ls->JAM[lane];
+    c6502.PC = ls->PC[lane];
+    c6502.cycles = ls->cycles[lane];
+    memcpy(ADDRESS, ls->memory[lane], sizeof(ADDRESS));
+    for (int page = 0; page < 256; page++)
+    {
+        bus_touch_page(page);
+    }
+}
+
+// c6502_lockstep_vectorized() Opcodes with a vector kernel.
+bool c6502_lockstep_vectorized(uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case 0x69: // ADC #
+    case 0xE9: // SBC #
+    case 0x29: // AND #
+    case 0x09: // ORA #
+    case 0x49: // EOR #
+    case 0xA9: // LDA #
+    case 0xA2: // LDX #
+    case 0xA0: // LDY #
+    case 0xC9: // CMP #
+    case 0xE0: // CPX #
+    case 0xC0: // CPY #
+    case 0xAA: // TAX
+    case 0xA8: // TAY
+    case 0x8A: // TXA
+    case 0x98: // TYA
+    case 0xBA: // TSX
+    case 0x9A: // TXS
+    case 0xE8: // INX
+    case 0xC8: // INY
+    case 0xCA: // DEX
+    case 0x88: // DEY
+    case 0x18: // CLC
+    case 0x38: // SEC
+    case 0x58: // CLI
+    case 0x78: // SEI
+    case 0xB8: // CLV
+    case 0xD8: // CLD
+    case 0xF8: // SED
+    case 0x0A: // ASL A
+    case 0x4A: // LSR A
+    case 0x2A: // ROL A
+    case 0xEA: // NOP
+    case 0x10: // BPL
+    case 0x30: // BMI
+    case 0x50: // BVC
+    case 0x70: // BVS
+    case 0x90: // BCC
+    case 0xB0: // BCS
+    case 0xD0: // BNE
+    case 0xF0: // BEQ
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+Branch kernel. Lanes in mask take the branch when (SR & flag) is set, or clear when set is false.
+Cycles follow the interpreter: +1 when taken, +1 more when the target is on another page, none
+in an untimed build.
+*/
+static inline void lockstep_branch(c6502_lockstep *ls, const uint8_t *mask, uint8_t flag, bool set, uint8_t cycles)
+{
+    uint8_t want = set ? flag : 0;
+
+    for (int i = 0; i < ls->lanes; i++)
+    {
+        uint16_t next = ls->PC[i] + 2;
+        uint16_t target = next + (uint16_t)(int8_t)ls->operand[i];
+        uint16_t taken = ((ls->SR[i] & flag) == want) ? 0xFFFF : 0x0000;
+        uint16_t lane = mask[i] ? 0xFFFF : 0x0000;
+        uint16_t cross = ((target ^ next) & 0xFF00) ? 1 : 0;
+
+        ls->PC[i] = (ls->PC[i] & ~lane) | (((target & taken) | (next & ~taken)) & lane);
+        ls->cycles[i] += (cycles + ((1 + cross) & taken & (C6502_TIMED ? 0xFFFF : 0))) & lane;
+    }
+}
+
+/*
+Register kernel. result holds the value that sets N and Z. It is stored into target (if not
+NULL), and the status bits in affected are replaced by those in flags, N and Z.
+*/
+static inline void lockstep_commit(c6502_lockstep *ls, const uint8_t *mask, uint8_t *target, const uint8_t *result,
+                            const uint8_t *flags, uint8_t affected, uint8_t length, uint8_t cycles)
+{
+    for (int i = 0; i < ls->lanes; i++)
+    {
+        uint8_t lane = mask[i];
+        uint8_t nz = (result[i] & N) | (result[i] == 0 ? Z : 0);
+        uint8_t sr = (ls->SR[i] & ~affected) | ((flags[i] | nz) & affected);
+
+        ls->SR[i] = (ls->SR[i] & ~lane) | (sr & lane);
+        ls->PC[i] += length & lane;
+        ls->cycles[i] += cycles & lane;
+    }
+    if (target)
+    {
+        for (int i = 0; i < ls->lanes; i++)
+        {
+            target[i] = (target[i] & ~mask[i]) | (result[i] & mask[i]);
+        }
+    }
+}
+
+// Run opcode on the lanes in mask. The opcode must be one c6502_lockstep_vectorized() accepts.
+LOCKSTEP_TARGETS static void lockstep_kernel(c6502_lockstep *ls, uint8_t opcode, const uint8_t *mask)
+{
+    uint8_t result[LANES] = {0};
+    uint8_t flags[LANES] = {0};
+    uint8_t *target = NULL;
+    uint8_t affected = N | Z;
+    uint8_t cycles = C6502_TIMED ? lookup_table[opcode].cycles : 1;
+    const uint8_t *m = ls->operand;
+    int n = ls->lanes;
+
+    switch (opcode)
+    {
+    case 0x69: // ADC #
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t sum = ls->A[i] + m[i] + (ls->SR[i] & C);
+            result[i] = sum & 0xFF;
+            flags[i] = ((sum >> 8) & C) | ((~(ls->A[i] ^ m[i]) & (ls->A[i] ^ sum) & 0x80) ? V : 0);
+        }
+        target = ls->A;
+        affected = N | Z | C | V;
+        break;
+    case 0xE9: // SBC #
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t twos = (m[i] ^ 0xFF) + (ls->SR[i] & C);
+            uint16_t difference = ls->A[i] + twos;
+            result[i] = difference & 0xFF;
+            flags[i] = ((difference >> 8) ? C : 0) | ((~(ls->A[i] ^ m[i] ^ 0xFF) & (ls->A[i] ^ difference) & 0x80) ? V : 0);
+        }
+        target = ls->A;
+        affected = N | Z | C | V;
+        break;
+    case 0x29: // AND #
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->A[i] & m[i];
+        }
+        target = ls->A;
+        break;
+    case 0x09: // ORA #
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->A[i] | m[i];
+        }
+        target = ls->A;
+        break;
+    case 0x49: // EOR #
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->A[i] ^ m[i];
+        }
+        target = ls->A;
+        break;
+    case 0xA9: // LDA #
+    case 0xA2: // LDX #
+    case 0xA0: // LDY #
+        memcpy(result, m, n);
+        target = (opcode == 0xA9) ? ls->A : (opcode == 0xA2) ? ls->X : ls->Y;
+        break;
+    case 0xC9: // CMP #
+    case 0xE0: // CPX #
+    case 0xC0: // CPY #
+    {
+        const uint8_t *reg = (opcode == 0xC9) ? ls->A : (opcode == 0xE0) ? ls->X : ls->Y;
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = reg[i] - m[i];
+            flags[i] = (reg[i] >= m[i]) ? C : 0;
+        }
+        affected = N | Z | C;
+        break;
+    }
+    case 0xAA: // TAX
+        memcpy(result, ls->A, n);
+        target = ls->X;
+        break;
+    case 0xA8: // TAY
+        memcpy(result, ls->A, n);
+        target = ls->Y;
+        break;
+    case 0x8A: // TXA
+        memcpy(result, ls->X, n);
+        target = ls->A;
+        break;
+    case 0x98: // TYA
+        memcpy(result, ls->Y, n);
+        target = ls->A;
+        break;
+    case 0xBA: // TSX
+        memcpy(result, ls->SP, n);
+        target = ls->X;
+        break;
+    case 0x9A: // TXS
+        memcpy(result, ls->X, n);
+        target = ls->SP;
+        affected = 0;
+        break;
+    case 0xE8: // INX
+    case 0xCA: // DEX
+    {
+        uint8_t delta = (opcode == 0xE8) ? 1 : 0xFF;
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->X[i] + delta;
+        }
+        target = ls->X;
+        break;
+    }
+    case 0xC8: // INY
+    case 0x88: // DEY
+    {
+        uint8_t delta = (opcode == 0xC8) ? 1 : 0xFF;
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->Y[i] + delta;
+        }
+        target = ls->Y;
+        break;
+    }
+    case 0x18: // CLC
+    case 0x58: // CLI
+    case 0xB8: // CLV
+    case 0xD8: // CLD
+        affected = (opcode == 0x18) ? C : (opcode == 0x58) ? I : (opcode == 0xB8) ? V : D;
+        break;
+    case 0x38: // SEC
+    case 0x78: // SEI
+    case 0xF8: // SED
+        affected = (opcode == 0x38) ? C : (opcode == 0x78) ? I : D;
+        memset(flags, affected, n);
+        break;
+    case 0x0A: // ASL A
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->A[i] << 1;
+            flags[i] = ls->A[i] >> 7;
+        }
+        target = ls->A;
+        affected = N | Z | C;
+        break;
+    case 0x4A: // LSR A
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = ls->A[i] >> 1;
+            flags[i] = ls->A[i] & C;
+        }
+        target = ls->A;
+        affected = N | Z | C;
+        break;
+    case 0x2A: // ROL A
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = (ls->A[i] << 1) | (ls->SR[i] & C);
+            flags[i] = ls->A[i] >> 7;
+        }
+        target = ls->A;
+        affected = N | Z | C;
+        break;
+    case 0xEA: // NOP
+        affected = 0;
+        break;
+    case 0x10: // BPL
+    case 0x30: // BMI
+        lockstep_branch(ls, mask, N, opcode == 0x30, cycles);
+        return;
+    case 0x50: // BVC
+    case 0x70: // BVS
+        lockstep_branch(ls, mask, V, opcode == 0x70, cycles);
+        return;
+    case 0x90: // BCC
+    case 0xB0: // BCS
+        lockstep_branch(ls, mask, C, opcode == 0xB0, cycles);
+        return;
+    case 0xD0: // BNE
+    case 0xF0: // BEQ
+        lockstep_branch(ls, mask, Z, opcode == 0xF0, cycles);
+        return;
+    }
+    lockstep_commit(ls, mask, target, result, flags, affected, c6502_instruction_bytes(opcode), cycles);
+}
+
+// Run one instruction of lane on the interpreter with bus_memory pointing at the lane's memory.
+static void lockstep_scalar(c6502_lockstep *ls, int lane)
+{
+    c6502.A = ls->A[lane];
+    c6502.X = ls->X[lane];
+    c6502.Y = ls->Y[lane];
+    c6502.SP = ls->SP[lane];
+    c6502.SR = ls->SR[lane];
+    c6502.JAM = ls->JAM[lane];
+    c6502.PC = ls->PC[lane];
+    c6502.cycles = ls->cycles[lane];
+    bus_memory = ls->memory[lane];
+
+    c6502_step();
+
+    ls->A[lane] = c6502.A;
+    ls->X[lane] = c6502.X;
+    ls->Y[lane] = c6502.Y;
+    ls->SP[lane] = c6502.SP;
+    ls->SR[lane] = c6502.SR;
+    ls->JAM[lane] = c6502.JAM;
+    ls->PC[lane] = c6502.PC;
+    ls->cycles[lane] = c6502.cycles;
+}
+
+// c6502_lockstep_step() Group lanes by opcode, run kernels masked, peel the rest off to scalar.
+int c6502_lockstep_step(c6502_lockstep *ls)
+{
+    uint8_t mask[LANES];
+    bool seen[256] = {false};
+    uint8_t distinct[LANES];
+    int distinct_count = 0;
+    int active = 0;
+
+    for (int i = 0; i < ls->lanes; i++)
+    {
+        if (ls->JAM[i])
+        {
+            continue;
+        }
+        ls->opcode[i] = ls->memory[i][ls->PC[i]];
+        ls->operand[i] = ls->memory[i][(uint16_t)(ls->PC[i] + 1)];
+        if (!seen[ls->opcode[i]])
+        {
+            seen[ls->opcode[i]] = true;
+            distinct[distinct_count++] = ls->opcode[i];
+        }
+        active++;
+    }
+
+    c6502_cpu saved = c6502;
+    uint8_t *saved_memory = bus_memory;
+
+    for (int k = 0; k < distinct_count; k++)
+    {
+        uint8_t opcode = distinct[k];
+        int selected = 0;
+
+        for (int i = 0; i < ls->lanes; i++)
+        {
+            mask[i] = (ls->opcode[i] == opcode && !ls->JAM[i]) ? 0xFF : 0x00;
+            selected += mask[i] & 1;
+        }
+#if C6502_DECIMAL
+        // The ADC and SBC kernels are binary. Lanes in decimal mode take the scalar path.
+        if (opcode == 0x69 || opcode == 0xE9)
+        {
+            for (int i = 0; i < ls->lanes; i++)
+            {
+                if (mask[i] && (ls->SR[i] & D))
+                {
+                    lockstep_scalar(ls, i);
+                    mask[i] = 0x00;
+                    selected--;
+                    ls->scalar_count++;
+                }
+            }
+        }
+#endif
+        if (c6502_lockstep_vectorized(opcode))
+        {
+            lockstep_kernel(ls, opcode, mask);
+            ls->vector_count += selected;
+            continue;
+        }
+        for (int i = 0; i < ls->lanes; i++)
+        {
+            if (mask[i])
+            {
+                lockstep_scalar(ls, i);
+            }
+        }
+        ls->scalar_count += selected;
+    }
+
+    c6502 = saved;
+    bus_memory = saved_memory;
+    return active;
+}
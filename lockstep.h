@@ -0,0 +1,75 @@
+// lockstep.h
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Lockstep engine running many cpus side by side.
+
+Registers of all lanes are stored as arrays (structure of arrays), and every lane has its own
+64KB of memory. c6502_lockstep_step() runs one instruction on every lane that is not jammed:
+
+1. Fetch the opcode and first operand byte of every lane.
+2. For each distinct opcode, build a lane mask (0xFF selected, 0x00 not).
+3. Opcodes that only touch registers (immediate, implied, accumulator and relative address
+   modes) run as one masked, branch free loop over all lanes. The loops are written so the
+   compiler turns them into SSE/AVX2 code, which needs -O3 (or -ftree-vectorize): at -O2 and
+   below they stay scalar. The makefile builds lockstep.o that way for c6502-fuzz and
+   c6502-perf. On x86-64 the kernels are cloned for AVX2 and SSE2 and the clone is chosen at
+   run time, so the binary runs on any x86-64 host.
+4. All other opcodes are peeled off to the scalar interpreter, one lane at a time, with
+   bus_memory pointing at the lane's memory.
+
+Lanes running similar code hit few distinct opcodes per step, so most lanes run vectorized.
+The vector kernels produce the same registers, flags and cycles as the handlers in c6502.c.
+Lanes have no per-lane DATABUS, abs_address or rel_address. io handlers and write hooks apply
+to the scalar path only.
+*/
+
+#define C6502_LOCKSTEP_LANES 64
+
+typedef struct
+{
+    int lanes;
+    uint8_t A[C6502_LOCKSTEP_LANES];
+    uint8_t X[C6502_LOCKSTEP_LANES];
+    uint8_t Y[C6502_LOCKSTEP_LANES];
+    uint8_t SP[C6502_LOCKSTEP_LANES];
+    uint8_t SR[C6502_LOCKSTEP_LANES];
+    uint8_t JAM[C6502_LOCKSTEP_LANES];
+    uint16_t PC[C6502_LOCKSTEP_LANES];
+    uint64_t cycles[C6502_LOCKSTEP_LANES];
+    uint8_t *memory[C6502_LOCKSTEP_LANES];
+
+    // Per step scratch: opcode and first operand byte of each lane.
+    uint8_t opcode[C6502_LOCKSTEP_LANES];
+    uint8_t operand[C6502_LOCKSTEP_LANES];
+
+    // Instructions run by vector kernels and by the scalar interpreter.
+    uint64_t vector_count;
+    uint64_t scalar_count;
+} c6502_lockstep;
+
+// Allocate memory for lanes (1..C6502_LOCKSTEP_LANES). Return false if out of memory.
+bool c6502_lockstep_init(c6502_lockstep *ls, int lanes);
+
+// Free lane memory.
+void c6502_lockstep_free(c6502_lockstep *ls);
+
+// Copy the current machine (c6502 and ADDRESS) into lane.
+void c6502_lockstep_load(c6502_lockstep *ls, int lane);
+
+// Copy lane into the current machine.
+void c6502_lockstep_store(c6502_lockstep *ls, int lane);
+
+// Return true if opcode runs as a vector kernel.
+bool c6502_lockstep_vectorized(uint8_t opcode);
+
+// Run one instruction on every lane that is not jammed. Return the number of lanes run.
+int c6502_lockstep_step(c6502_lockstep *ls);
+
+#endif
@@ -1,4 +1,16 @@
+#include <stdlib.h>
+#include <string.h>
 #include "c6502.h"
+#include "trace.h"
+#include "disasm.h"
+#include "loader.h"
+#include "profile.h"
+#include "callstack.h"
+#include "heatmap.h"
+
+#ifdef C6502_UNTIMED
+#error "neslogs compares the cycle column of nestest.log and needs a timed build"
+#endif
 
 /*
 The nestest.nes rom from Kevin Horton is used to test my 6502 emulator.
@@ -8,189 +20,270 @@ The log file nestest.log was used as reference to to validate the 6502 processor
 See the nestest.txt document for more information.
 */
 
-/* Nes Header
-Bytes
-0-3     Constant 4E 45 53 1A
-4       Size of PRG rom in 16kb chucks
-5       Size of CHR rom in 8kb chucks
-6       Flag 6 Mapper, mirroring, battery, trainer
-7       Flag 7 Mapper, VS/Playchoice, NES 2.0
-8       Flag 8 PGR Ram size
-9       Flag 9 TV system
-10      Flag 10 TV System, PGR-RAM presence
-11-15   Unused padding
+/*
+Print every record of a binary or delta trace file.
+Return 0 on success.
 */
-typedef struct
-{
-    uint8_t nes[4];
-    uint8_t prg_chunks;
-    uint8_t chr_chunks;
-    uint8_t mapper1;
-    uint8_t mapper2;
-    uint8_t prg_ram_size;
-    uint8_t tv_system1;
-    uint8_t tv_system2;
-    uint8_t unused[5];
-} iNesHeader;
-
-int main()
+static int dump_trace(const char *path)
 {
+    c6502_trace_reader reader;
+    c6502_trace_record rec;
 
-    /*
-    To run the nestest.rom on automation, set the program counter to 0c000h.
-    */
-    c6502_init(0xC0, 0x00);
+    if (!c6502_trace_reader_open(&reader, path))
+    {
+        return 1;
+    }
+    while (c6502_trace_reader_next(&reader, &rec))
+    {
+        printf("%04X %02X A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n", rec.PC, rec.opcode, rec.A, rec.X, rec.Y, rec.SR, rec.SP, (unsigned long long)rec.cycles);
+    }
+    c6502_trace_reader_close(&reader);
+    return 0;
+}
 
-    FILE *fp = fopen("nestest.nes", "rb");
-    if (!fp)
+/*
+Parse trigger argument "pc:XXXX", "write:XXXX" or "count:N" (hex address, decimal count).
+Return false if the argument is not a valid trigger.
+*/
+static bool parse_trigger(const char *arg, c6502_trace_trigger *trigger, uint16_t *address, uint64_t *count)
+{
+    if (strncmp(arg, "pc:", 3) == 0)
+    {
+        *trigger = C6502_TRIGGER_PC;
+        *address = (uint16_t)strtoul(arg + 3, NULL, 16);
+    }
+    else if (strncmp(arg, "write:", 6) == 0)
+    {
+        *trigger = C6502_TRIGGER_WRITE;
+        *address = (uint16_t)strtoul(arg + 6, NULL, 16);
+    }
+    else if (count && strncmp(arg, "count:", 6) == 0)
+    {
+        *trigger = C6502_TRIGGER_COUNT;
+        *count = strtoull(arg + 6, NULL, 10);
+    }
+    else
     {
-        printf("Rom file nestest.nes does not exist\n");
         return false;
     }
+    return true;
+}
 
-    iNesHeader header = {0};
-    // read header from nestest.nes rom
-    fread(&header, sizeof(iNesHeader), 1, fp);
-    // If trainer is present skip it.
-    if (header.mapper1 & 0x04)
+// Return opcode class for a class name, or -1 if the name is unknown.
+static int parse_class(const char *name)
+{
+    static const char *names[] = {"branch", "jump", "load", "store", "rmw", "stack"};
+
+    for (int i = 0; i < 6; i++)
     {
-        fseek(fp, 512, SEEK_CUR);
+        if (strcmp(name, names[i]) == 0)
+        {
+            return i;
+        }
     }
-    // Write program chunks to ram address.
-    fread(&ADDRESS[0xC000], header.prg_chunks * 16384, 1, fp);
+    return -1;
+}
 
-    //  printf("%s\n", header.nes);
+static void usage(void)
+{
+    printf("Usage: neslogs [-b file | -d file] [-w lo:hi] [-c class] [-o opcode] [-s trigger] [-e trigger] [-a]\n");
+    printf("               [-f file [-l labels]] [-m file]\n");
+    printf("       neslogs -r file\n");
+    printf("  -b file     write binary trace\n");
+    printf("  -d file     write delta encoded trace\n");
+    printf("  -r file     print records of a binary or delta trace and exit\n");
+    printf("  -w lo:hi    only trace PC in hex range lo..hi (up to %d windows)\n", C6502_TRACE_MAX_WINDOWS);
+    printf("  -c class    only trace branch, jump, load, store, rmw or stack opcodes\n");
+    printf("  -o opcode   only trace hex opcode\n");
+    printf("  -s trigger  start tracing at pc:XXXX or after write:XXXX\n");
+    printf("  -e trigger  stop tracing at pc:XXXX, after write:XXXX or after count:N instructions\n");
+    printf("  -a          rearm the start trigger after a stop\n");
+    printf("  -f file     write guest call stack cycles as folded stacks for flamegraph tools\n");
+    printf("  -l labels   label file naming the subroutines in -f output\n");
+    printf("  -m file     write a per page and per address access heatmap, summary on stderr\n");
+}
 
-    fclose(fp);
+/*
+The options -w -c -o -s -e -a filter both the printed trace and trace files.
+Run "neslogs -h" for the list of options.
+*/
+int main(int argc, char *argv[])
+{
+    c6502_trace_writer trace_writer;
+    c6502_trace_filter filter;
+    bool tracing = false;
+    const char *folded_path = NULL;
+    const char *label_path = NULL;
+    const char *heatmap_path = NULL;
+    bus_heatmap *heatmap = NULL;
 
-    //variable used in print routine
-    uint16_t temp = 0;
-    uint16_t temp2 = 0;
-    uint16_t temp3 = 0;
-    uint16_t counter = 0;
-    uint16_t LSB = 0;
-    uint16_t MSB = 0;
+    c6502_trace_filter_init(&filter);
 
-    for (int i = 0; i < 8991; i++)
+    for (int i = 1; i < argc; i++)
     {
-        c6502_read_opcode();
+        bool has_value = (i + 1 < argc);
 
-        // Pointer to the next byte after opcode.
-        counter = c6502.PC + 1;
-
-        // Read ahead next two bytes for print routine below.
-        LSB = cpu_read(counter) & 0x00FF;
-        MSB = cpu_read(counter + 1) & 0x00FF;
-
-        // Print routine to match nestest.log minus the PPU information.
-        if (lookup_table[c6502.opcode].address_mode == IMPL)
-        {
-            printf("%-4X %-8X  %4s \t\t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, lookup_table[c6502.opcode].name, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
-        }
-        else if (lookup_table[c6502.opcode].address_mode == A)
-        {
-            printf("%-4X %-8X  %4s A\t\t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, lookup_table[c6502.opcode].name, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
-        }
-        else if (lookup_table[c6502.opcode].address_mode == IMMED)
+        if (has_value && strcmp(argv[i], "-r") == 0)
         {
-            printf("%-4X %02X %02X     %4s  #$%02X \t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            return dump_trace(argv[i + 1]);
         }
-        else if (lookup_table[c6502.opcode].address_mode == ABS)
+        else if (has_value && !tracing && (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-d") == 0))
         {
-            temp = (MSB << 8) | LSB;
-            if (lookup_table[c6502.opcode].run == BCC ||
-                lookup_table[c6502.opcode].run == BCS ||
-                lookup_table[c6502.opcode].run == BEQ ||
-                lookup_table[c6502.opcode].run == BMI ||
-                lookup_table[c6502.opcode].run == BNE ||
-                lookup_table[c6502.opcode].run == BPL ||
-                lookup_table[c6502.opcode].run == BRK ||
-                lookup_table[c6502.opcode].run == BVC ||
-                lookup_table[c6502.opcode].run == BVS ||
-                lookup_table[c6502.opcode].run == JMP ||
-                lookup_table[c6502.opcode].run == JSR ||
-                lookup_table[c6502.opcode].run == JAM)
+            c6502_trace_format format = (argv[i][1] == 'd') ? C6502_TRACE_DELTA : C6502_TRACE_BINARY;
+            if (!c6502_trace_writer_open(&trace_writer, argv[++i], format))
             {
-                printf("%-4X %02X %02X %02X  %4s  $%04X \t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, temp, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+                return 1;
             }
-            else
+            tracing = true;
+        }
+        else if (has_value && strcmp(argv[i], "-w") == 0)
+        {
+            char *end = NULL;
+            uint16_t low = (uint16_t)strtoul(argv[++i], &end, 16);
+            uint16_t high = (*end == ':') ? (uint16_t)strtoul(end + 1, NULL, 16) : low;
+            if (!c6502_trace_filter_add_window(&filter, low, high))
             {
-                printf("%-4X %02X %02X %02X  %4s  $%04X = %02X \t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+                printf("Too many PC windows\n");
+                return 1;
             }
         }
-        else if (lookup_table[c6502.opcode].address_mode == ZPG)
+        else if (has_value && strcmp(argv[i], "-c") == 0 && parse_class(argv[i + 1]) >= 0)
         {
-            printf("%-4X %02X %02X     %4s  $%02X = %02X \t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, cpu_read(LSB), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            c6502_trace_filter_add_class(&filter, parse_class(argv[++i]));
         }
-        else if (lookup_table[c6502.opcode].address_mode == ABS_X)
+        else if (has_value && strcmp(argv[i], "-o") == 0)
         {
-            temp = ((MSB << 8) | LSB) + c6502.X;
-            printf("%-4X %02X %02X %02X  %4s  $%02X%02X,X @ %04X = %02X \tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, MSB, LSB, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            c6502_trace_filter_add_opcode(&filter, (uint8_t)strtoul(argv[++i], NULL, 16));
         }
-        else if (lookup_table[c6502.opcode].address_mode == ABS_Y)
+        else if (has_value && strcmp(argv[i], "-s") == 0 &&
+                 parse_trigger(argv[i + 1], &filter.start, &filter.start_address, NULL))
         {
-            temp = ((MSB << 8) | LSB) + c6502.Y;
-            printf("%-4X %02X %02X %02X  %4s  $%02X%02X,Y @ %04X = %02X \tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, MSB, LSB, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            i++;
         }
-        else if (lookup_table[c6502.opcode].address_mode == ZPG_X)
+        else if (has_value && strcmp(argv[i], "-e") == 0 &&
+                 parse_trigger(argv[i + 1], &filter.stop, &filter.stop_address, &filter.stop_count))
         {
-            temp = (LSB + c6502.X);
-            temp &= 0x00FF;
-            printf("%-4X %02X %02X     %4s  $%02X,X @ %02X = %02X \t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            i++;
         }
-        else if (lookup_table[c6502.opcode].address_mode == ZPG_Y)
+        else if (has_value && strcmp(argv[i], "-f") == 0)
         {
-            temp = (LSB + c6502.Y);
-            temp &= 0x00FF;
-            printf("%-4X %02X %02X     %4s  $%02X,Y @ %02X = %02X \t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            folded_path = argv[++i];
         }
-
-        else if (lookup_table[c6502.opcode].address_mode == IND)
+        else if (has_value && strcmp(argv[i], "-l") == 0)
         {
-            temp2 = (MSB << 8) | LSB;
-            if (LSB == 0x00FF)
-            {
-                temp = cpu_read(temp2 & 0xFF00) << 8 | cpu_read(temp2);
-            }
-            else
-            {
-                temp = cpu_read(temp2 + 1) << 8 | cpu_read(temp2);
-            }
-            printf("%-4X %02X %02X %02X  %4s  ($%02X%02X) = %04X \t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, MSB, LSB, temp, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            label_path = argv[++i];
+        }
+        else if (has_value && strcmp(argv[i], "-m") == 0)
+        {
+            heatmap_path = argv[++i];
         }
-        else if (lookup_table[c6502.opcode].address_mode == IND_X)
+        else if (strcmp(argv[i], "-a") == 0)
         {
-            temp2 = (uint16_t)cpu_read((uint16_t)(LSB + (uint16_t)c6502.X) & 0x00FF);
-            temp3 = (uint16_t)cpu_read((uint16_t)(LSB + 1 + (uint16_t)c6502.X) & 0x00FF);
-            temp = (temp3 << 8) | temp2;
-            printf("%-4X %02X %02X     %4s  ($%02X,X) @ %02X = %04X = %02X \tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, LSB + c6502.X, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            filter.rearm = true;
         }
-        else if (lookup_table[c6502.opcode].address_mode == IND_Y)
+        else
         {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!c6502_trace_filter_arm(&filter))
+    {
+        printf("Unable to install trace filter write hook\n");
+        return 1;
+    }
+
+    /*
+    To run the nestest.rom on automation, set the program counter to 0c000h.
+    */
+    c6502_init(0xC0, 0x00);
+
+    if (!c6502_load_ines("nestest.nes"))
+    {
+        return 1;
+    }
+
+    // The rom was copied straight into ADDRESS, start with an empty disassembly cache.
+    if (!c6502_disasm_init())
+    {
+        printf("Unable to install disassembly cache write hook\n");
+        return 1;
+    }
 
-            uint16_t temp2 = (uint16_t)cpu_read((uint16_t)(LSB) & 0x00FF);
-            uint16_t temp3 = (uint16_t)cpu_read((uint16_t)(LSB + 1) & 0x00FF);
-            temp = ((temp3 << 8) | temp2) + c6502.Y;
+    if (folded_path && !c6502_callstack_init(label_path))
+    {
+        return 1;
+    }
 
-            printf("%-4X %02X %02X     %4s  ($%02X),Y = %02X%02X @ %04X = %02X A:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, LSB, temp3, temp2, temp, cpu_read(temp), c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+    if (heatmap_path)
+    {
+        heatmap = c6502_heatmap_new(true);
+        if (!heatmap)
+        {
+            return 1;
         }
-        else if (lookup_table[c6502.opcode].address_mode == REL)
+        c6502_heatmap_start(heatmap);
+    }
+
+    for (int i = 0; i < 8991; i++)
+    {
+        c6502_read_opcode();
+
+        // Instructions rejected by the filter skip printing and record construction.
+        if (c6502_trace_filter_check(&filter))
         {
-            temp = LSB & 0x00FF;
-            if (LSB & 0x80)
+            // Print routine to match nestest.log minus the PPU information.
+            c6502_disasm_print(stdout);
+
+            if (tracing)
             {
-                temp = LSB | 0xFF00;
+                c6502_trace_record rec;
+                c6502_trace_capture(&rec);
+                c6502_trace_writer_put(&trace_writer, &rec);
             }
-            printf("%-4X %02X %02X     %4s  $%02X \t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, lookup_table[c6502.opcode].name, c6502.PC + 2 + temp, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+        }
+
+        // Advance Program Counter and run instruction.
+        if (folded_path)
+        {
+            c6502_callstack_execute();
         }
         else
         {
-            printf("%-4X %02X %02X %02X  %4s  $%02X%02X \t\t\tA:%02X X:%02X Y:%02X P:%-2X SP:%-2X CYC:%-6d\n", c6502.PC, c6502.opcode, LSB, MSB, lookup_table[c6502.opcode].name, MSB, LSB, c6502.A, c6502.X, c6502.Y, c6502.SR, c6502.SP, c6502.cycles);
+            c6502_execute();
+        }
+    }
+
+    if (folded_path)
+    {
+        if (!c6502_callstack_write(folded_path))
+        {
+            printf("Unable to write %s\n", folded_path);
+        }
+        c6502_callstack_free();
+    }
+
+    if (heatmap)
+    {
+        c6502_heatmap_stop();
+        if (!c6502_heatmap_save(heatmap, heatmap_path))
+        {
+            printf("Unable to write %s\n", heatmap_path);
         }
-        // Advance Program Counter.
-        c6502.PC++;
-        // Run instruction
-        lookup_table[c6502.opcode].run();
+        c6502_heatmap_summary(heatmap, stderr, 16);
+        c6502_heatmap_free(heatmap);
+    }
+
+#ifdef C6502_PROFILE
+    c6502_profile_report(stderr);
+#endif
+
+    c6502_trace_filter_disarm(&filter);
+    c6502_disasm_free();
+    if (tracing)
+    {
+        c6502_trace_writer_close(&trace_writer);
     }
 
     if (ADDRESS[0x02] == 0 && ADDRESS[0x03] == 0)
@@ -0,0 +1,177 @@
+/*
+perfevent.c
+Linux perf_event counters read around emulation slices.
+*/
+
+#include <string.h>
+#include "perfevent.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// perf_event type and config of every counter.
+static const struct
+{
+    uint32_t type;
+    uint64_t config;
+} perf_events[C6502_PERF_COUNTERS] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+// Read counter fd, scaled up for the time it was multiplexed out. Return 0 on error.
+static double perf_read(int fd)
+{
+    uint64_t values[3]; // value, time enabled, time running
+
+    if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0)
+    {
+        return 0;
+    }
+    return (double)values[0] * values[1] / values[2];
+}
+
+#endif
+
+/*
+c6502_perf_open() Open the counters of the calling thread.
+*/
+int c6502_perf_open(c6502_perf *perf)
+{
+    int opened = 0;
+
+    memset(perf, 0, sizeof(c6502_perf));
+    for (int i = 0; i < C6502_PERF_COUNTERS; i++)
+    {
+        perf->fd[i] = -1;
+#ifdef __linux__
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[i].type;
+        attr.config = perf_events[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        perf->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        opened += (perf->fd[i] >= 0);
+#endif
+    }
+    return opened;
+}
+
+/*
+c6502_perf_close() Close counters.
+*/
+void c6502_perf_close(c6502_perf *perf)
+{
+    for (int i = 0; i < C6502_PERF_COUNTERS; i++)
+    {
+#ifdef __linux__
+        if (perf->fd[i] >= 0)
+        {
+            close(perf->fd[i]);
+        }
+#endif
+        perf->fd[i] = -1;
+    }
+}
+
+/*
+c6502_perf_reset() Clear totals.
+*/
+void c6502_perf_reset(c6502_perf *perf)
+{
+    memset(perf->total, 0, sizeof(perf->total));
+    perf->guest_instructions = 0;
+}
+
+/*
+c6502_perf_begin() Read the counters at the start of a slice.
+*/
+void c6502_perf_begin(c6502_perf *perf)
+{
+#ifdef __linux__
+    for (int i = 0; i < C6502_PERF_COUNTERS; i++)
+    {
+        if (perf->fd[i] >= 0)
+        {
+            perf->start[i] = perf_read(perf->fd[i]);
+        }
+    }
+#endif
+}
+
+/*
+c6502_perf_end() Read the counters at the end of a slice, add the difference.
+*/
+void c6502_perf_end(c6502_perf *perf, uint64_t guest_instructions)
+{
+#ifdef __linux__
+    for (int i = 0; i < C6502_PERF_COUNTERS; i++)
+    {
+        if (perf->fd[i] >= 0)
+        {
+            perf->total[i] += perf_read(perf->fd[i]) - perf->start[i];
+        }
+    }
+#endif
+    perf->guest_instructions += guest_instructions;
+}
+
+// Print numerator / divisor, or n/a when a counter is missing or nothing was counted.
+static void perf_print(FILE *fp, bool available, double numerator, double divisor, const char *format)
+{
+    if (!available || divisor == 0)
+    {
+        fprintf(fp, " %9s", "n/a");
+        return;
+    }
+    fprintf(fp, format, numerator / divisor);
+}
+
+/*
+c6502_perf_report_header() Column names.
+*/
+void c6502_perf_report_header(FILE *fp)
+{
+    fprintf(fp, "%-24s %12s %9s %9s %9s %9s %9s %9s %9s %9s\n", "workload", "guest instr", "ns/instr",
+            "cyc/instr", "ins/instr", "IPC", "brmiss/i", "brmiss%", "L1d/i", "L1i/i");
+}
+
+/*
+c6502_perf_report() Per guest instruction costs of the slices so far.
+*/
+void c6502_perf_report(const c6502_perf *perf, FILE *fp, const char *label)
+{
+    const double *t = perf->total;
+    double guest = (double)perf->guest_instructions;
+    bool has[C6502_PERF_COUNTERS];
+
+    for (int i = 0; i < C6502_PERF_COUNTERS; i++)
+    {
+        has[i] = perf->fd[i] >= 0;
+    }
+    fprintf(fp, "%-24s %12llu", label, (unsigned long long)perf->guest_instructions);
+    perf_print(fp, has[C6502_PERF_TASK_CLOCK], t[C6502_PERF_TASK_CLOCK], guest, " %9.2f");
+    perf_print(fp, has[C6502_PERF_CYCLES], t[C6502_PERF_CYCLES], guest, " %9.2f");
+    perf_print(fp, has[C6502_PERF_INSTRUCTIONS], t[C6502_PERF_INSTRUCTIONS], guest, " %9.2f");
+    perf_print(fp, has[C6502_PERF_INSTRUCTIONS] && has[C6502_PERF_CYCLES], t[C6502_PERF_INSTRUCTIONS],
+               t[C6502_PERF_CYCLES], " %9.2f");
+    perf_print(fp, has[C6502_PERF_BRANCH_MISSES], t[C6502_PERF_BRANCH_MISSES], guest, " %9.3f");
+    perf_print(fp, has[C6502_PERF_BRANCH_MISSES] && has[C6502_PERF_BRANCHES], 100 * t[C6502_PERF_BRANCH_MISSES],
+               t[C6502_PERF_BRANCHES], " %8.2f%%");
+    perf_print(fp, has[C6502_PERF_L1D_MISSES], t[C6502_PERF_L1D_MISSES], guest, " %9.3f");
+    perf_print(fp, has[C6502_PERF_L1I_MISSES], t[C6502_PERF_L1I_MISSES], guest, " %9.3f");
+    fprintf(fp, "\n");
+}
@@ -0,0 +1,68 @@
+// perfevent.h
+
+#ifndef PERFEVENT_H
+#define PERFEVENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Host hardware counters around slices of emulation, through Linux perf_event.
+
+c6502_perf_open() opens the counters below for the calling thread, user space only. Counters the
+kernel or the machine does not offer (virtual machines often have no PMU, perf_event_paranoid may
+forbid them) stay closed and are reported as n/a; the task clock is a software counter and is
+nearly always there. Wrap each slice of emulation in c6502_perf_begin() / c6502_perf_end(): every
+call reads each open counter with one read(), so slices of a few thousand instructions or more
+keep the cost out of the numbers. Counts are scaled when the kernel multiplexes counters.
+
+On other systems c6502_perf_open() opens nothing and every counter is n/a.
+*/
+
+typedef enum
+{
+    C6502_PERF_TASK_CLOCK, // Host ns of cpu time
+    C6502_PERF_CYCLES,
+    C6502_PERF_INSTRUCTIONS,
+    C6502_PERF_BRANCHES,
+    C6502_PERF_BRANCH_MISSES,
+    C6502_PERF_L1D_MISSES, // L1 data cache read misses
+    C6502_PERF_L1I_MISSES, // L1 instruction cache read misses
+    C6502_PERF_COUNTERS,
+} c6502_perf_counter;
+
+typedef struct
+{
+    int fd[C6502_PERF_COUNTERS]; // -1 if the counter is not available
+    double start[C6502_PERF_COUNTERS];
+    double total[C6502_PERF_COUNTERS];
+    uint64_t guest_instructions;
+} c6502_perf;
+
+// Open every available counter. Return the number opened.
+int c6502_perf_open(c6502_perf *perf);
+
+// Close counters.
+void c6502_perf_close(c6502_perf *perf);
+
+// Clear totals.
+void c6502_perf_reset(c6502_perf *perf);
+
+// Start a slice.
+void c6502_perf_begin(c6502_perf *perf);
+
+// End a slice that ran guest_instructions emulated instructions and add it to the totals.
+void c6502_perf_end(c6502_perf *perf, uint64_t guest_instructions);
+
+// Print the column header of c6502_perf_report().
+void c6502_perf_report_header(FILE *fp);
+
+/*
+Print one line for label: guest instructions, then per guest instruction host ns, host cycles,
+host instructions and branch misses, plus host IPC, the branch miss rate and L1 misses per guest
+instruction.
+*/
+void c6502_perf_report(const c6502_perf *perf, FILE *fp, const char *label);
+
+#endif
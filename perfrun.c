@@ -0,0 +1,236 @@
+/*
+perfrun.c
+c6502-perf reads host perf_event counters around slices of emulation.
+
+Each workload runs on the interpreter (c6502_step() through lookup_table) and on the lockstep
+engine (64 lanes of the same machine), and both get a line of host cost per emulated instruction:
+ns, cycles, instructions, IPC, branch misses and L1 misses. Counters the host does not offer are
+printed as n/a.
+
+The default workload is nestest.nes, reset to a baseline every 8991 instructions outside the
+measured slices. Images given on the command line are run instead, one after the other, which
+gives a breakdown by guest opcode class with images from c6502-gen:
+
+    for c in load store alu rmw branch jump stack register; do c6502-gen -m $c=1 $c.bin; done
+    c6502-perf -b 0800 -p 0800 load.bin store.bin alu.bin rmw.bin branch.bin jump.bin stack.bin register.bin
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "c6502.h"
+#include "loader.h"
+#include "baseline.h"
+#include "lockstep.h"
+#include "perfevent.h"
+
+#define PERF_INSTRUCTIONS 10000000
+#define PERF_SLICE 10000
+// Instructions per nestest run, as in main.c.
+#define PERF_NESTEST_STEPS 8991
+
+static long instructions = PERF_INSTRUCTIONS;
+static int slice = PERF_SLICE;
+
+/*
+Run the interpreter. The machine is reset to baseline every period instructions, 0 for never.
+Stop early if the cpu jams.
+*/
+static void perf_interpreter(c6502_perf *perf, c6502_baseline *baseline, long period)
+{
+    long since_reset = 0;
+
+    c6502_baseline_reset(baseline);
+    for (long done = 0; done < instructions && !c6502.JAM;)
+    {
+        long steps = (instructions - done < slice) ? instructions - done : slice;
+        long run = 0;
+
+        if (period && since_reset + steps > period)
+        {
+            steps = period - since_reset;
+        }
+        c6502_perf_begin(perf);
+        while (run < steps && !c6502.JAM)
+        {
+            c6502_step();
+            run++;
+        }
+        c6502_perf_end(perf, run);
+        done += run;
+        since_reset += run;
+        if (period && since_reset == period)
+        {
+            c6502_baseline_reset(baseline);
+            since_reset = 0;
+        }
+    }
+}
+
+// Copy the baseline machine into every lane.
+static void perf_load_lanes(c6502_lockstep *ls, c6502_baseline *baseline)
+{
+    c6502_baseline_reset(baseline);
+    for (int lane = 0; lane < ls->lanes; lane++)
+    {
+        c6502_lockstep_load(ls, lane);
+    }
+}
+
+// Run the lockstep engine. Guest instructions are counted over all lanes.
+static void perf_lockstep(c6502_perf *perf, c6502_lockstep *ls, c6502_baseline *baseline, long period)
+{
+    long steps_per_slice = slice / ls->lanes > 0 ? slice / ls->lanes : 1;
+    long since_reset = 0;
+
+    perf_load_lanes(ls, baseline);
+    for (long done = 0; done < instructions;)
+    {
+        long steps = steps_per_slice;
+        uint64_t run = 0;
+        int lanes = 1;
+
+        if (period && since_reset + steps > period)
+        {
+            steps = period - since_reset;
+        }
+        c6502_perf_begin(perf);
+        for (long i = 0; i < steps && lanes > 0; i++)
+        {
+            lanes = c6502_lockstep_step(ls);
+            run += lanes;
+        }
+        c6502_perf_end(perf, run);
+        if (lanes == 0)
+        {
+            break;
+        }
+        done += run;
+        since_reset += steps;
+        if (period && since_reset == period)
+        {
+            perf_load_lanes(ls, baseline);
+            since_reset = 0;
+        }
+    }
+}
+
+// Measure the machine in baseline on both engines and print a line for each.
+static void perf_workload(const char *name, c6502_baseline *baseline, c6502_lockstep *ls, long period)
+{
+    c6502_perf perf;
+    char label[64];
+
+    c6502_perf_open(&perf);
+
+    snprintf(label, sizeof(label), "%.40s interp", name);
+    perf_interpreter(&perf, baseline, period);
+    c6502_perf_report(&perf, stdout, label);
+
+    c6502_perf_reset(&perf);
+    snprintf(label, sizeof(label), "%.40s lockstep", name);
+    perf_lockstep(&perf, ls, baseline, period);
+    c6502_perf_report(&perf, stdout, label);
+
+    c6502_perf_close(&perf);
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-perf [-n instructions] [-l slice] [-b base] [-p pc] [image ...]\n");
+    printf("  -n instructions  emulated instructions per workload and engine, default %d\n", PERF_INSTRUCTIONS);
+    printf("  -l slice         emulated instructions between counter reads, default %d\n", PERF_SLICE);
+    printf("  -b base          hex load address of raw binaries, default 0000\n");
+    printf("  -p pc            hex start address, default the reset vector of the image\n");
+    printf("Without images nestest.nes is measured.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t base = 0x0000;
+    long start = -1;
+    int first_image = argc;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-n") == 0)
+        {
+            instructions = atol(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-l") == 0)
+        {
+            slice = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-b") == 0)
+        {
+            base = (uint16_t)strtoul(argv[++i], NULL, 16);
+        }
+        else if (has_value && strcmp(argv[i], "-p") == 0)
+        {
+            start = (long)strtoul(argv[++i], NULL, 16);
+        }
+        else if (argv[i][0] != '-')
+        {
+            first_image = i;
+            break;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (instructions < 1 || slice < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    c6502_baseline *baseline = malloc(sizeof(c6502_baseline));
+    c6502_lockstep *ls = malloc(sizeof(c6502_lockstep));
+    c6502_perf probe;
+
+    if (!baseline || !ls || !c6502_lockstep_init(ls, C6502_LOCKSTEP_LANES))
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    int opened = c6502_perf_open(&probe);
+    c6502_perf_close(&probe);
+    printf("%d of %d host counters available, %ld instructions per engine, counters read every %d\n",
+           opened, C6502_PERF_COUNTERS, instructions, slice);
+    c6502_perf_report_header(stdout);
+
+    if (first_image == argc)
+    {
+        memset(ADDRESS, 0, sizeof(ADDRESS));
+        c6502_init(0xC0, 0x00);
+        if (!c6502_load_ines("nestest.nes"))
+        {
+            return 1;
+        }
+        c6502_baseline_capture(baseline);
+        perf_workload("nestest", baseline, ls, PERF_NESTEST_STEPS);
+    }
+    for (int i = first_image; i < argc; i++)
+    {
+        memset(ADDRESS, 0, sizeof(ADDRESS));
+        if (!c6502_load_file(argv[i], base))
+        {
+            return 1;
+        }
+        long pc = (start < 0) ? (ADDRESS[0xFFFC] | ADDRESS[0xFFFD] << 8) : start;
+        uint8_t vector[2] = {ADDRESS[0xFFFC], ADDRESS[0xFFFD]};
+        c6502_init(pc >> 8, pc & 0xFF);
+        ADDRESS[0xFFFC] = vector[0];
+        ADDRESS[0xFFFD] = vector[1];
+        c6502_baseline_capture(baseline);
+        perf_workload(argv[i], baseline, ls, 0);
+    }
+
+    c6502_lockstep_free(ls);
+    free(ls);
+    free(baseline);
+    return 0;
+}
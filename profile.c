@@ -0,0 +1,78 @@
+/*
+profile.c
+Per opcode execution and cycle counters. Empty unless built with -DC6502_PROFILE.
+*/
+
+#include "profile.h"
+
+#ifdef C6502_PROFILE
+
+#include <stdlib.h>
+#include <string.h>
+
+C6502_THREAD_LOCAL c6502_profile_entry c6502_profile[256];
+
+/*
+Sort opcodes by total cycles, then executions, descending, then by opcode. Opcodes that ran
+without using cycles (JAM, UNK) sort before the ones that never ran, so the report reaches them.
+*/
+static int profile_compare(const void *a, const void *b)
+{
+    const c6502_profile_entry *x = &c6502_profile[*(const uint8_t *)a];
+    const c6502_profile_entry *y = &c6502_profile[*(const uint8_t *)b];
+
+    if (x->cycles != y->cycles)
+    {
+        return (x->cycles < y->cycles) - (x->cycles > y->cycles);
+    }
+    if (x->executions != y->executions)
+    {
+        return (x->executions < y->executions) - (x->executions > y->executions);
+    }
+    return *(const uint8_t *)a - *(const uint8_t *)b;
+}
+
+// c6502_profile_report() Sorted table of every opcode that ran.
+void c6502_profile_report(FILE *fp)
+{
+    uint8_t order[256];
+    uint64_t total = 0;
+
+    for (int i = 0; i < 256; i++)
+    {
+        order[i] = i;
+        total += c6502_profile[i].cycles;
+    }
+    qsort(order, 256, sizeof(uint8_t), profile_compare);
+
+    fprintf(fp, "op  name   executions       cycles  cycles%%  avg  page cross      taken  not taken\n");
+    for (int i = 0; i < 256; i++)
+    {
+        uint8_t opcode = order[i];
+        const c6502_profile_entry *entry = &c6502_profile[opcode];
+
+        // Every opcode that ran sorts before those that did not.
+        if (entry->executions == 0)
+        {
+            break;
+        }
+        fprintf(fp, "%02X  %-5s %11llu %12llu %7.2f%% %4.1f %11llu", opcode, lookup_table[opcode].name,
+                (unsigned long long)entry->executions, (unsigned long long)entry->cycles,
+                total ? 100.0 * entry->cycles / total : 0.0, (double)entry->cycles / entry->executions,
+                (unsigned long long)entry->page_crossings);
+        if (lookup_table[opcode].address_mode == REL)
+        {
+            fprintf(fp, " %10llu %10llu", (unsigned long long)entry->taken,
+                    (unsigned long long)(entry->executions - entry->taken));
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+// c6502_profile_reset() Clear counters.
+void c6502_profile_reset(void)
+{
+    memset(c6502_profile, 0, sizeof(c6502_profile));
+}
+
+#endif
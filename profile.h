@@ -0,0 +1,73 @@
+// profile.h
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "c6502.h"
+
+/*
+Per opcode profiler, compiled in with -DC6502_PROFILE (make PROFILE=1).
+
+c6502_execute() counts every instruction it runs: executions, total cycles, and the cycles the
+instruction took beyond its lookup_table cycles. For branches one extra cycle means taken, two
+mean taken across a page. For other opcodes extra cycles are page crossing penalties.
+Interrupt entry cycles are not counted. Counters are per thread.
+
+Without C6502_PROFILE the hooks in c6502_execute() expand to nothing.
+*/
+
+#ifdef C6502_PROFILE
+
+#ifdef C6502_UNTIMED
+#error "The profiler counts cycles and page crossings, which an untimed build does not keep"
+#endif
+
+typedef struct
+{
+    uint64_t executions;
+    uint64_t cycles;
+    uint64_t page_crossings; // Extra cycles from page crossing, branches included
+    uint64_t taken;          // Branches taken
+} c6502_profile_entry;
+
+extern C6502_THREAD_LOCAL c6502_profile_entry c6502_profile[256];
+
+// Count one execution of opcode that took cycles.
+static inline void c6502_profile_count(uint8_t opcode, uint64_t cycles)
+{
+    c6502_profile_entry *entry = &c6502_profile[opcode];
+    uint8_t base = lookup_table[opcode].cycles;
+    uint64_t extra = (cycles > base) ? cycles - base : 0;
+
+    entry->executions++;
+    entry->cycles += cycles;
+    if (lookup_table[opcode].address_mode == REL)
+    {
+        entry->taken += (extra > 0);
+        entry->page_crossings += (extra > 1);
+    }
+    else
+    {
+        entry->page_crossings += extra;
+    }
+}
+
+#define C6502_PROFILE_BEGIN() uint64_t profile_start = c6502.cycles
+#define C6502_PROFILE_END() c6502_profile_count(c6502.opcode, c6502.cycles - profile_start)
+
+// Write the counters of this thread sorted by total cycles, most expensive opcode first.
+void c6502_profile_report(FILE *fp);
+
+// Clear the counters of this thread.
+void c6502_profile_reset(void);
+
+#else
+
+#define C6502_PROFILE_BEGIN()
+#define C6502_PROFILE_END()
+
+#endif
+
+#endif
@@ -0,0 +1,272 @@
+/*
+replay.c
+Record and replay of interrupts, io reads and host input. See replay.h for the log format.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+#include "savestate.h"
+
+static const uint8_t replay_magic[4] = {'C', '6', 'R', 'P'};
+
+// Recorder state
+static FILE *record_fp = NULL;
+static bus_io record_saved[256];
+
+// Replayer state
+static c6502_replay_event *events = NULL;
+static size_t event_count = 0;
+static size_t event_next = 0;
+static bool replay_mapped[256];
+static bool desync = false;
+static c6502_input_handler input_handler = NULL;
+
+static void record_event(c6502_event_type type, uint16_t address, uint8_t value)
+{
+    c6502_replay_event event = {c6502.cycles, address, type, value, 0};
+    fwrite(&event, sizeof(event), 1, record_fp);
+}
+
+// io read handler installed while recording. Read from the device and log the value.
+static uint8_t record_io_read(void *ctx, uint16_t abs_address)
+{
+    bus_io *io = ctx;
+    uint8_t value = io->read(io->ctx, abs_address);
+    record_event(C6502_EVENT_IO_READ, abs_address, value);
+    return value;
+}
+
+// c6502_record_start() Write header and starting state, then wrap io read handlers.
+bool c6502_record_start(const char *path)
+{
+    uint16_t version = C6502_REPLAY_VERSION;
+    uint8_t io_map[64] = {0};
+    uint32_t state_size = c6502_state_size();
+    uint8_t *state = malloc(state_size);
+
+    record_fp = fopen(path, "wb");
+    if (!record_fp || !state)
+    {
+        printf("Unable to create replay log %s\n", path);
+        if (record_fp)
+        {
+            fclose(record_fp);
+            record_fp = NULL;
+        }
+        free(state);
+        return false;
+    }
+
+    for (int page = 0; page < 256; page++)
+    {
+        record_saved[page] = bus_get_io(page);
+        io_map[page >> 3] |= (record_saved[page].read != NULL) << (page & 0x07);
+        io_map[32 + (page >> 3)] |= (record_saved[page].write != NULL) << (page & 0x07);
+    }
+
+    c6502_state_save(state, state_size);
+    fwrite(replay_magic, sizeof(replay_magic), 1, record_fp);
+    fwrite(&version, sizeof(version), 1, record_fp);
+    fwrite(io_map, sizeof(io_map), 1, record_fp);
+    fwrite(&state_size, sizeof(state_size), 1, record_fp);
+    fwrite(state, state_size, 1, record_fp);
+    free(state);
+
+    for (int page = 0; page < 256; page++)
+    {
+        if (record_saved[page].read)
+        {
+            bus_map_io(page, record_io_read, record_saved[page].write, &record_saved[page]);
+        }
+    }
+    return true;
+}
+
+// c6502_record_irq() Log and raise IRQ.
+void c6502_record_irq()
+{
+    record_event(C6502_EVENT_IRQ, 0, 0);
+    c6502_irq();
+}
+
+// c6502_record_nmi() Log and raise NMI.
+void c6502_record_nmi()
+{
+    record_event(C6502_EVENT_NMI, 0, 0);
+    c6502_nmi();
+}
+
+// c6502_record_input() Log host input.
+void c6502_record_input(uint16_t port, uint8_t value)
+{
+    record_event(C6502_EVENT_INPUT, port, value);
+}
+
+// c6502_record_stop() Log end, restore io handlers, close log.
+void c6502_record_stop()
+{
+    if (!record_fp)
+    {
+        return;
+    }
+    record_event(C6502_EVENT_END, 0, 0);
+    fclose(record_fp);
+    record_fp = NULL;
+
+    for (int page = 0; page < 256; page++)
+    {
+        if (record_saved[page].read)
+        {
+            bus_map_io(page, record_saved[page].read, record_saved[page].write, record_saved[page].ctx);
+        }
+    }
+}
+
+// io read handler installed while replaying. Return the next logged io read.
+static uint8_t replay_io_read(void *ctx, uint16_t abs_address)
+{
+    if (event_next < event_count &&
+        events[event_next].type == C6502_EVENT_IO_READ &&
+        events[event_next].address == abs_address)
+    {
+        return events[event_next++].value;
+    }
+    desync = true;
+    return 0;
+}
+
+// io write handler installed while replaying. Device models are not present, drop the write.
+static void replay_io_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+}
+
+// c6502_replay_start() Read the whole log, load starting state and map io pages.
+bool c6502_replay_start(const char *path, c6502_input_handler input)
+{
+    uint8_t header[4 + 2 + 64 + 4];
+    uint16_t version = 0;
+    uint32_t state_size = 0;
+    uint8_t *state = NULL;
+    bool ok = false;
+
+    c6502_replay_stop();
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        printf("Replay log %s does not exist\n", path);
+        return false;
+    }
+    if (fread(header, sizeof(header), 1, fp) == 1 && memcmp(header, replay_magic, 4) == 0)
+    {
+        memcpy(&version, &header[4], 2);
+        memcpy(&state_size, &header[70], 4);
+        state = malloc(state_size);
+    }
+    if (state && version == C6502_REPLAY_VERSION &&
+        fread(state, state_size, 1, fp) == 1 && c6502_state_load(state, state_size))
+    {
+        long start = ftell(fp);
+        fseek(fp, 0, SEEK_END);
+        event_count = (ftell(fp) - start) / sizeof(c6502_replay_event);
+        fseek(fp, start, SEEK_SET);
+        events = malloc(event_count * sizeof(c6502_replay_event) + 1);
+        ok = events && fread(events, sizeof(c6502_replay_event), event_count, fp) == event_count;
+    }
+    free(state);
+    fclose(fp);
+
+    if (!ok)
+    {
+        printf("%s is not a valid replay log\n", path);
+        c6502_replay_stop();
+        return false;
+    }
+
+    for (int page = 0; page < 256; page++)
+    {
+        bool read = (header[6 + (page >> 3)] >> (page & 0x07)) & 1;
+        bool write = (header[38 + (page >> 3)] >> (page & 0x07)) & 1;
+        replay_mapped[page] = read || write;
+        if (replay_mapped[page])
+        {
+            bus_map_io(page, read ? replay_io_read : NULL, write ? replay_io_write : NULL, NULL);
+        }
+    }
+    event_next = 0;
+    desync = false;
+    input_handler = input;
+    return true;
+}
+
+// c6502_replay_step() Deliver due events, then run one instruction.
+bool c6502_replay_step()
+{
+    // io reads logged before this instruction started were never made by the replay.
+    while (event_next < event_count && events[event_next].type == C6502_EVENT_IO_READ &&
+           events[event_next].cycles < c6502.cycles)
+    {
+        desync = true;
+        event_next++;
+    }
+
+    while (event_next < event_count && events[event_next].type != C6502_EVENT_IO_READ &&
+           events[event_next].cycles <= c6502.cycles)
+    {
+        c6502_replay_event *event = &events[event_next++];
+
+        // Events are logged at instruction boundaries, so they are due exactly at their cycle.
+        desync |= event->cycles != c6502.cycles;
+
+        switch (event->type)
+        {
+        case C6502_EVENT_IRQ:
+            c6502_irq();
+            break;
+        case C6502_EVENT_NMI:
+            c6502_nmi();
+            break;
+        case C6502_EVENT_INPUT:
+            if (input_handler)
+            {
+                input_handler(event->address, event->value);
+            }
+            break;
+        case C6502_EVENT_END:
+            event_next = event_count;
+            return false;
+        }
+    }
+
+    if (event_next >= event_count)
+    {
+        return false;
+    }
+    c6502_step();
+    return true;
+}
+
+// c6502_replay_desync() Return true if replay diverged.
+bool c6502_replay_desync()
+{
+    return desync;
+}
+
+// c6502_replay_stop() Unmap replay io handlers and free events.
+void c6502_replay_stop()
+{
+    for (int page = 0; page < 256; page++)
+    {
+        if (replay_mapped[page])
+        {
+            bus_map_io(page, NULL, NULL, NULL);
+            replay_mapped[page] = false;
+        }
+    }
+    free(events);
+    events = NULL;
+    event_count = 0;
+    event_next = 0;
+}
@@ -0,0 +1,86 @@
+// replay.h
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Deterministic record and replay.
+
+The cpu and memory are deterministic, so a run can be reproduced from its starting state plus
+every input that came from outside: interrupts, values read from memory mapped devices and
+host input such as controller state. Each input is logged with the cycle count at which it
+happened.
+
+Recording: call c6502_record_start(), then use c6502_record_irq() / c6502_record_nmi() in place
+of c6502_irq() / c6502_nmi() and report host input with c6502_record_input(). Reads from pages
+mapped with bus_map_io() are logged automatically. Map devices before starting the recording.
+
+Replay: c6502_replay_start() loads the starting state and maps every io page of the recording to
+the replayer, so device models are not needed at all. Then call c6502_replay_step() until it
+returns false. Interrupts are raised at their recorded cycle and io reads return their logged
+values. Writes to pages that had an io write handler are dropped.
+
+Log file: "C6RP", uint16 version, 32 byte bitmap of pages with an io read handler, 32 byte
+bitmap of pages with an io write handler, uint32 save state size, save state, then
+c6502_replay_event records until the end of the file. The last event of a complete recording
+is C6502_EVENT_END.
+*/
+
+#define C6502_REPLAY_VERSION 1
+
+typedef enum
+{
+    C6502_EVENT_IRQ = 0,     // c6502_irq() called
+    C6502_EVENT_NMI = 1,     // c6502_nmi() called
+    C6502_EVENT_IO_READ = 2, // value read from an io page at address
+    C6502_EVENT_INPUT = 3,   // host input value on port (address)
+    C6502_EVENT_END = 4,     // recording stopped
+} c6502_event_type;
+
+typedef struct
+{
+    uint64_t cycles;  // c6502.cycles when the event happened
+    uint16_t address; // io address or input port
+    uint8_t type;     // c6502_event_type
+    uint8_t value;    // io read value or input value
+    uint32_t reserved;
+} c6502_replay_event;
+
+// Called by the replayer for every C6502_EVENT_INPUT event.
+typedef void (*c6502_input_handler)(uint16_t port, uint8_t value);
+
+// Start recording to path. Return false if the log file can not be created.
+bool c6502_record_start(const char *path);
+
+// Raise IRQ and log it.
+void c6502_record_irq();
+
+// Raise NMI and log it.
+void c6502_record_nmi();
+
+// Log host input value for port. The host applies the input to its devices itself.
+void c6502_record_input(uint16_t port, uint8_t value);
+
+// Log the end of the recording, restore the io handlers and close the log.
+void c6502_record_stop();
+
+// Load a recording. Return false if the file can not be read or is not a valid recording.
+bool c6502_replay_start(const char *path, c6502_input_handler input);
+
+/*
+Deliver events due at the current cycle, then run one instruction.
+Return false once the end of the recording is reached.
+*/
+bool c6502_replay_step();
+
+// Return true if replay diverged from the recording (an event was missed or an io read did not match).
+bool c6502_replay_desync();
+
+// Unmap the replay io handlers and free the log.
+void c6502_replay_stop();
+
+#endif
@@ -0,0 +1,406 @@
+/*
+reverse.c
+Reverse stepping from in memory checkpoints plus deterministic re-execution.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "reverse.h"
+#include "savestate.h"
+
+typedef enum
+{
+    REVERSE_IRQ,
+    REVERSE_NMI,
+    REVERSE_IO_READ,
+} reverse_event_type;
+
+typedef struct
+{
+    uint64_t position;
+    uint16_t address;
+    uint8_t type;
+    uint8_t value;
+} reverse_event;
+
+typedef struct
+{
+    uint64_t position;
+    size_t event_index; // First event at or after position
+    uint8_t *state;
+} reverse_checkpoint;
+
+static reverse_checkpoint *checkpoints = NULL;
+static int checkpoint_count = 0;
+static int checkpoint_max = 0;
+static uint64_t spacing = 0;
+static size_t state_size = 0;
+
+static reverse_event *events = NULL;
+static size_t event_count = 0;
+static size_t event_capacity = 0;
+// Next logged event to feed back while re-executing.
+static size_t cursor = 0;
+
+static uint64_t position = 0;
+// First position that has not been executed yet.
+static uint64_t frontier = 0;
+
+static bus_io saved_io[256];
+
+// Watchpoints checked by the write hook while searching backwards.
+static const uint16_t *watch = NULL;
+static int watch_count = 0;
+static bool watch_hit = false;
+
+static bool reverse_replaying()
+{
+    return position < frontier;
+}
+
+static void reverse_log(reverse_event_type type, uint16_t address, uint8_t value)
+{
+    if (event_count == event_capacity)
+    {
+        size_t grown = event_capacity ? event_capacity * 2 : 4096;
+        reverse_event *larger = realloc(events, grown * sizeof(reverse_event));
+        if (!larger)
+        {
+            return;
+        }
+        events = larger;
+        event_capacity = grown;
+    }
+    events[event_count++] = (reverse_event){position, address, type, value};
+}
+
+// io read wrapper. Log device reads while recording, return logged reads while re-executing.
+static uint8_t reverse_io_read(void *ctx, uint16_t abs_address)
+{
+    bus_io *io = ctx;
+
+    if (reverse_replaying())
+    {
+        if (cursor < event_count && events[cursor].type == REVERSE_IO_READ)
+        {
+            return events[cursor++].value;
+        }
+        return 0;
+    }
+    uint8_t value = io->read(io->ctx, abs_address);
+    reverse_log(REVERSE_IO_READ, abs_address, value);
+    return value;
+}
+
+// Bus write hook. Flag writes to a watched address.
+static void reverse_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+    for (int i = 0; i < watch_count; i++)
+    {
+        watch_hit |= (abs_address == watch[i]);
+    }
+}
+
+// Save a checkpoint at the current position. Thin out checkpoints when full.
+static bool reverse_checkpoint_save()
+{
+    if (checkpoint_count == checkpoint_max)
+    {
+        // Keep checkpoint 0 and every second one after it.
+        int kept = 1;
+        for (int i = 1; i < checkpoint_count; i++)
+        {
+            if (i % 2 == 0)
+            {
+                checkpoints[kept++] = checkpoints[i];
+            }
+            else
+            {
+                free(checkpoints[i].state);
+            }
+        }
+        checkpoint_count = kept;
+        spacing *= 2;
+    }
+
+    uint8_t *state = malloc(state_size);
+    if (!state)
+    {
+        return false;
+    }
+    c6502_state_save(state, state_size);
+    checkpoints[checkpoint_count++] = (reverse_checkpoint){position, event_count, state};
+    return true;
+}
+
+// Drop checkpoints and events after the current position. Recording continues from here.
+static void reverse_truncate()
+{
+    while (checkpoint_count > 1 && checkpoints[checkpoint_count - 1].position > position)
+    {
+        free(checkpoints[--checkpoint_count].state);
+    }
+    event_count = cursor;
+    frontier = position;
+}
+
+// c6502_reverse_init() Checkpoint position 0 and wrap io handlers.
+bool c6502_reverse_init(uint64_t checkpoint_spacing, int max_checkpoints)
+{
+    c6502_reverse_free();
+
+    state_size = c6502_state_size();
+    spacing = checkpoint_spacing ? checkpoint_spacing : C6502_REVERSE_SPACING;
+    checkpoint_max = (max_checkpoints > 2) ? max_checkpoints : C6502_REVERSE_CHECKPOINTS;
+    checkpoints = malloc(checkpoint_max * sizeof(reverse_checkpoint));
+    if (!checkpoints || !bus_add_write_hook(reverse_write, NULL))
+    {
+        free(checkpoints);
+        checkpoints = NULL;
+        return false;
+    }
+
+    position = 0;
+    frontier = 0;
+    cursor = 0;
+    if (!reverse_checkpoint_save())
+    {
+        c6502_reverse_free();
+        return false;
+    }
+
+    for (int page = 0; page < 256; page++)
+    {
+        saved_io[page] = bus_get_io(page);
+        if (saved_io[page].read)
+        {
+            bus_map_io(page, reverse_io_read, saved_io[page].write, &saved_io[page]);
+        }
+    }
+    return true;
+}
+
+// c6502_reverse_free() Free checkpoints and events, restore io handlers and remove write hook.
+void c6502_reverse_free()
+{
+    if (!checkpoints)
+    {
+        return;
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        if (saved_io[page].read)
+        {
+            bus_map_io(page, saved_io[page].read, saved_io[page].write, saved_io[page].ctx);
+        }
+    }
+    memset(saved_io, 0, sizeof(saved_io));
+    bus_remove_write_hook(reverse_write, NULL);
+
+    for (int i = 0; i < checkpoint_count; i++)
+    {
+        free(checkpoints[i].state);
+    }
+    free(checkpoints);
+    free(events);
+    checkpoints = NULL;
+    checkpoint_count = 0;
+    events = NULL;
+    event_count = 0;
+    event_capacity = 0;
+}
+
+// c6502_reverse_step() Feed logged interrupts when re-executing, run one instruction, checkpoint.
+void c6502_reverse_step()
+{
+    if (reverse_replaying())
+    {
+        while (cursor < event_count && events[cursor].position == position &&
+               events[cursor].type != REVERSE_IO_READ)
+        {
+            if (events[cursor++].type == REVERSE_IRQ)
+            {
+                c6502_irq();
+            }
+            else
+            {
+                c6502_nmi();
+            }
+        }
+    }
+
+    c6502_step();
+    position++;
+
+    if (position > frontier)
+    {
+        frontier = position;
+        cursor = event_count;
+        if (position % spacing == 0)
+        {
+            reverse_checkpoint_save();
+        }
+    }
+}
+
+// Log an interrupt raised by the host. An interrupt at an earlier position replaces the logged future.
+static void reverse_interrupt(reverse_event_type type)
+{
+    if (reverse_replaying())
+    {
+        reverse_truncate();
+    }
+    reverse_log(type, 0, 0);
+    cursor = event_count;
+}
+
+// c6502_reverse_irq() Log and raise IRQ.
+void c6502_reverse_irq()
+{
+    reverse_interrupt(REVERSE_IRQ);
+    c6502_irq();
+}
+
+// c6502_reverse_nmi() Log and raise NMI.
+void c6502_reverse_nmi()
+{
+    reverse_interrupt(REVERSE_NMI);
+    c6502_nmi();
+}
+
+// c6502_reverse_position() Position of the next instruction.
+uint64_t c6502_reverse_position()
+{
+    return position;
+}
+
+// Return the index of the latest checkpoint at or before target.
+static int reverse_find_checkpoint(uint64_t target)
+{
+    int i = checkpoint_count - 1;
+    while (i > 0 && checkpoints[i].position > target)
+    {
+        i--;
+    }
+    return i;
+}
+
+// Load the latest checkpoint at or before target. Return its index.
+static int reverse_load_checkpoint(uint64_t target)
+{
+    int i = reverse_find_checkpoint(target);
+    c6502_state_load(checkpoints[i].state, state_size);
+    position = checkpoints[i].position;
+    cursor = checkpoints[i].event_index;
+    return i;
+}
+
+// c6502_reverse_goto() Load nearest checkpoint and run forward to target.
+bool c6502_reverse_goto(uint64_t target)
+{
+    if (!checkpoints)
+    {
+        return false;
+    }
+    // Jump to a checkpoint when going back, or when one is closer than the current position.
+    if (target < position || checkpoints[reverse_find_checkpoint(target)].position > position)
+    {
+        reverse_load_checkpoint(target);
+    }
+    while (position < target)
+    {
+        c6502_reverse_step();
+    }
+    return true;
+}
+
+// c6502_reverse_step_back() Go to the previous position.
+bool c6502_reverse_step_back()
+{
+    if (position == 0)
+    {
+        return false;
+    }
+    return c6502_reverse_goto(position - 1);
+}
+
+// Return true if pc is one of the breakpoints.
+static bool reverse_breakpoint(const uint16_t *breakpoints, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (c6502.PC == breakpoints[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+c6502_reverse_continue() Search checkpoint segments from the newest one backwards.
+Each segment is re-executed once, remembering the last hit. The first segment with a hit holds
+the answer.
+*/
+bool c6502_reverse_continue(const uint16_t *breakpoints, int breakpoint_count,
+                            const uint16_t *watchpoints, int watchpoint_count)
+{
+    uint64_t start = position;
+
+    if (!checkpoints || position == 0 ||
+        breakpoint_count > C6502_REVERSE_MAX_POINTS || watchpoint_count > C6502_REVERSE_MAX_POINTS)
+    {
+        return false;
+    }
+
+    int segment = reverse_load_checkpoint(start - 1);
+    for (;;)
+    {
+        uint64_t end = (segment + 1 < checkpoint_count) ? checkpoints[segment + 1].position : start;
+        bool found = false;
+        uint64_t hit = 0;
+
+        if (end > start)
+        {
+            end = start;
+        }
+
+        watch = watchpoints;
+        watch_count = watchpoint_count;
+        while (position < end)
+        {
+            uint64_t current = position;
+            watch_hit = false;
+            if (reverse_breakpoint(breakpoints, breakpoint_count))
+            {
+                found = true;
+                hit = current;
+            }
+            c6502_reverse_step();
+            if (watch_hit)
+            {
+                found = true;
+                hit = current;
+            }
+        }
+        watch_count = 0;
+
+        if (found)
+        {
+            return c6502_reverse_goto(hit);
+        }
+        if (segment == 0)
+        {
+            c6502_reverse_goto(start);
+            return false;
+        }
+        segment--;
+        reverse_load_checkpoint(checkpoints[segment].position);
+    }
+}
+
+// c6502_reverse_last_write() Reverse continue with one watchpoint.
+bool c6502_reverse_last_write(uint16_t address)
+{
+    return c6502_reverse_continue(NULL, 0, &address, 1);
+}
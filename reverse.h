@@ -0,0 +1,75 @@
+// reverse.h
+
+#ifndef REVERSE_H
+#define REVERSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Reverse execution.
+
+Run the machine with c6502_reverse_step() instead of c6502_step(), and raise interrupts with
+c6502_reverse_irq() / c6502_reverse_nmi(). Every instruction gets a position number. A save state
+checkpoint is kept every spacing instructions, and interrupts plus io read values are logged with
+the position they happened at. Moving to an earlier position loads the nearest checkpoint before
+it and re-executes forward, feeding the logged inputs back in, so the re-run is exact.
+
+A move back costs at most spacing re-executed instructions per checkpoint segment searched.
+When max_checkpoints is reached every second checkpoint is dropped and the spacing doubles.
+The defaults below keep a step back around a millisecond for the interpreter at -O2.
+
+After moving back, c6502_reverse_step() re-executes the logged future. Raising an interrupt at
+an earlier position discards the logged future and recording continues from there.
+
+Checkpoints load ADDRESS directly. Callers using the disassembly cache should call
+c6502_disasm_invalidate_all() after moving back.
+*/
+
+#define C6502_REVERSE_SPACING 20000
+#define C6502_REVERSE_CHECKPOINTS 256
+
+// Maximum number of breakpoints and watchpoints for c6502_reverse_continue().
+#define C6502_REVERSE_MAX_POINTS 16
+
+/*
+Start recording at position 0 with a checkpoint of the current machine.
+Wraps the handlers of pages mapped with bus_map_io(), so map devices first.
+Return false if memory can not be allocated or no bus write hook is free.
+*/
+bool c6502_reverse_init(uint64_t spacing, int max_checkpoints);
+
+// Free checkpoints and logs, restore io handlers.
+void c6502_reverse_free();
+
+// Run one instruction.
+void c6502_reverse_step();
+
+// Raise and log IRQ.
+void c6502_reverse_irq();
+
+// Raise and log NMI.
+void c6502_reverse_nmi();
+
+// Position of the next instruction to run.
+uint64_t c6502_reverse_position();
+
+// Move to position. Positions after the recorded future are reached by running forward.
+bool c6502_reverse_goto(uint64_t position);
+
+// Undo the last instruction. Return false at position 0.
+bool c6502_reverse_step_back();
+
+/*
+Run backwards to the latest earlier position where the PC is one of the breakpoints, or where
+the instruction writes one of the watchpoint addresses. The machine stops before that instruction.
+Return false and stay put if there is no such position.
+*/
+bool c6502_reverse_continue(const uint16_t *breakpoints, int breakpoint_count,
+                            const uint16_t *watchpoints, int watchpoint_count);
+
+// Run backwards to the instruction that last wrote address. Return false if none did.
+bool c6502_reverse_last_write(uint16_t address);
+
+#endif
@@ -0,0 +1,311 @@
+/*
+rewind.c
+Ring of snapshots stored as XOR/RLE deltas of the pages written between snapshots.
+See rewind.h for the delta format.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "rewind.h"
+
+/*
+Worst case encoded page: page number, then changed and unchanged bytes alternating, which takes
+256 one byte tokens and 128 literal bytes. Every other pattern encodes shorter.
+*/
+#define REWIND_PAGE_MAX (1 + 256 + 128)
+
+typedef struct
+{
+    c6502_cpu cpu;
+    uint8_t databus;
+    uint8_t *delta; // XOR against the previous snapshot, NULL for the oldest snapshot
+    size_t size;    // Bytes in delta
+} rewind_snapshot;
+
+// Snapshots in a ring, oldest at head.
+static rewind_snapshot *snapshots = NULL;
+static int capacity = 0;
+static int head = 0;
+static int count = 0;
+
+// Memory at the newest snapshot.
+static uint8_t *ref = NULL;
+// Encoding scratch buffer large enough for all 256 pages.
+static uint8_t *scratch = NULL;
+
+static uint32_t epoch = 0;
+static uint64_t interval = 0;
+static uint64_t last_cycles = 0;
+static size_t budget = 0;
+static size_t used = 0;
+
+static rewind_snapshot *rewind_at(int i)
+{
+    return &snapshots[(head + i) % capacity];
+}
+
+// Encode the XOR of one page. Return bytes written, 0 if the page did not change.
+static size_t rewind_encode_page(uint8_t page, const uint8_t *old, const uint8_t *new, uint8_t *out)
+{
+    uint8_t diff[256];
+    bool changed = false;
+    size_t n = 0;
+    int i = 0;
+
+    for (int k = 0; k < 256; k++)
+    {
+        diff[k] = old[k] ^ new[k];
+        changed |= diff[k] != 0;
+    }
+    if (!changed)
+    {
+        return 0;
+    }
+
+    out[n++] = page;
+    while (i < 256)
+    {
+        int run = 0;
+        if (diff[i] == 0)
+        {
+            while (i + run < 256 && run < 128 && diff[i + run] == 0)
+            {
+                run++;
+            }
+            out[n++] = run - 1;
+        }
+        else
+        {
+            while (i + run < 256 && run < 128 && diff[i + run] != 0)
+            {
+                run++;
+            }
+            out[n++] = 0x7F + run;
+            memcpy(&out[n], &diff[i], run);
+            n += run;
+        }
+        i += run;
+    }
+    return n;
+}
+
+/*
+XOR a delta into ref and copy every page it touches to ADDRESS.
+Touched pages are marked dirty for other bus epoch users.
+*/
+static void rewind_apply(const uint8_t *delta, size_t size)
+{
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        uint8_t page = delta[pos++];
+        uint8_t *mem = &ref[page << 8];
+        int i = 0;
+
+        while (i < 256)
+        {
+            uint8_t token = delta[pos++];
+            if (token < 0x80)
+            {
+                i += token + 1;
+            }
+            else
+            {
+                for (int k = 0; k < token - 0x7F; k++)
+                {
+                    mem[i++] ^= delta[pos++];
+                }
+            }
+        }
+        memcpy(&ADDRESS[page << 8], mem, 256);
+        bus_touch_page(page);
+    }
+}
+
+// Drop the oldest snapshot. The next one becomes the base and no longer needs its delta.
+static void rewind_drop_oldest(void)
+{
+    rewind_snapshot *next = rewind_at(1);
+
+    used -= next->size + sizeof(rewind_snapshot);
+    free(next->delta);
+    next->delta = NULL;
+    next->size = 0;
+    head = (head + 1) % capacity;
+    count--;
+}
+
+// Make room for one more snapshot.
+static bool rewind_grow(void)
+{
+    int new_capacity = capacity ? capacity * 2 : 64;
+    rewind_snapshot *grown = malloc(new_capacity * sizeof(rewind_snapshot));
+
+    if (!grown)
+    {
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        grown[i] = *rewind_at(i);
+    }
+    free(snapshots);
+    snapshots = grown;
+    capacity = new_capacity;
+    head = 0;
+    return true;
+}
+
+// c6502_rewind_init() Allocate buffers and take the first snapshot.
+bool c6502_rewind_init(uint64_t snapshot_interval, size_t memory_budget)
+{
+    c6502_rewind_free();
+
+    ref = malloc(sizeof(ADDRESS));
+    scratch = malloc(256 * REWIND_PAGE_MAX);
+    if (!ref || !scratch)
+    {
+        c6502_rewind_free();
+        return false;
+    }
+    interval = snapshot_interval;
+    budget = memory_budget;
+    return c6502_rewind_snapshot();
+}
+
+// c6502_rewind_free() Free all snapshots.
+void c6502_rewind_free(void)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(rewind_at(i)->delta);
+    }
+    free(snapshots);
+    free(ref);
+    free(scratch);
+    snapshots = NULL;
+    ref = NULL;
+    scratch = NULL;
+    capacity = 0;
+    head = 0;
+    count = 0;
+    used = 0;
+}
+
+// c6502_rewind_tick() Snapshot every interval cycles.
+void c6502_rewind_tick(void)
+{
+    if (interval && c6502.cycles - last_cycles >= interval)
+    {
+        c6502_rewind_snapshot();
+    }
+}
+
+// c6502_rewind_snapshot() Encode pages written since the newest snapshot and push a new one.
+bool c6502_rewind_snapshot(void)
+{
+    size_t size = 0;
+    uint8_t *delta = NULL;
+
+    if (!ref || (count == capacity && !rewind_grow()))
+    {
+        return false;
+    }
+
+    if (count == 0)
+    {
+        memcpy(ref, ADDRESS, sizeof(ADDRESS));
+    }
+    else
+    {
+        for (int page = 0; page < 256; page++)
+        {
+            if (bus_page_dirty(page, epoch))
+            {
+                size += rewind_encode_page(page, &ref[page << 8], &ADDRESS[page << 8], &scratch[size]);
+                memcpy(&ref[page << 8], &ADDRESS[page << 8], 256);
+            }
+        }
+        if (size > 0)
+        {
+            delta = malloc(size);
+            if (!delta)
+            {
+                return false;
+            }
+            memcpy(delta, scratch, size);
+        }
+    }
+
+    rewind_snapshot *snapshot = rewind_at(count);
+    snapshot->cpu = c6502;
+    snapshot->databus = DATABUS;
+    snapshot->delta = delta;
+    snapshot->size = size;
+    count++;
+    used += size + sizeof(rewind_snapshot);
+
+    while (used > budget && count > 1)
+    {
+        rewind_drop_oldest();
+    }
+
+    epoch = bus_new_epoch();
+    last_cycles = c6502.cycles;
+    return true;
+}
+
+// c6502_rewind_step_back() Restore newest snapshot, or the one before if nothing ran since.
+bool c6502_rewind_step_back(void)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+
+    rewind_snapshot *newest = rewind_at(count - 1);
+    bool dirty = false;
+
+    // Undo writes made since the newest snapshot.
+    for (int page = 0; page < 256; page++)
+    {
+        if (bus_page_dirty(page, epoch))
+        {
+            memcpy(&ADDRESS[page << 8], &ref[page << 8], 256);
+            bus_touch_page(page);
+            dirty = true;
+        }
+    }
+
+    if (!dirty && c6502.cycles == newest->cpu.cycles)
+    {
+        if (count == 1)
+        {
+            return false;
+        }
+        rewind_apply(newest->delta, newest->size);
+        used -= newest->size + sizeof(rewind_snapshot);
+        free(newest->delta);
+        count--;
+        newest = rewind_at(count - 1);
+    }
+
+    c6502 = newest->cpu;
+    DATABUS = newest->databus;
+    epoch = bus_new_epoch();
+    last_cycles = c6502.cycles;
+    return true;
+}
+
+// c6502_rewind_count() Number of snapshots.
+int c6502_rewind_count(void)
+{
+    return count;
+}
+
+// c6502_rewind_used() Delta bytes plus snapshot headers held.
+size_t c6502_rewind_used(void)
+{
+    return used;
+}
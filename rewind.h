@@ -0,0 +1,59 @@
+// rewind.h
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Rewind buffer.
+
+Snapshots are taken every interval cycles by c6502_rewind_tick(), or on demand (for example once
+per frame) with c6502_rewind_snapshot(). The buffer keeps one full copy of memory at the newest
+snapshot. Every snapshot after the oldest one stores the cpu registers plus a delta: for each
+page written since the previous snapshot (bus dirty page tracking), the XOR of the old and new
+page contents, run length encoded. Unchanged bytes XOR to zero, so a delta costs little more
+than the bytes that actually changed.
+
+Stepping back XORs the newest delta into the memory copy, which turns it into the previous
+snapshot. When the deltas exceed the memory budget the oldest snapshots are dropped.
+
+Delta format, per dirty page:  page number, then tokens until 256 bytes are covered
+    0x00-0x7F  skip (token + 1) unchanged bytes
+    0x80-0xFF  (token - 0x7F) literal XOR bytes follow
+*/
+
+/*
+Start rewind buffer and take the first snapshot.
+interval  cycles between snapshots taken by c6502_rewind_tick(), 0 to only snapshot on demand.
+budget    maximum bytes of delta data kept.
+Return false if memory can not be allocated.
+*/
+bool c6502_rewind_init(uint64_t interval, size_t budget);
+
+// Free rewind buffer.
+void c6502_rewind_free(void);
+
+// Take a snapshot if interval cycles have passed since the last one. Call after each instruction.
+void c6502_rewind_tick(void);
+
+// Take a snapshot now. Return false if memory can not be allocated.
+bool c6502_rewind_snapshot(void);
+
+/*
+Restore the machine to the newest snapshot that is older than its current state.
+If nothing ran since the newest snapshot, that snapshot is dropped and the one before it is restored.
+Return false if there is no older snapshot.
+*/
+bool c6502_rewind_step_back(void);
+
+// Number of snapshots held.
+int c6502_rewind_count(void);
+
+// Bytes of delta data held.
+size_t c6502_rewind_used(void);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+run.c
+c6502-run loads a program image and runs it until it traps.
+
+Functional test images signal their result by looping on one instruction forever: a JMP to
+itself or a branch to itself. The runner stops at the first instruction that leaves the PC
+unchanged and reports the trap PC. With -s the trap passes if it is at the success address,
+any other trap fails.
+
+c6502-run-nmos and c6502-run-65c02 are the same runner built for the other cpu variants, for
+example for the decimal mode and 65C02 extended opcode test images.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "c6502.h"
+#include "loader.h"
+
+static void usage(void)
+{
+    printf("Usage: c6502-run [-b base] [-p pc] [-s success] [-c cycles] image\n");
+    printf("  -b base     hex load address of raw binaries, default 0000\n");
+    printf("  -p pc       hex start address, default the reset vector of the image\n");
+    printf("  -s success  hex trap address that means the test passed\n");
+    printf("  -c cycles   stop after this many cycles, default no limit\n");
+    printf("Images: .nes iNES, .hex/.ihx Intel HEX, .prg C64, .xex Atari, anything else raw.\n");
+    printf("Cpu: %s\n", C6502_VARIANT_NAME);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    uint16_t base = 0x0000;
+    long start = -1;
+    long success = -1;
+    uint64_t limit = 0;
+    uint64_t instructions = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-b") == 0)
+        {
+            base = (uint16_t)strtoul(argv[++i], NULL, 16);
+        }
+        else if (has_value && strcmp(argv[i], "-p") == 0)
+        {
+            start = strtol(argv[++i], NULL, 16) & 0xFFFF;
+        }
+        else if (has_value && strcmp(argv[i], "-s") == 0)
+        {
+            success = strtol(argv[++i], NULL, 16) & 0xFFFF;
+        }
+        else if (has_value && strcmp(argv[i], "-c") == 0)
+        {
+            limit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (!path && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (!path)
+    {
+        usage();
+        return 1;
+    }
+
+    if (!c6502_load_file(path, base))
+    {
+        return 1;
+    }
+    if (start < 0)
+    {
+        start = ADDRESS[0xFFFC] | ADDRESS[0xFFFD] << 8;
+    }
+    // c6502_init() writes the start address into the reset vector, keep the image's own vector.
+    uint8_t vector[2] = {ADDRESS[0xFFFC], ADDRESS[0xFFFD]};
+    c6502_init(start >> 8, start & 0xFF);
+    ADDRESS[0xFFFC] = vector[0];
+    ADDRESS[0xFFFD] = vector[1];
+
+    for (;;)
+    {
+        uint16_t pc = c6502.PC;
+
+        c6502_step();
+        instructions++;
+        if (c6502.JAM)
+        {
+            printf("jam at $%04X after %llu instructions, %llu cycles\n", pc,
+                   (unsigned long long)instructions, (unsigned long long)c6502.cycles);
+            return 1;
+        }
+        if (c6502.PC == pc)
+        {
+            break;
+        }
+        if (limit && c6502.cycles >= limit)
+        {
+            printf("cycle limit reached at $%04X after %llu instructions, %llu cycles\n", c6502.PC,
+                   (unsigned long long)instructions, (unsigned long long)c6502.cycles);
+            return 1;
+        }
+    }
+
+    bool pass = (success < 0 || c6502.PC == success);
+    printf("trap at $%04X after %llu instructions, %llu cycles", c6502.PC,
+           (unsigned long long)instructions, (unsigned long long)c6502.cycles);
+    if (success >= 0)
+    {
+        printf(": %s", pass ? "pass" : "fail");
+    }
+    printf("\n");
+    return pass ? 0 : 1;
+}
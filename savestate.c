@@ -0,0 +1,194 @@
+/*
+savestate.c
+Versioned, section tagged binary save states. See savestate.h for the format.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "savestate.h"
+
+#define STATE_HEADER_SIZE 12
+#define STATE_SECTION_HEADER_SIZE 8
+#define STATE_SECTION_COUNT 3
+
+static const uint8_t state_magic[4] = {'C', '6', 'S', 'S'};
+
+// Section table: tag, address and size of the state it holds.
+typedef struct
+{
+    char tag[4];
+    void *data;
+    uint32_t size;
+} state_section;
+
+static void state_sections(state_section sections[STATE_SECTION_COUNT])
+{
+    sections[0] = (state_section){{'C', 'P', 'U', ' '}, &c6502, sizeof(c6502)};
+    sections[1] = (state_section){{'B', 'U', 'S', ' '}, &DATABUS, sizeof(DATABUS)};
+    sections[2] = (state_section){{'R', 'A', 'M', ' '}, ADDRESS, sizeof(ADDRESS)};
+}
+
+// c6502_state_size() Header plus all sections.
+size_t c6502_state_size(void)
+{
+    state_section sections[STATE_SECTION_COUNT];
+    size_t size = STATE_HEADER_SIZE;
+
+    state_sections(sections);
+    for (int i = 0; i < STATE_SECTION_COUNT; i++)
+    {
+        size += STATE_SECTION_HEADER_SIZE + sections[i].size;
+    }
+    return size;
+}
+
+// c6502_state_save() Write header and sections.
+size_t c6502_state_save(uint8_t *buf, size_t size)
+{
+    state_section sections[STATE_SECTION_COUNT];
+    uint16_t version = C6502_STATE_VERSION;
+    uint16_t byte_order = 0x0102;
+    uint32_t count = STATE_SECTION_COUNT;
+    size_t pos = 0;
+
+    if (size < c6502_state_size())
+    {
+        return 0;
+    }
+
+    memcpy(&buf[pos], state_magic, 4);
+    memcpy(&buf[pos + 4], &version, 2);
+    memcpy(&buf[pos + 6], &byte_order, 2);
+    memcpy(&buf[pos + 8], &count, 4);
+    pos += STATE_HEADER_SIZE;
+
+    state_sections(sections);
+    for (int i = 0; i < STATE_SECTION_COUNT; i++)
+    {
+        memcpy(&buf[pos], sections[i].tag, 4);
+        memcpy(&buf[pos + 4], &sections[i].size, 4);
+        memcpy(&buf[pos + STATE_SECTION_HEADER_SIZE], sections[i].data, sections[i].size);
+        pos += STATE_SECTION_HEADER_SIZE + sections[i].size;
+    }
+    return pos;
+}
+
+/*
+c6502_state_load() Check header, then copy every known section.
+All sections are validated before any state is changed, so a bad state leaves the machine untouched.
+*/
+bool c6502_state_load(const uint8_t *buf, size_t size)
+{
+    state_section sections[STATE_SECTION_COUNT];
+    const uint8_t *found[STATE_SECTION_COUNT] = {NULL};
+    uint16_t version = 0;
+    uint16_t byte_order = 0;
+    uint32_t count = 0;
+    size_t pos = STATE_HEADER_SIZE;
+
+    if (size < STATE_HEADER_SIZE || memcmp(buf, state_magic, 4) != 0)
+    {
+        return false;
+    }
+    memcpy(&version, &buf[4], 2);
+    memcpy(&byte_order, &buf[6], 2);
+    memcpy(&count, &buf[8], 4);
+    if (version != C6502_STATE_VERSION || byte_order != 0x0102)
+    {
+        return false;
+    }
+
+    state_sections(sections);
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t section_size = 0;
+
+        if (size - pos < STATE_SECTION_HEADER_SIZE)
+        {
+            return false;
+        }
+        memcpy(&section_size, &buf[pos + 4], 4);
+        if (size - pos - STATE_SECTION_HEADER_SIZE < section_size)
+        {
+            return false;
+        }
+        for (int i = 0; i < STATE_SECTION_COUNT; i++)
+        {
+            if (memcmp(&buf[pos], sections[i].tag, 4) == 0)
+            {
+                if (section_size != sections[i].size)
+                {
+                    return false;
+                }
+                found[i] = &buf[pos + STATE_SECTION_HEADER_SIZE];
+            }
+        }
+        pos += STATE_SECTION_HEADER_SIZE + section_size;
+    }
+
+    for (int i = 0; i < STATE_SECTION_COUNT; i++)
+    {
+        if (!found[i])
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < STATE_SECTION_COUNT; i++)
+    {
+        memcpy(sections[i].data, found[i], sections[i].size);
+    }
+    // Memory was replaced without cpu_write(), mark every page dirty for epoch users.
+    for (int page = 0; page < 256; page++)
+    {
+        bus_touch_page(page);
+    }
+    return true;
+}
+
+// c6502_state_save_file() Save state into a buffer and write it with one fwrite.
+bool c6502_state_save_file(const char *path)
+{
+    size_t size = c6502_state_size();
+    uint8_t *buf = malloc(size);
+    bool ok = false;
+
+    if (!buf)
+    {
+        return false;
+    }
+    c6502_state_save(buf, size);
+
+    FILE *fp = fopen(path, "wb");
+    if (fp)
+    {
+        ok = fwrite(buf, size, 1, fp) == 1;
+        ok &= fclose(fp) == 0;
+    }
+    free(buf);
+    return ok;
+}
+
+// c6502_state_load_file() Read whole file and load it.
+bool c6502_state_load_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    bool ok = false;
+
+    if (!fp)
+    {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    uint8_t *buf = (size > 0) ? malloc(size) : NULL;
+    if (buf && fread(buf, size, 1, fp) == 1)
+    {
+        ok = c6502_state_load(buf, size);
+    }
+    free(buf);
+    fclose(fp);
+    return ok;
+}
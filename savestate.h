@@ -0,0 +1,52 @@
+// savestate.h
+
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Binary save states.
+
+A save state is a header followed by tagged sections:
+
+    header   "C6SS", uint16 version, uint16 byte order mark 0x0102, uint32 section count
+    section  4 byte tag, uint32 payload size, payload
+
+Sections written by version 2 (version 1 had a 16 bit cycle counter):
+
+    "CPU "   c6502_cpu struct
+    "BUS "   DATABUS
+    "RAM "   ADDRESS, the full 64KB address space
+
+Values are stored in host byte order, so a state only loads on a host with the same
+byte order. Each section is a single memcpy. Unknown sections are skipped on load so newer
+writers can add sections without breaking older readers; a change to the layout of an
+existing section needs a new version number.
+
+Loading writes ADDRESS directly and bypasses bus write hooks, but marks every page dirty for bus
+epoch users. Callers that use the disassembly cache should call c6502_disasm_invalidate_all()
+after a load.
+*/
+
+#define C6502_STATE_VERSION 2
+
+// Return the size in bytes of a save state of the current machine.
+size_t c6502_state_size(void);
+
+// Save state into buf. Return bytes written, or 0 if buf is too small.
+size_t c6502_state_save(uint8_t *buf, size_t size);
+
+// Load state from buf. Return false if the state is malformed or from another version.
+bool c6502_state_load(const uint8_t *buf, size_t size);
+
+// Save state to file. Return false if the file can not be written.
+bool c6502_state_save_file(const char *path);
+
+// Load state from file. Return false if the file can not be read or is not a valid state.
+bool c6502_state_load_file(const char *path);
+
+#endif
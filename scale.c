@@ -0,0 +1,246 @@
+/*
+scale.c
+c6502-scale measures how emulation throughput scales with cores.
+
+For 1, 2, 4 ... up to N threads, every thread runs its own machine, pinned to its own cpu, for a
+fixed time. Each machine runs either nestest.nes over and over (reset to a baseline between
+runs) or a small synthetic loop. Per thread and aggregate emulated MIPS and MHz are reported,
+plus the scaling efficiency: aggregate rate divided by the thread count times the one thread
+rate. Efficiency well below 1.0 on idle cores points at shared state or false sharing.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "c6502.h"
+#include "loader.h"
+#include "baseline.h"
+
+// Instructions per nestest run, as in main.c.
+#define SCALE_NESTEST_STEPS 8991
+// Instructions between checks of the stop flag in the synthetic loop.
+#define SCALE_CHUNK 10000
+
+typedef enum
+{
+    SCALE_NESTEST,
+    SCALE_SYNTHETIC,
+} scale_workload;
+
+// Per thread counters, each on its own cache line.
+typedef struct
+{
+    _Alignas(64) pthread_t thread;
+    int cpu;
+    uint64_t instructions;
+    uint64_t cycles;
+} scale_worker;
+
+static scale_workload workload = SCALE_NESTEST;
+static uint8_t *rom = NULL;
+static size_t rom_size = 0;
+static pthread_barrier_t start_barrier;
+static atomic_bool stop = false;
+
+// Load the workload into this thread's machine.
+static void scale_setup(void)
+{
+    // LDX #0; LDA $0300,X; ADC #1; STA $0300,X; INX; BNE $0202; JMP $0200
+    static const uint8_t synthetic[] = {0xA2, 0x00, 0xBD, 0x00, 0x03, 0x69, 0x01, 0x9D, 0x00,
+                                        0x03, 0xE8, 0xD0, 0xF5, 0x4C, 0x00, 0x02};
+
+    memset(ADDRESS, 0, sizeof(ADDRESS));
+    if (workload == SCALE_NESTEST)
+    {
+        c6502_init(0xC0, 0x00);
+        c6502_load_ines_image(rom, rom_size);
+    }
+    else
+    {
+        c6502_init(0x02, 0x00);
+        memcpy(&ADDRESS[0x0200], synthetic, sizeof(synthetic));
+    }
+}
+
+static void *scale_worker_main(void *arg)
+{
+    scale_worker *worker = arg;
+    c6502_baseline *baseline = malloc(sizeof(c6502_baseline));
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(worker->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    scale_setup();
+    if (baseline)
+    {
+        c6502_baseline_capture(baseline);
+    }
+    pthread_barrier_wait(&start_barrier);
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed))
+    {
+        uint64_t start = c6502.cycles;
+        int steps = SCALE_CHUNK;
+
+        if (workload == SCALE_NESTEST && baseline)
+        {
+            c6502_baseline_reset(baseline);
+            start = c6502.cycles;
+            steps = SCALE_NESTEST_STEPS;
+        }
+        for (int i = 0; i < steps; i++)
+        {
+            c6502_step();
+        }
+        worker->instructions += steps;
+        worker->cycles += c6502.cycles - start;
+    }
+    free(baseline);
+    return NULL;
+}
+
+static double scale_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+Run count threads for seconds. Print one result line, and one line per thread if verbose.
+Return the aggregate MIPS.
+*/
+static double scale_run(int count, int cpus, double seconds, double single, bool verbose)
+{
+    scale_worker *workers = aligned_alloc(64, count * sizeof(scale_worker));
+    double min = 0, max = 0, total = 0, mhz = 0;
+
+    if (!workers)
+    {
+        return 0;
+    }
+    memset(workers, 0, count * sizeof(scale_worker));
+    atomic_store(&stop, false);
+    pthread_barrier_init(&start_barrier, NULL, count + 1);
+    for (int i = 0; i < count; i++)
+    {
+        workers[i].cpu = i % cpus;
+        pthread_create(&workers[i].thread, NULL, scale_worker_main, &workers[i]);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    double begin = scale_now();
+    usleep((useconds_t)(seconds * 1e6));
+    atomic_store(&stop, true);
+    for (int i = 0; i < count; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+    double elapsed = scale_now() - begin;
+    pthread_barrier_destroy(&start_barrier);
+
+    for (int i = 0; i < count; i++)
+    {
+        double mips = workers[i].instructions / elapsed / 1e6;
+        min = (i == 0 || mips < min) ? mips : min;
+        max = (mips > max) ? mips : max;
+        total += mips;
+        mhz += workers[i].cycles / elapsed / 1e6;
+        if (verbose)
+        {
+            printf("        thread %3d cpu %3d %10.2f MIPS %10.2f MHz\n", i, workers[i].cpu, mips,
+                   workers[i].cycles / elapsed / 1e6);
+        }
+    }
+    double efficiency = single > 0 ? total / (count * single) : 1.0;
+    printf("%7d %10.2f %10.2f %12.2f %12.2f %10.2f\n", count, min, max, total, mhz, efficiency);
+    free(workers);
+    return total;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-scale [-t threads] [-d seconds] [-w nestest|synthetic] [-v]\n");
+    printf("  -t threads  largest thread count, default one per online cpu\n");
+    printf("  -d seconds  run time per thread count, default 1\n");
+    printf("  -w workload nestest.nes in a loop (default) or a synthetic memory loop\n");
+    printf("  -v          print every thread\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus;
+    double seconds = 1.0;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (has_value && strcmp(argv[i], "-t") == 0)
+        {
+            max_threads = atoi(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-d") == 0)
+        {
+            seconds = atof(argv[++i]);
+        }
+        else if (has_value && strcmp(argv[i], "-w") == 0 && strcmp(argv[i + 1], "nestest") == 0)
+        {
+            workload = SCALE_NESTEST;
+            i++;
+        }
+        else if (has_value && strcmp(argv[i], "-w") == 0 && strcmp(argv[i + 1], "synthetic") == 0)
+        {
+            workload = SCALE_SYNTHETIC;
+            i++;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (max_threads < 1 || seconds <= 0)
+    {
+        usage();
+        return 1;
+    }
+    if (workload == SCALE_NESTEST)
+    {
+        rom = c6502_read_file("nestest.nes", &rom_size);
+        if (!rom)
+        {
+            printf("Rom file nestest.nes does not exist\n");
+            return 1;
+        }
+    }
+
+    printf("%d online cpus, %s workload, %.1f s per run\n", cpus,
+           workload == SCALE_NESTEST ? "nestest" : "synthetic", seconds);
+    printf("threads   min MIPS   max MIPS   total MIPS    total MHz efficiency\n");
+
+    double single = 0;
+    for (int count = 1; count <= max_threads; count = (count * 2 > max_threads && count < max_threads) ? max_threads : count * 2)
+    {
+        double total = scale_run(count, cpus, seconds, single, verbose);
+        if (count == 1)
+        {
+            single = total;
+        }
+    }
+    free(rom);
+    return 0;
+}
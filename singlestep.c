@@ -0,0 +1,687 @@
+/*
+singlestep.c
+c6502-single runs single instruction test vectors in the common JSON format, one file per opcode:
+
+    [{"name": "a9 3c 1f",
+      "initial": {"pc": 1234, "s": 253, "a": 0, "x": 0, "y": 0, "p": 36, "ram": [[1234, 169], [1235, 60]]},
+      "final":   {"pc": 1236, "s": 253, "a": 60, "x": 0, "y": 0, "p": 36, "ram": [[1234, 169], [1235, 60]]},
+      "cycles":  [[1234, 169, "read"], [1235, 60, "read"]]}, ...]
+
+For every test the initial state is loaded, one instruction runs, and three things are checked:
+state   registers and every final ram byte
+cycles  c6502.cycles added by the instruction equals the number of bus cycles listed
+bus     the reads and writes made by the instruction equal the bus log: same count, and the same
+        address, value and direction at every position
+
+The bus accesses are recorded by a read handler mapped over every page and a write hook. The core
+does not make the dummy reads of a real 6502 (the byte after a one byte opcode, the wrong page
+before an indexed page crossing, the stack before a pull) or the dummy write of read-modify-write
+instructions, so those instructions pass the state and cycles checks and fail the bus check.
+
+Files are read through a small streaming JSON reader with a fixed buffer and fixed size test
+records, so nothing is allocated per test. Files are spread over worker threads. The summary
+has one line per opcode with its lookup_table name, so illegal opcodes show up with their '*'.
+
+c6502-single-nmos and c6502-single-65c02 are the same runner built for the other cpu variants.
+*/
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "c6502.h"
+
+#ifdef C6502_UNTIMED
+#error "c6502-single checks instruction cycles and needs a timed build"
+#endif
+
+#define SINGLE_MAX_RAM 64
+#define SINGLE_MAX_CYCLES 64
+#define SINGLE_MAX_FILES 4096
+#define SINGLE_BUFFER 65536
+
+typedef struct
+{
+    FILE *fp;
+    uint8_t buf[SINGLE_BUFFER];
+    size_t pos;
+    size_t len;
+    bool error;
+} json_reader;
+
+typedef struct
+{
+    uint16_t pc;
+    uint8_t s, a, x, y, p;
+    int ram_count;
+    uint16_t ram_address[SINGLE_MAX_RAM];
+    uint8_t ram_value[SINGLE_MAX_RAM];
+} single_state;
+
+typedef struct
+{
+    char name[64];
+    single_state initial;
+    single_state final;
+    int cycle_count;
+    uint16_t cycle_address[SINGLE_MAX_CYCLES];
+    uint8_t cycle_value[SINGLE_MAX_CYCLES];
+    bool cycle_write[SINGLE_MAX_CYCLES];
+} single_test;
+
+typedef struct
+{
+    const char *path;
+    int opcode; // -1 until the first test is read
+    uint64_t tests;
+    uint64_t passed;
+    uint64_t state_failed;
+    uint64_t cycles_failed;
+    uint64_t bus_failed;
+    bool parse_error;
+    char first_failure[160];
+} single_file;
+
+static single_file files[SINGLE_MAX_FILES];
+static int file_count = 0;
+static atomic_int next_file = 0;
+static bool verbose = false;
+
+// Reads and writes made by the running instruction on this thread.
+static C6502_THREAD_LOCAL int bus_log_count = 0;
+static C6502_THREAD_LOCAL uint16_t bus_log_address[SINGLE_MAX_CYCLES];
+static C6502_THREAD_LOCAL uint8_t bus_log_value[SINGLE_MAX_CYCLES];
+static C6502_THREAD_LOCAL bool bus_log_write[SINGLE_MAX_CYCLES];
+
+//----------------------
+// Streaming JSON reader
+//----------------------
+
+static int json_getc(json_reader *r)
+{
+    if (r->pos == r->len)
+    {
+        r->len = fread(r->buf, 1, sizeof(r->buf), r->fp);
+        r->pos = 0;
+        if (r->len == 0)
+        {
+            return EOF;
+        }
+    }
+    return r->buf[r->pos++];
+}
+
+// Return the next character that is not white space without consuming it.
+static int json_peek(json_reader *r)
+{
+    for (;;)
+    {
+        int c = json_getc(r);
+        if (c == EOF)
+        {
+            return EOF;
+        }
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+        {
+            r->pos--;
+            return c;
+        }
+    }
+}
+
+static bool json_expect(json_reader *r, int expected)
+{
+    if (json_peek(r) != expected)
+    {
+        r->error = true;
+        return false;
+    }
+    json_getc(r);
+    return true;
+}
+
+/*
+Call after the opening bracket or brace, and after every element.
+Return true if another element follows. Consumes the separating comma or the closing bracket.
+*/
+static bool json_more(json_reader *r, int close)
+{
+    int c = json_peek(r);
+
+    if (c == ',')
+    {
+        json_getc(r);
+        return true;
+    }
+    if (c == close)
+    {
+        json_getc(r);
+        return false;
+    }
+    if (c == EOF)
+    {
+        r->error = true;
+        return false;
+    }
+    return true;
+}
+
+// Read a non negative integer. Fractions and exponents are skipped.
+static uint32_t json_number(json_reader *r)
+{
+    uint32_t value = 0;
+    int c = json_peek(r);
+
+    if (c < '0' || c > '9')
+    {
+        r->error = true;
+        return 0;
+    }
+    while ((c = json_getc(r)) != EOF)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            value = value * 10 + (c - '0');
+        }
+        else if (c != '.' && c != 'e' && c != 'E' && c != '+' && c != '-')
+        {
+            r->pos--;
+            break;
+        }
+    }
+    return value;
+}
+
+// Read a string into out, truncated to size. Escapes keep the escaped character.
+static void json_string(json_reader *r, char *out, size_t size)
+{
+    size_t n = 0;
+    int c;
+
+    if (!json_expect(r, '"'))
+    {
+        return;
+    }
+    while ((c = json_getc(r)) != EOF && c != '"')
+    {
+        if (c == '\\')
+        {
+            c = json_getc(r);
+        }
+        if (n + 1 < size)
+        {
+            out[n++] = c;
+        }
+    }
+    if (size)
+    {
+        out[n] = '\0';
+    }
+    r->error |= (c == EOF);
+}
+
+// Skip any value.
+static void json_skip(json_reader *r)
+{
+    int c = json_peek(r);
+    char text[8];
+
+    if (c == '"')
+    {
+        json_string(r, text, 0);
+    }
+    else if (c == '[' || c == '{')
+    {
+        int close = (c == '[') ? ']' : '}';
+        json_getc(r);
+        while (!r->error && json_more(r, close))
+        {
+            if (close == '}')
+            {
+                json_string(r, text, 0);
+                json_expect(r, ':');
+            }
+            json_skip(r);
+        }
+    }
+    else
+    {
+        // Numbers, true, false and null.
+        while ((c = json_getc(r)) != EOF && c != ',' && c != ']' && c != '}' && c != ' ' && c != '\n')
+        {
+        }
+        if (c != EOF)
+        {
+            r->pos--;
+        }
+    }
+}
+
+//----------------------
+// Test records
+//----------------------
+
+static void single_read_state(json_reader *r, single_state *state)
+{
+    char key[16];
+
+    state->ram_count = 0;
+    json_expect(r, '{');
+    while (!r->error && json_more(r, '}'))
+    {
+        json_string(r, key, sizeof(key));
+        json_expect(r, ':');
+        if (strcmp(key, "ram") == 0)
+        {
+            json_expect(r, '[');
+            while (!r->error && json_more(r, ']'))
+            {
+                json_expect(r, '[');
+                uint32_t address = json_number(r);
+                json_expect(r, ',');
+                uint32_t value = json_number(r);
+                json_expect(r, ']');
+                if (state->ram_count == SINGLE_MAX_RAM)
+                {
+                    r->error = true;
+                    return;
+                }
+                state->ram_address[state->ram_count] = address;
+                state->ram_value[state->ram_count] = value;
+                state->ram_count++;
+            }
+        }
+        else if (strcmp(key, "pc") == 0)
+        {
+            state->pc = json_number(r);
+        }
+        else if (strlen(key) == 1 && strchr("saxyp", key[0]))
+        {
+            uint8_t value = json_number(r);
+            switch (key[0])
+            {
+            case 's':
+                state->s = value;
+                break;
+            case 'a':
+                state->a = value;
+                break;
+            case 'x':
+                state->x = value;
+                break;
+            case 'y':
+                state->y = value;
+                break;
+            default:
+                state->p = value;
+                break;
+            }
+        }
+        else
+        {
+            json_skip(r);
+        }
+    }
+}
+
+static void single_read_cycles(json_reader *r, single_test *test)
+{
+    char type[8];
+
+    test->cycle_count = 0;
+    json_expect(r, '[');
+    while (!r->error && json_more(r, ']'))
+    {
+        json_expect(r, '[');
+        uint32_t address = json_number(r);
+        json_expect(r, ',');
+        // Some suites use null for the value of cycles without a bus access.
+        uint32_t value = (json_peek(r) == 'n') ? (json_skip(r), 0) : json_number(r);
+        json_expect(r, ',');
+        json_string(r, type, sizeof(type));
+        json_expect(r, ']');
+
+        if (test->cycle_count < SINGLE_MAX_CYCLES)
+        {
+            test->cycle_address[test->cycle_count] = address;
+            test->cycle_value[test->cycle_count] = value;
+            test->cycle_write[test->cycle_count] = strcmp(type, "write") == 0;
+        }
+        test->cycle_count++;
+    }
+}
+
+// Read the next test of the top level array. Return false at the end or on a syntax error.
+static bool single_read_test(json_reader *r, single_test *test)
+{
+    char key[16];
+
+    if (r->error || !json_more(r, ']'))
+    {
+        return false;
+    }
+    test->name[0] = '\0';
+    json_expect(r, '{');
+    while (!r->error && json_more(r, '}'))
+    {
+        json_string(r, key, sizeof(key));
+        json_expect(r, ':');
+        if (strcmp(key, "name") == 0)
+        {
+            json_string(r, test->name, sizeof(test->name));
+        }
+        else if (strcmp(key, "initial") == 0)
+        {
+            single_read_state(r, &test->initial);
+        }
+        else if (strcmp(key, "final") == 0)
+        {
+            single_read_state(r, &test->final);
+        }
+        else if (strcmp(key, "cycles") == 0)
+        {
+            single_read_cycles(r, test);
+        }
+        else
+        {
+            json_skip(r);
+        }
+    }
+    return !r->error;
+}
+
+//----------------------
+// Runner
+//----------------------
+
+static void single_log(uint16_t abs_address, uint8_t data, bool write)
+{
+    if (bus_log_count < SINGLE_MAX_CYCLES)
+    {
+        bus_log_address[bus_log_count] = abs_address;
+        bus_log_value[bus_log_count] = data;
+        bus_log_write[bus_log_count] = write;
+    }
+    bus_log_count++;
+}
+
+// Read handler mapped over every page. Log the read and serve it from ADDRESS.
+static uint8_t single_read(void *ctx, uint16_t abs_address)
+{
+    single_log(abs_address, ADDRESS[abs_address], false);
+    return ADDRESS[abs_address];
+}
+
+// Bus write hook. Log the writes of the running instruction.
+static void single_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+    single_log(abs_address, data, true);
+}
+
+static void single_fail(single_file *file, const single_test *test, const char *what)
+{
+    if (file->first_failure[0] == '\0')
+    {
+        snprintf(file->first_failure, sizeof(file->first_failure), "\"%s\": %s", test->name, what);
+    }
+}
+
+// Run one test on this thread's machine and count the result in file.
+static void single_run(single_file *file, const single_test *test)
+{
+    const single_state *in = &test->initial;
+    const single_state *out = &test->final;
+    bool ok = true;
+
+    for (int i = 0; i < in->ram_count; i++)
+    {
+        ADDRESS[in->ram_address[i]] = in->ram_value[i];
+    }
+    c6502.PC = in->pc;
+    c6502.SP = in->s;
+    c6502.A = in->a;
+    c6502.X = in->x;
+    c6502.Y = in->y;
+    c6502.SR = in->p;
+    c6502.JAM = false;
+    c6502.cycles = 0;
+    bus_log_count = 0;
+
+    c6502_step();
+
+    bool state = c6502.PC == out->pc && c6502.SP == out->s && c6502.A == out->a &&
+                 c6502.X == out->x && c6502.Y == out->y && c6502.SR == out->p;
+    for (int i = 0; i < out->ram_count; i++)
+    {
+        state &= ADDRESS[out->ram_address[i]] == out->ram_value[i];
+    }
+    if (!state)
+    {
+        file->state_failed++;
+        single_fail(file, test, "registers or ram differ");
+        ok = false;
+    }
+    if (c6502.cycles != (uint64_t)test->cycle_count)
+    {
+        file->cycles_failed++;
+        single_fail(file, test, "cycle count differs");
+        ok = false;
+    }
+    bool bus = bus_log_count == test->cycle_count;
+    for (int i = 0; bus && i < bus_log_count && i < SINGLE_MAX_CYCLES; i++)
+    {
+        bus = bus_log_address[i] == test->cycle_address[i] && bus_log_value[i] == test->cycle_value[i] &&
+              bus_log_write[i] == test->cycle_write[i];
+    }
+    if (!bus)
+    {
+        file->bus_failed++;
+        single_fail(file, test, "bus accesses differ");
+        ok = false;
+    }
+    file->passed += ok;
+    file->tests++;
+
+    // Clear every byte the test touched so the next test starts from zeroed memory.
+    for (int i = 0; i < in->ram_count; i++)
+    {
+        ADDRESS[in->ram_address[i]] = 0;
+    }
+    for (int i = 0; i < out->ram_count; i++)
+    {
+        ADDRESS[out->ram_address[i]] = 0;
+    }
+    for (int i = 0; i < bus_log_count && i < SINGLE_MAX_CYCLES; i++)
+    {
+        if (bus_log_write[i])
+        {
+            ADDRESS[bus_log_address[i]] = 0;
+        }
+    }
+}
+
+static void single_run_file(single_file *file, json_reader *r, single_test *test)
+{
+    r->fp = fopen(file->path, "rb");
+    r->pos = 0;
+    r->len = 0;
+    r->error = false;
+    if (!r->fp || !json_expect(r, '['))
+    {
+        file->parse_error = true;
+        if (r->fp)
+        {
+            fclose(r->fp);
+        }
+        return;
+    }
+    while (single_read_test(r, test))
+    {
+        if (file->opcode < 0)
+        {
+            for (int i = 0; i < test->initial.ram_count; i++)
+            {
+                if (test->initial.ram_address[i] == test->initial.pc)
+                {
+                    file->opcode = test->initial.ram_value[i];
+                }
+            }
+        }
+        single_run(file, test);
+    }
+    file->parse_error = r->error;
+    fclose(r->fp);
+}
+
+static void *single_worker(void *arg)
+{
+    json_reader *reader = malloc(sizeof(json_reader));
+    single_test *test = malloc(sizeof(single_test));
+
+    if (!reader || !test || !bus_add_write_hook(single_write, NULL))
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    memset(ADDRESS, 0, sizeof(ADDRESS));
+    for (int page = 0; page < 256; page++)
+    {
+        bus_map_io(page, single_read, NULL, NULL);
+    }
+    for (int i; (i = atomic_fetch_add(&next_file, 1)) < file_count;)
+    {
+        single_run_file(&files[i], reader, test);
+    }
+    for (int page = 0; page < 256; page++)
+    {
+        bus_map_io(page, NULL, NULL, NULL);
+    }
+    bus_remove_write_hook(single_write, NULL);
+    free(reader);
+    free(test);
+    return NULL;
+}
+
+static bool single_add_file(const char *path)
+{
+    if (file_count == SINGLE_MAX_FILES)
+    {
+        fprintf(stderr, "Too many test files\n");
+        return false;
+    }
+    files[file_count].path = strdup(path);
+    files[file_count].opcode = -1;
+    file_count++;
+    return true;
+}
+
+// Add path, or the per opcode files 00.json .. ff.json of a directory.
+static bool single_add_path(const char *path)
+{
+    struct stat info;
+
+    if (stat(path, &info) != 0)
+    {
+        fprintf(stderr, "%s does not exist\n", path);
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        return single_add_file(path);
+    }
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        char name[4096];
+        snprintf(name, sizeof(name), "%s/%02x.json", path, opcode);
+        if (stat(name, &info) == 0 && !single_add_file(name))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-single [-j threads] [-v] file|directory ...\n");
+    printf("  -j threads  worker threads, default one per online cpu\n");
+    printf("  -v          print the first failing test of every opcode\n");
+    printf("A directory runs its files 00.json to ff.json.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    single_file total = {0};
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-j") == 0)
+        {
+            thread_count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (argv[i][0] == '-' || !single_add_path(argv[i]))
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (file_count == 0 || thread_count < 1)
+    {
+        usage();
+        return 1;
+    }
+    if (thread_count > file_count)
+    {
+        thread_count = file_count;
+    }
+
+    pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+    if (!threads)
+    {
+        return 1;
+    }
+    for (int i = 0; i < thread_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, single_worker, NULL) != 0)
+        {
+            fprintf(stderr, "Unable to start worker thread\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < thread_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    printf("op  name      tests    passed    state   cycles      bus\n");
+    for (int i = 0; i < file_count; i++)
+    {
+        single_file *file = &files[i];
+        const char *name = (file->opcode >= 0) ? lookup_table[file->opcode].name : "?";
+
+        printf("%02X  %-5s %9llu %9llu %8llu %8llu %8llu%s\n", file->opcode & 0xFF, name,
+               (unsigned long long)file->tests, (unsigned long long)file->passed,
+               (unsigned long long)file->state_failed, (unsigned long long)file->cycles_failed,
+               (unsigned long long)file->bus_failed, file->parse_error ? "  parse error" : "");
+        if (verbose && file->first_failure[0])
+        {
+            printf("    %s\n", file->first_failure);
+        }
+        total.tests += file->tests;
+        total.passed += file->passed;
+        total.parse_error |= file->parse_error;
+        free((char *)file->path);
+    }
+    printf("%llu tests, %llu passed, %llu failed\n", (unsigned long long)total.tests,
+           (unsigned long long)total.passed, (unsigned long long)(total.tests - total.passed));
+    free(threads);
+    return (total.tests == total.passed && !total.parse_error) ? 0 : 1;
+}
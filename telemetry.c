@@ -0,0 +1,240 @@
+/*
+telemetry.c
+Seqlock protected counters in a shared memory region.
+*/
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "telemetry.h"
+#include "c6502.h"
+
+static const char telemetry_magic[4] = {'C', '6', 'T', 'M'};
+
+// Region opened for writing, shared by every thread of the process.
+static c6502_telemetry_region *region = NULL;
+
+static uint64_t telemetry_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+// Return true if mapped looks like a region of this version.
+static bool telemetry_valid(const c6502_telemetry_region *mapped)
+{
+    return memcmp(mapped->magic, telemetry_magic, 4) == 0 && mapped->version == C6502_TELEMETRY_VERSION &&
+           mapped->slot_count == C6502_TELEMETRY_SLOTS && mapped->field_count == C6502_TELEMETRY_FIELDS;
+}
+
+/*
+c6502_telemetry_open() Create or open the region for writing.
+A new region reads as all zero; the header is written once by whoever finds it empty.
+*/
+bool c6502_telemetry_open(const char *name)
+{
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (ftruncate(fd, sizeof(c6502_telemetry_region)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, sizeof(c6502_telemetry_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    region = mapped;
+    if (region->version == 0)
+    {
+        region->version = C6502_TELEMETRY_VERSION;
+        region->slot_count = C6502_TELEMETRY_SLOTS;
+        region->field_count = C6502_TELEMETRY_FIELDS;
+        memcpy(region->magic, telemetry_magic, 4);
+    }
+    if (!telemetry_valid(region))
+    {
+        c6502_telemetry_close();
+        return false;
+    }
+    return true;
+}
+
+/*
+c6502_telemetry_close() Unmap the region.
+*/
+void c6502_telemetry_close(void)
+{
+    if (region)
+    {
+        munmap(region, sizeof(c6502_telemetry_region));
+        region = NULL;
+    }
+}
+
+/*
+c6502_telemetry_remove() Unlink the region name.
+*/
+void c6502_telemetry_remove(const char *name)
+{
+    shm_unlink(name);
+}
+
+/*
+c6502_telemetry_claim() Take the first free slot.
+*/
+int c6502_telemetry_claim(const char *label)
+{
+    if (!region)
+    {
+        return -1;
+    }
+    for (int i = 0; i < C6502_TELEMETRY_SLOTS; i++)
+    {
+        c6502_telemetry_slot *slot = &region->slots[i];
+        uint32_t free_slot = 0;
+
+        if (atomic_compare_exchange_strong(&slot->in_use, &free_slot, 1))
+        {
+            uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+
+            atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+            strncpy(slot->label, label, C6502_TELEMETRY_LABEL - 1);
+            slot->label[C6502_TELEMETRY_LABEL - 1] = '\0';
+            for (int f = 0; f < C6502_TELEMETRY_FIELDS; f++)
+            {
+                atomic_store_explicit(&slot->values[f], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+c6502_telemetry_release() Mark slot free.
+*/
+void c6502_telemetry_release(int slot)
+{
+    if (region && slot >= 0 && slot < C6502_TELEMETRY_SLOTS)
+    {
+        atomic_store_explicit(&region->slots[slot].in_use, 0, memory_order_release);
+    }
+}
+
+/*
+c6502_telemetry_update() Write one seqlock protected update.
+Only the owner of a slot writes it, so the previous values can be read back without the lock.
+*/
+void c6502_telemetry_update(int slot, uint64_t instructions, uint64_t cycles, uint64_t trace_backlog,
+                            uint64_t snapshot_bytes)
+{
+    if (!region || slot < 0 || slot >= C6502_TELEMETRY_SLOTS)
+    {
+        return;
+    }
+    c6502_telemetry_slot *s = &region->slots[slot];
+    uint64_t now = telemetry_now();
+    uint64_t last_time = atomic_load_explicit(&s->values[C6502_TELEMETRY_UPDATED_NS], memory_order_relaxed);
+    uint64_t last_cycles = atomic_load_explicit(&s->values[C6502_TELEMETRY_CYCLES], memory_order_relaxed);
+    uint64_t khz = atomic_load_explicit(&s->values[C6502_TELEMETRY_KHZ], memory_order_relaxed);
+    uint64_t values[C6502_TELEMETRY_FIELDS];
+
+    // Cycles per ns times 1e6 is kHz.
+    if (last_time && now > last_time && cycles >= last_cycles)
+    {
+        khz = (uint64_t)((double)(cycles - last_cycles) * 1e6 / (now - last_time));
+    }
+    values[C6502_TELEMETRY_INSTRUCTIONS] = instructions;
+    values[C6502_TELEMETRY_CYCLES] = cycles;
+    values[C6502_TELEMETRY_KHZ] = khz;
+    values[C6502_TELEMETRY_INTERRUPTS] = c6502_events.interrupts;
+    values[C6502_TELEMETRY_JAMS] = c6502_events.jams;
+    values[C6502_TELEMETRY_UNKNOWN] = c6502_events.unknown;
+    values[C6502_TELEMETRY_TRACE_BACKLOG] = trace_backlog;
+    values[C6502_TELEMETRY_SNAPSHOT_BYTES] = snapshot_bytes;
+    values[C6502_TELEMETRY_UPDATED_NS] = now;
+
+    uint32_t sequence = atomic_load_explicit(&s->sequence, memory_order_relaxed);
+    atomic_store_explicit(&s->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int f = 0; f < C6502_TELEMETRY_FIELDS; f++)
+    {
+        atomic_store_explicit(&s->values[f], values[f], memory_order_relaxed);
+    }
+    atomic_store_explicit(&s->sequence, sequence + 2, memory_order_release);
+}
+
+/*
+c6502_telemetry_map() Map an existing region read only.
+*/
+const c6502_telemetry_region *c6502_telemetry_map(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    void *mapped = mmap(NULL, sizeof(c6502_telemetry_region), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (!telemetry_valid(mapped))
+    {
+        munmap(mapped, sizeof(c6502_telemetry_region));
+        return NULL;
+    }
+    return mapped;
+}
+
+/*
+c6502_telemetry_unmap() Unmap a read only region.
+*/
+void c6502_telemetry_unmap(const c6502_telemetry_region *mapped)
+{
+    munmap((void *)mapped, sizeof(c6502_telemetry_region));
+}
+
+/*
+c6502_telemetry_read() Seqlock read: retry while the writer is in the middle of an update.
+*/
+bool c6502_telemetry_read(const c6502_telemetry_region *mapped, int slot, uint64_t values[C6502_TELEMETRY_FIELDS],
+                          char label[C6502_TELEMETRY_LABEL])
+{
+    c6502_telemetry_slot *s = (c6502_telemetry_slot *)&mapped->slots[slot];
+    uint32_t before, after;
+
+    do
+    {
+        before = atomic_load_explicit(&s->sequence, memory_order_acquire);
+        if (before & 1)
+        {
+            after = before + 1;
+            continue;
+        }
+        for (int f = 0; f < C6502_TELEMETRY_FIELDS; f++)
+        {
+            values[f] = atomic_load_explicit(&s->values[f], memory_order_relaxed);
+        }
+        memcpy(label, s->label, C6502_TELEMETRY_LABEL);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&s->sequence, memory_order_relaxed);
+    } while (before != after);
+
+    label[C6502_TELEMETRY_LABEL - 1] = '\0';
+    return atomic_load_explicit(&s->in_use, memory_order_relaxed) != 0;
+}
@@ -0,0 +1,102 @@
+// telemetry.h
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+Live telemetry in POSIX shared memory.
+
+An emulating process creates a named region with c6502_telemetry_open() and each running
+machine claims a slot. The emulation thread calls c6502_telemetry_update() now and then (every
+few ten thousand instructions is plenty); a monitor such as c6502-top maps the region read only
+with c6502_telemetry_map() and reads slots whenever it likes.
+
+Every slot is a seqlock: the writer makes sequence odd, stores the values, then makes it even
+again. A reader copies the values and retries if sequence was odd or changed meanwhile. Writers
+never wait, lock or make a system call (the clock is read through the vDSO), and readers never
+block writers.
+
+Region layout, host byte order, one slot per 64 byte aligned block:
+
+    header   "C6TM", uint16 version, uint16 slot count, uint32 field count
+    slots    c6502_telemetry_slot[C6502_TELEMETRY_SLOTS]
+*/
+
+#define C6502_TELEMETRY_VERSION 1
+#define C6502_TELEMETRY_SLOTS 64
+#define C6502_TELEMETRY_LABEL 32
+
+typedef enum
+{
+    C6502_TELEMETRY_INSTRUCTIONS,
+    C6502_TELEMETRY_CYCLES,
+    C6502_TELEMETRY_KHZ,            // Emulated clock since the previous update
+    C6502_TELEMETRY_INTERRUPTS,     // IRQs taken plus NMIs
+    C6502_TELEMETRY_JAMS,           // JAM opcodes run
+    C6502_TELEMETRY_UNKNOWN,        // UNK placeholder opcodes run
+    C6502_TELEMETRY_TRACE_BACKLOG,  // Trace bytes not written out yet
+    C6502_TELEMETRY_SNAPSHOT_BYTES, // Bytes held by snapshots (rewind buffer, checkpoints)
+    C6502_TELEMETRY_UPDATED_NS,     // CLOCK_MONOTONIC time of the update
+    C6502_TELEMETRY_FIELDS,
+} c6502_telemetry_field;
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint32_t sequence; // Odd while the writer is updating
+    _Atomic uint32_t in_use;
+    char label[C6502_TELEMETRY_LABEL];
+    _Atomic uint64_t values[C6502_TELEMETRY_FIELDS];
+} c6502_telemetry_slot;
+
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t slot_count;
+    uint32_t field_count;
+    c6502_telemetry_slot slots[C6502_TELEMETRY_SLOTS];
+} c6502_telemetry_region;
+
+/*
+Create the shared memory region name (for example "/c6502"), or open it if it exists, for
+writing. Return false if it can not be created or mapped.
+*/
+bool c6502_telemetry_open(const char *name);
+
+// Unmap the region. Does not remove it, c6502_telemetry_remove() does.
+void c6502_telemetry_close(void);
+
+// Remove region name from the system. Processes that mapped it keep their mapping.
+void c6502_telemetry_remove(const char *name);
+
+// Claim a free slot and name it label. Return the slot, or -1 if the region is not open or full.
+int c6502_telemetry_claim(const char *label);
+
+// Give slot back.
+void c6502_telemetry_release(int slot);
+
+/*
+Publish the state of this thread's machine to slot. instructions and cycles are running totals
+kept by the caller (c6502.cycles may be reset between jobs); interrupts, JAM and UNK counts come
+from c6502_events.
+*/
+void c6502_telemetry_update(int slot, uint64_t instructions, uint64_t cycles, uint64_t trace_backlog,
+                            uint64_t snapshot_bytes);
+
+// Map region name read only. Return NULL if it does not exist or is not a telemetry region.
+const c6502_telemetry_region *c6502_telemetry_map(const char *name);
+
+// Unmap a region returned by c6502_telemetry_map().
+void c6502_telemetry_unmap(const c6502_telemetry_region *region);
+
+/*
+Read a consistent copy of slot into values and label. Return false if the slot is not in use.
+*/
+bool c6502_telemetry_read(const c6502_telemetry_region *region, int slot, uint64_t values[C6502_TELEMETRY_FIELDS],
+                          char label[C6502_TELEMETRY_LABEL]);
+
+#endif
@@ -0,0 +1,119 @@
+/*
+top.c
+c6502-top prints the live counters of every machine publishing to a telemetry region.
+
+    c6502-batch -t /c6502 manifest &
+    c6502-top -i 1 /c6502
+
+One line per slot in use: instructions, cycles, emulated clock, interrupts, JAM and UNK hits,
+trace backlog, snapshot bytes and the age of the last update. Reading never blocks the writers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "telemetry.h"
+
+static uint64_t top_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+// Print every slot in use. Return the number printed.
+static int top_print(const c6502_telemetry_region *region)
+{
+    uint64_t now = top_now();
+    int shown = 0;
+
+    printf("%-4s %-24s %14s %14s %9s %10s %6s %6s %9s %10s %8s\n", "slot", "label", "instructions", "cycles",
+           "MHz", "interrupts", "jams", "unk", "backlog", "snapshot", "age ms");
+    for (int slot = 0; slot < C6502_TELEMETRY_SLOTS; slot++)
+    {
+        uint64_t v[C6502_TELEMETRY_FIELDS];
+        char label[C6502_TELEMETRY_LABEL];
+
+        if (!c6502_telemetry_read(region, slot, v, label))
+        {
+            continue;
+        }
+        uint64_t updated = v[C6502_TELEMETRY_UPDATED_NS];
+        double age = (updated && now > updated) ? (now - updated) / 1e6 : 0;
+
+        printf("%-4d %-24s %14llu %14llu %9.3f %10llu %6llu %6llu %9llu %10llu %8.0f\n", slot, label,
+               (unsigned long long)v[C6502_TELEMETRY_INSTRUCTIONS], (unsigned long long)v[C6502_TELEMETRY_CYCLES],
+               v[C6502_TELEMETRY_KHZ] / 1000.0, (unsigned long long)v[C6502_TELEMETRY_INTERRUPTS],
+               (unsigned long long)v[C6502_TELEMETRY_JAMS], (unsigned long long)v[C6502_TELEMETRY_UNKNOWN],
+               (unsigned long long)v[C6502_TELEMETRY_TRACE_BACKLOG],
+               (unsigned long long)v[C6502_TELEMETRY_SNAPSHOT_BYTES], age);
+        shown++;
+    }
+    return shown;
+}
+
+static void usage(void)
+{
+    printf("Usage: c6502-top [-i seconds] [-n count] name\n");
+    printf("  -i seconds  repeat every seconds, default print once\n");
+    printf("  -n count    stop after count prints, default until interrupted\n");
+    printf("  name        shared memory region, as given to c6502-batch -t\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = NULL;
+    double interval = 0;
+    long count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-i") == 0)
+        {
+            interval = atof(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-n") == 0)
+        {
+            count = atol(argv[++i]);
+        }
+        else if (!name && argv[i][0] != '-')
+        {
+            name = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (!name || interval < 0 || count < 0)
+    {
+        usage();
+        return 1;
+    }
+
+    const c6502_telemetry_region *region = c6502_telemetry_map(name);
+    if (!region)
+    {
+        fprintf(stderr, "No telemetry region %s\n", name);
+        return 1;
+    }
+    for (long printed = 1;; printed++)
+    {
+        if (top_print(region) == 0)
+        {
+            printf("(no machines)\n");
+        }
+        fflush(stdout);
+        if (interval == 0 || (count && printed >= count))
+        {
+            break;
+        }
+        usleep((useconds_t)(interval * 1e6));
+        printf("\n");
+    }
+    c6502_telemetry_unmap(region);
+    return 0;
+}
@@ -0,0 +1,494 @@
+/*
+trace.c
+Instruction trace capture, binary trace files and the delta trace codec.
+See trace.h for the file formats.
+*/
+
+#include <string.h>
+#include "trace.h"
+
+static const uint8_t trace_magic[4] = {'C', '6', 'T', 'R'};
+
+// c6502_trace_capture() Fill trace record from cpu state.
+void c6502_trace_capture(c6502_trace_record *rec)
+{
+    rec->cycles = c6502.cycles;
+    rec->PC = c6502.PC;
+    rec->opcode = c6502.opcode;
+    rec->A = c6502.A;
+    rec->X = c6502.X;
+    rec->Y = c6502.Y;
+    rec->SR = c6502.SR;
+    rec->SP = c6502.SP;
+}
+
+// c6502_trace_codec_reset() Clear previous record.
+void c6502_trace_codec_reset(c6502_trace_codec *codec)
+{
+    memset(&codec->prev, 0, sizeof(codec->prev));
+}
+
+// Write unsigned LEB128 varint. Return bytes written.
+static size_t trace_put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+// Read unsigned LEB128 varint. Return bytes consumed or 0 if truncated.
+static size_t trace_get_varint(const uint8_t *in, size_t len, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (size_t n = 0; n < len && n < 10; n++)
+    {
+        result |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+        if ((in[n] & 0x80) == 0)
+        {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// Predicted PC and cycle count of the record following prev.
+static uint16_t trace_next_pc(const c6502_trace_record *prev)
+{
+    return prev->PC + c6502_instruction_bytes(prev->opcode);
+}
+
+static uint64_t trace_next_cycles(const c6502_trace_record *prev)
+{
+    return prev->cycles + lookup_table[prev->opcode].cycles;
+}
+
+/*
+c6502_trace_encode() Delta encode record.
+
+The PC difference is taken modulo 64K and stored as a zigzag encoded signed 16 bit value,
+so short backward branches also stay one or two bytes.
+*/
+size_t c6502_trace_encode(c6502_trace_codec *codec, const c6502_trace_record *rec, uint8_t *out)
+{
+    const c6502_trace_record *prev = &codec->prev;
+    uint8_t header = 0;
+    size_t n = 2;
+
+    out[1] = rec->opcode;
+
+    if (rec->A != prev->A)
+    {
+        header |= C6502_TRACE_DELTA_A;
+        out[n++] = rec->A;
+    }
+    if (rec->X != prev->X)
+    {
+        header |= C6502_TRACE_DELTA_X;
+        out[n++] = rec->X;
+    }
+    if (rec->Y != prev->Y)
+    {
+        header |= C6502_TRACE_DELTA_Y;
+        out[n++] = rec->Y;
+    }
+    if (rec->SR != prev->SR)
+    {
+        header |= C6502_TRACE_DELTA_SR;
+        out[n++] = rec->SR;
+    }
+    if (rec->SP != prev->SP)
+    {
+        header |= C6502_TRACE_DELTA_SP;
+        out[n++] = rec->SP;
+    }
+    if (rec->PC != trace_next_pc(prev))
+    {
+        int16_t diff = (int16_t)(uint16_t)(rec->PC - trace_next_pc(prev));
+        uint16_t zigzag = (uint16_t)(((uint16_t)diff << 1) ^ (uint16_t)(diff >> 15));
+        header |= C6502_TRACE_DELTA_PC;
+        n += trace_put_varint(&out[n], zigzag);
+    }
+    if (rec->cycles != trace_next_cycles(prev))
+    {
+        header |= C6502_TRACE_DELTA_CYCLES;
+        n += trace_put_varint(&out[n], rec->cycles - prev->cycles);
+    }
+
+    out[0] = header;
+    codec->prev = *rec;
+    return n;
+}
+
+// c6502_trace_decode() Decode one delta record.
+size_t c6502_trace_decode(c6502_trace_codec *codec, const uint8_t *in, size_t len, c6502_trace_record *rec)
+{
+    const c6502_trace_record *prev = &codec->prev;
+    c6502_trace_record out = *prev;
+    size_t n = 2;
+    uint64_t value = 0;
+    size_t used = 0;
+
+    if (len < 2)
+    {
+        return 0;
+    }
+    uint8_t header = in[0];
+    if (header & 0x80)
+    {
+        return 0;
+    }
+    out.opcode = in[1];
+
+    // Register bytes follow in A X Y SR SP order.
+    uint8_t *regs[5] = {&out.A, &out.X, &out.Y, &out.SR, &out.SP};
+    for (int i = 0; i < 5; i++)
+    {
+        if (header & (1 << i))
+        {
+            if (n >= len)
+            {
+                return 0;
+            }
+            *regs[i] = in[n++];
+        }
+    }
+
+    out.PC = trace_next_pc(prev);
+    if (header & C6502_TRACE_DELTA_PC)
+    {
+        used = trace_get_varint(&in[n], len - n, &value);
+        if (used == 0 || value > 0xFFFF)
+        {
+            return 0;
+        }
+        n += used;
+        int16_t diff = (int16_t)((value >> 1) ^ (0 - (value & 1)));
+        out.PC += (uint16_t)diff;
+    }
+
+    out.cycles = trace_next_cycles(prev);
+    if (header & C6502_TRACE_DELTA_CYCLES)
+    {
+        used = trace_get_varint(&in[n], len - n, &value);
+        if (used == 0)
+        {
+            return 0;
+        }
+        n += used;
+        out.cycles = prev->cycles + value;
+    }
+
+    codec->prev = out;
+    *rec = out;
+    return n;
+}
+
+// c6502_trace_writer_open() Create trace file and write header.
+bool c6502_trace_writer_open(c6502_trace_writer *w, const char *path, c6502_trace_format format)
+{
+    w->fp = fopen(path, "wb");
+    if (!w->fp)
+    {
+        printf("Unable to create trace file %s\n", path);
+        return false;
+    }
+    w->format = format;
+    w->used = 0;
+    c6502_trace_codec_reset(&w->codec);
+
+    fwrite(trace_magic, sizeof(trace_magic), 1, w->fp);
+    fputc(format, w->fp);
+    return true;
+}
+
+// c6502_trace_writer_put() Buffer record, flush buffer to file when full.
+void c6502_trace_writer_put(c6502_trace_writer *w, const c6502_trace_record *rec)
+{
+    if (w->used + C6502_TRACE_DELTA_MAX > sizeof(w->buffer))
+    {
+        fwrite(w->buffer, w->used, 1, w->fp);
+        w->used = 0;
+    }
+
+    if (w->format == C6502_TRACE_DELTA)
+    {
+        w->used += c6502_trace_encode(&w->codec, rec, &w->buffer[w->used]);
+    }
+    else
+    {
+        memcpy(&w->buffer[w->used], rec, sizeof(*rec));
+        w->used += sizeof(*rec);
+    }
+}
+
+// c6502_trace_writer_close() Flush and close.
+void c6502_trace_writer_close(c6502_trace_writer *w)
+{
+    if (w->used > 0)
+    {
+        fwrite(w->buffer, w->used, 1, w->fp);
+        w->used = 0;
+    }
+    fclose(w->fp);
+    w->fp = NULL;
+}
+
+// c6502_trace_reader_open() Open trace file and check header.
+bool c6502_trace_reader_open(c6502_trace_reader *r, const char *path)
+{
+    uint8_t header[5];
+
+    r->fp = fopen(path, "rb");
+    if (!r->fp)
+    {
+        printf("Trace file %s does not exist\n", path);
+        return false;
+    }
+    if (fread(header, sizeof(header), 1, r->fp) != 1 ||
+        memcmp(header, trace_magic, sizeof(trace_magic)) != 0 ||
+        header[4] > C6502_TRACE_DELTA)
+    {
+        printf("%s is not a trace file\n", path);
+        fclose(r->fp);
+        r->fp = NULL;
+        return false;
+    }
+    r->format = header[4];
+    r->pos = 0;
+    r->len = 0;
+    c6502_trace_codec_reset(&r->codec);
+    return true;
+}
+
+// Move unread bytes to the front of the buffer and top it up from the file.
+static void trace_reader_fill(c6502_trace_reader *r)
+{
+    memmove(r->buffer, &r->buffer[r->pos], r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+    r->len += fread(&r->buffer[r->len], 1, sizeof(r->buffer) - r->len, r->fp);
+}
+
+// c6502_trace_reader_next() Read next record.
+bool c6502_trace_reader_next(c6502_trace_reader *r, c6502_trace_record *rec)
+{
+    size_t need = (r->format == C6502_TRACE_DELTA) ? C6502_TRACE_DELTA_MAX : sizeof(*rec);
+
+    if (r->len - r->pos < need)
+    {
+        trace_reader_fill(r);
+    }
+
+    if (r->format == C6502_TRACE_DELTA)
+    {
+        size_t used = c6502_trace_decode(&r->codec, &r->buffer[r->pos], r->len - r->pos, rec);
+        r->pos += used;
+        return used > 0;
+    }
+
+    if (r->len - r->pos < sizeof(*rec))
+    {
+        return false;
+    }
+    memcpy(rec, &r->buffer[r->pos], sizeof(*rec));
+    r->pos += sizeof(*rec);
+    return true;
+}
+
+// c6502_trace_reader_close() Close trace file.
+void c6502_trace_reader_close(c6502_trace_reader *r)
+{
+    fclose(r->fp);
+    r->fp = NULL;
+}
+
+// c6502_trace_filter_init() Clear filter to accept every instruction.
+void c6502_trace_filter_init(c6502_trace_filter *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->active = true;
+}
+
+// c6502_trace_filter_add_window() Add inclusive PC window.
+bool c6502_trace_filter_add_window(c6502_trace_filter *f, uint16_t low, uint16_t high)
+{
+    if (f->pc_window_count == C6502_TRACE_MAX_WINDOWS)
+    {
+        return false;
+    }
+    f->pc_low[f->pc_window_count] = low;
+    f->pc_high[f->pc_window_count] = high;
+    f->pc_window_count++;
+    return true;
+}
+
+// c6502_trace_filter_add_opcode() Add opcode to opcode set.
+void c6502_trace_filter_add_opcode(c6502_trace_filter *f, uint8_t opcode)
+{
+    f->opcodes[opcode >> 3] |= 1 << (opcode & 0x07);
+    f->opcode_set = true;
+}
+
+// Return true if the opcode handler belongs to the opcode class.
+static bool trace_opcode_in_class(uint8_t opcode, c6502_opcode_class opcode_class)
+{
+    void (*run)(void) = lookup_table[opcode].run;
+
+    switch (opcode_class)
+    {
+    case C6502_CLASS_BRANCH:
+        return run == BCC || run == BCS || run == BEQ || run == BMI ||
+               run == BNE || run == BPL || run == BVC || run == BVS;
+    case C6502_CLASS_JUMP:
+        return run == JMP || run == JSR || run == RTS || run == RTI || run == BRK;
+    case C6502_CLASS_LOAD:
+        return run == LDA || run == LDX || run == LDY || run == LAX;
+    case C6502_CLASS_STORE:
+        return run == STA || run == STX || run == STY || run == SAX;
+    case C6502_CLASS_RMW:
+        // Accumulator shifts do not touch memory.
+        return lookup_table[opcode].address_mode != A &&
+               (run == ASL || run == LSR || run == ROL || run == ROR || run == INC || run == DEC ||
+                run == SLO || run == SRE || run == RLA || run == RRA || run == DCP || run == ISB);
+    case C6502_CLASS_STACK:
+        return run == PHA || run == PHP || run == PLA || run == PLP || run == TSX || run == TXS;
+    }
+    return false;
+}
+
+// c6502_trace_filter_add_class() Add all opcodes of a class to opcode set.
+void c6502_trace_filter_add_class(c6502_trace_filter *f, c6502_opcode_class opcode_class)
+{
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        if (trace_opcode_in_class(opcode, opcode_class))
+        {
+            c6502_trace_filter_add_opcode(f, opcode);
+        }
+    }
+}
+
+// Bus write hook. Flag the write if it hits the address of the trigger waiting to fire.
+static void trace_filter_write(void *ctx, uint16_t abs_address, uint8_t data)
+{
+    c6502_trace_filter *f = ctx;
+
+    if (f->active)
+    {
+        f->write_hit |= (f->stop == C6502_TRIGGER_WRITE && abs_address == f->stop_address);
+    }
+    else
+    {
+        f->write_hit |= (f->start == C6502_TRIGGER_WRITE && abs_address == f->start_address);
+    }
+}
+
+// c6502_trace_filter_arm() Reset trigger state and install write hook.
+bool c6502_trace_filter_arm(c6502_trace_filter *f)
+{
+    f->active = (f->start == C6502_TRIGGER_NONE);
+    f->done = false;
+    f->write_hit = false;
+    f->remaining = f->stop_count;
+
+    if (f->start == C6502_TRIGGER_WRITE || f->stop == C6502_TRIGGER_WRITE)
+    {
+        return bus_add_write_hook(trace_filter_write, f);
+    }
+    return true;
+}
+
+// c6502_trace_filter_disarm() Remove write hook.
+void c6502_trace_filter_disarm(c6502_trace_filter *f)
+{
+    bus_remove_write_hook(trace_filter_write, f);
+}
+
+// Deactivate filter after a stop trigger fired.
+static void trace_filter_stop(c6502_trace_filter *f)
+{
+    f->active = false;
+    f->done = !f->rearm || f->start == C6502_TRIGGER_NONE;
+}
+
+/*
+c6502_trace_filter_check() Evaluate triggers, PC windows and opcode set
+for the instruction at c6502.PC.
+*/
+bool c6502_trace_filter_check(c6502_trace_filter *f)
+{
+    uint16_t pc = c6502.PC;
+
+    if (!f->active)
+    {
+        if (f->done)
+        {
+            return false;
+        }
+        if ((f->start == C6502_TRIGGER_PC && pc == f->start_address) ||
+            (f->start == C6502_TRIGGER_WRITE && f->write_hit))
+        {
+            f->active = true;
+            f->write_hit = false;
+            f->remaining = f->stop_count;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    switch (f->stop)
+    {
+    case C6502_TRIGGER_PC:
+        if (pc == f->stop_address)
+        {
+            trace_filter_stop(f);
+            return false;
+        }
+        break;
+    case C6502_TRIGGER_WRITE:
+        if (f->write_hit)
+        {
+            f->write_hit = false;
+            trace_filter_stop(f);
+            return false;
+        }
+        break;
+    case C6502_TRIGGER_COUNT:
+        if (f->remaining == 0)
+        {
+            trace_filter_stop(f);
+            return false;
+        }
+        f->remaining--;
+        break;
+    default:
+        break;
+    }
+
+    if (f->pc_window_count > 0)
+    {
+        bool inside = false;
+        for (int i = 0; i < f->pc_window_count; i++)
+        {
+            inside |= (pc >= f->pc_low[i] && pc <= f->pc_high[i]);
+        }
+        if (!inside)
+        {
+            return false;
+        }
+    }
+
+    if (f->opcode_set)
+    {
+        return (f->opcodes[c6502.opcode >> 3] >> (c6502.opcode & 0x07)) & 1;
+    }
+    return true;
+}
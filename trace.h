@@ -0,0 +1,215 @@
+// trace.h
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "c6502.h"
+
+/*
+Instruction trace.
+
+A trace record is captured after the opcode is fetched and before the instruction runs,
+the same point where main.c prints its nestest.log style line.
+
+Two file formats are supported. Both start with a 5 byte header: "C6TR" and a format byte.
+
+C6502_TRACE_BINARY  Records are written back to back as raw c6502_trace_record structs.
+
+C6502_TRACE_DELTA   Each record only stores what changed since the previous record:
+
+    header  1 byte bitmask (see C6502_TRACE_DELTA_* below)
+    opcode  1 byte, always present
+    A X Y SR SP  1 byte each, only present when the matching header bit is set
+    PC      zigzag varint of (PC - predicted PC), present when PC did not advance by
+            the length of the previous instruction
+    cycles  varint of the cycle delta, present when it differs from the base cycle
+            count of the previous instruction in lookup_table
+
+Both formats decode to identical c6502_trace_record values.
+*/
+
+typedef enum
+{
+    C6502_TRACE_BINARY = 0,
+    C6502_TRACE_DELTA = 1,
+} c6502_trace_format;
+
+// Delta record header bits
+#define C6502_TRACE_DELTA_A 0x01
+#define C6502_TRACE_DELTA_X 0x02
+#define C6502_TRACE_DELTA_Y 0x04
+#define C6502_TRACE_DELTA_SR 0x08
+#define C6502_TRACE_DELTA_SP 0x10
+#define C6502_TRACE_DELTA_PC 0x20
+#define C6502_TRACE_DELTA_CYCLES 0x40
+
+// Largest possible delta record: header, opcode, 5 registers, 3 byte PC varint, 10 byte cycle varint.
+#define C6502_TRACE_DELTA_MAX 20
+
+// Struct for one traced instruction. 16 bytes, no padding.
+typedef struct
+{
+    uint64_t cycles; // CPU cycle count before the instruction runs
+    uint16_t PC;     // Address of the opcode
+    uint8_t opcode;  // Opcode fetched at PC
+    uint8_t A;       // Accumulator register
+    uint8_t X;       // X register
+    uint8_t Y;       // Y register
+    uint8_t SR;      // Status Register
+    uint8_t SP;      // Stack pointer
+} c6502_trace_record;
+
+// Delta codec state. Encoder and decoder each keep the previous record.
+typedef struct
+{
+    c6502_trace_record prev;
+} c6502_trace_codec;
+
+// Buffered trace file writer
+typedef struct
+{
+    FILE *fp;
+    c6502_trace_format format;
+    c6502_trace_codec codec;
+    size_t used;
+    uint8_t buffer[8192];
+} c6502_trace_writer;
+
+// Buffered trace file reader
+typedef struct
+{
+    FILE *fp;
+    c6502_trace_format format;
+    c6502_trace_codec codec;
+    size_t pos;
+    size_t len;
+    uint8_t buffer[8192];
+} c6502_trace_reader;
+
+/*
+Trace filter
+
+Evaluated after the opcode fetch and before any record is built, so instructions that
+are filtered out cost a few compares. An instruction is traced when:
+
+1. The filter is active. Without a start trigger the filter is active from the first
+   instruction. A start trigger activates it when the PC reaches start_address, or on the
+   instruction after the first write to start_address. A stop trigger deactivates it when
+   the PC reaches stop_address, after the first write to stop_address, or after
+   stop_count instructions. When rearm is false the filter never restarts after a stop.
+2. The PC falls in one of the PC windows (or no window is set).
+3. The opcode is in the opcode set (or the opcode set is empty).
+*/
+
+// Maximum number of PC windows per filter.
+#define C6502_TRACE_MAX_WINDOWS 8
+
+typedef enum
+{
+    C6502_TRIGGER_NONE = 0,
+    C6502_TRIGGER_PC = 1,    // PC reaches address
+    C6502_TRIGGER_WRITE = 2, // Write to address
+    C6502_TRIGGER_COUNT = 3, // Stop only: number of instructions after start
+} c6502_trace_trigger;
+
+// Opcode classes for c6502_trace_filter_add_class()
+typedef enum
+{
+    C6502_CLASS_BRANCH = 0, // Conditional branches BCC BCS BEQ BMI BNE BPL BVC BVS
+    C6502_CLASS_JUMP = 1,   // JMP JSR RTS RTI BRK
+    C6502_CLASS_LOAD = 2,   // LDA LDX LDY LAX
+    C6502_CLASS_STORE = 3,  // STA STX STY SAX
+    C6502_CLASS_RMW = 4,    // Read modify write of memory: ASL LSR ROL ROR INC DEC and illegal combos
+    C6502_CLASS_STACK = 5,  // PHA PHP PLA PLP TSX TXS
+} c6502_opcode_class;
+
+typedef struct
+{
+    // PC windows, inclusive.
+    uint16_t pc_low[C6502_TRACE_MAX_WINDOWS];
+    uint16_t pc_high[C6502_TRACE_MAX_WINDOWS];
+    int pc_window_count;
+
+    // Opcode set, one bit per opcode. Empty set accepts all opcodes.
+    uint8_t opcodes[32];
+    bool opcode_set;
+
+    c6502_trace_trigger start;
+    uint16_t start_address;
+    c6502_trace_trigger stop;
+    uint16_t stop_address;
+    uint64_t stop_count;
+    bool rearm;
+
+    // Runtime state
+    bool active;
+    bool done;
+    bool write_hit;
+    uint64_t remaining;
+} c6502_trace_filter;
+
+// Clear filter. A cleared filter accepts every instruction.
+void c6502_trace_filter_init(c6502_trace_filter *f);
+
+// Add inclusive PC window. Return false if all window slots are in use.
+bool c6502_trace_filter_add_window(c6502_trace_filter *f, uint16_t low, uint16_t high);
+
+// Add a single opcode to the opcode set.
+void c6502_trace_filter_add_opcode(c6502_trace_filter *f, uint8_t opcode);
+
+// Add every opcode of a class to the opcode set.
+void c6502_trace_filter_add_class(c6502_trace_filter *f, c6502_opcode_class opcode_class);
+
+/*
+Arm the filter triggers. Installs a bus write hook when a write trigger is used.
+Call after setting start/stop fields and before the first instruction.
+Return false if the write hook can not be installed.
+*/
+bool c6502_trace_filter_arm(c6502_trace_filter *f);
+
+// Remove the bus write hook installed by c6502_trace_filter_arm().
+void c6502_trace_filter_disarm(c6502_trace_filter *f);
+
+// Return true if the instruction just fetched should be traced.
+bool c6502_trace_filter_check(c6502_trace_filter *f);
+
+// Fill a trace record from the current cpu state. Call after c6502_read_opcode().
+void c6502_trace_capture(c6502_trace_record *rec);
+
+// Reset codec to its initial state (previous record all zero).
+void c6502_trace_codec_reset(c6502_trace_codec *codec);
+
+/*
+Encode a record into out (at least C6502_TRACE_DELTA_MAX bytes).
+Return number of bytes written.
+*/
+size_t c6502_trace_encode(c6502_trace_codec *codec, const c6502_trace_record *rec, uint8_t *out);
+
+/*
+Decode one record from in.
+Return number of bytes consumed, or 0 if the input is truncated or malformed.
+*/
+size_t c6502_trace_decode(c6502_trace_codec *codec, const uint8_t *in, size_t len, c6502_trace_record *rec);
+
+// Open trace file for writing. Return false if the file can not be created.
+bool c6502_trace_writer_open(c6502_trace_writer *w, const char *path, c6502_trace_format format);
+
+// Append record to trace file.
+void c6502_trace_writer_put(c6502_trace_writer *w, const c6502_trace_record *rec);
+
+// Flush buffered records and close trace file.
+void c6502_trace_writer_close(c6502_trace_writer *w);
+
+// Open trace file for reading. The format is taken from the file header.
+bool c6502_trace_reader_open(c6502_trace_reader *r, const char *path);
+
+// Read next record. Return false at end of file or on a malformed record.
+bool c6502_trace_reader_next(c6502_trace_reader *r, c6502_trace_record *rec);
+
+// Close trace file.
+void c6502_trace_reader_close(c6502_trace_reader *r);
+
+#endif